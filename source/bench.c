@@ -0,0 +1,688 @@
+#include "review.h"
+#include "persue.h"
+#include "wonder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// This is the maximum amount of repetitions of a measure
+#define BENCH_REPS 64
+
+// This is the maximum amount of results that a baseline can have
+#define BENCH_RESULTS 64
+
+typedef enum { MEASURE_FORWARD, MEASURE_STEP, MEASURE_EPOCH, MEASURE_AMOUNT } measure_t;
+
+static const char* measureNames[MEASURE_AMOUNT] = {"forward", "step", "epoch"};
+
+typedef enum { SCALING_STRONG, SCALING_WEAK, SCALING_AMOUNT } scaling_t;
+
+static const char* scalingNames[SCALING_AMOUNT] = {"strong", "weak"};
+
+typedef struct
+{
+  const char* name;       // The name of the scenario
+  size_t amount;          // The amount of layers (input, hiddens, output)
+  size_t amounts[8];      // The sizes of each layer
+  activ_t activs[8];      // The activation function of each layer (ex input)
+  float learnrate;        // The learning rate
+  float momentum;         // The momentum
+  size_t bsize;           // The batch size, which the amount of samples is a multiple of
+  size_t forwardSamples;  // The amount of forward passes of every repetition
+  size_t stepSamples;     // The amount of samples trained in steps of every repetition
+  size_t epochs;          // The amount of epochs of every repetition
+  size_t scalingBsize;    // The batch size of one thread, when the thread scaling is measured
+  size_t scalingBatches;  // The amount of batches of every repetition, when the thread scaling is measured
+} BenchScenario;
+
+typedef struct
+{
+  float** inputs;  // The inputs of every sample
+  float** targets; // The targets of every sample
+  size_t amount;   // The amount of samples
+  size_t inputAmount;
+  size_t outputAmount;
+} BenchData;
+
+typedef struct
+{
+  char scenario[32];  // The name of the scenario
+  char measure[32];   // The name of the measure
+  double median;      // The median of the samples per second
+} BenchResult;
+
+static const BenchScenario scenarios[] = {
+  {
+    .name = "xor", .amount = 3, .amounts = {2, 4, 1}, .activs = {ACTIV_SIGMOID, ACTIV_SIGMOID},
+    .learnrate = 0.01, .momentum = 0.01, .bsize = 4,
+    .forwardSamples = 200000, .stepSamples = 40000, .epochs = 10000,
+    .scalingBsize = 64, .scalingBatches = 200
+  },
+  {
+    .name = "smiley", .amount = 7, .amounts = {2, 8, 16, 16, 16, 8, 1},
+    .activs = {ACTIV_RELU, ACTIV_TANH, ACTIV_RELU, ACTIV_SIGMOID, ACTIV_TANH, ACTIV_SIGMOID},
+    .learnrate = 0.0009, .momentum = 0.1, .bsize = 1,
+    .forwardSamples = 20480, .stepSamples = 2048, .epochs = 2,
+    .scalingBsize = 64, .scalingBatches = 50
+  },
+  {
+    .name = "wide", .amount = 4, .amounts = {784, 1024, 1024, 10}, .activs = {ACTIV_RELU, ACTIV_RELU, ACTIV_SOFTMAX},
+    .learnrate = 0.001, .momentum = 0.1, .bsize = 8,
+    .forwardSamples = 64, .stepSamples = 16, .epochs = 1,
+    .scalingBsize = 8, .scalingBatches = 1
+  }
+};
+
+static const size_t scenarioAmount = sizeof(scenarios) / sizeof(BenchScenario);
+
+/*
+ * Create the samples of the XOR problem
+ */
+static int bench_xor_data_create(BenchData* data)
+{
+  float tinputs[4][2] = {{1.0f, 1.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}};
+  float ttargets[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+
+  data->amount = 4;
+  data->inputAmount = 2;
+  data->outputAmount = 1;
+
+  data->inputs = float_matrix_create(4, 2);
+  data->targets = float_matrix_create(4, 1);
+
+  for(size_t index = 0; index < 4; index++)
+  {
+    float_vector_copy(data->inputs[index], tinputs[index], 2);
+
+    data->targets[index][0] = ttargets[index];
+  }
+  return 0; // Success!
+}
+
+/*
+ * Create the samples of the smiley image, the same way as master does
+ */
+static int bench_smiley_data_create(BenchData* data)
+{
+  ImageCache image;
+
+  if(image_cache_read(&image, "../assets/smilie.png", 1, IMAGE_LAYOUT_INTERLEAVED, "../assets/.cache") != 0) return 1;
+
+  size_t amount = image.width * image.height;
+
+  float** matrix = image_values_matrix_create(image.values, image.width, image.height);
+
+  image_cache_free(&image);
+
+  if(matrix == NULL) return 1;
+
+  data->amount = amount;
+  data->inputAmount = 2;
+  data->outputAmount = 1;
+
+  data->inputs = float_matrix_create(amount, 2);
+  data->targets = float_matrix_create(amount, 1);
+
+  float_matrix_filter_index(data->inputs, matrix, amount, 3, (int[]) {0, 1}, 2);
+  float_matrix_filter_index(data->targets, matrix, amount, 3, (int[]) {2}, 1);
+
+  float_matrix_free(&matrix, amount, 3);
+
+  return 0; // Success!
+}
+
+/*
+ * Create random samples with one-hot targets, for a classifier like MNIST
+ */
+static int bench_random_data_create(BenchData* data, size_t amount, size_t inputAmount, size_t outputAmount)
+{
+  data->amount = amount;
+  data->inputAmount = inputAmount;
+  data->outputAmount = outputAmount;
+
+  data->inputs = float_matrix_random_create(amount, inputAmount, 0.0f, 1.0f);
+  data->targets = float_matrix_create(amount, outputAmount);
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    data->targets[index][index % outputAmount] = 1.0f;
+  }
+  return 0; // Success!
+}
+
+static void bench_data_free(BenchData* data)
+{
+  float_matrix_free(&data->inputs, data->amount, data->inputAmount);
+  float_matrix_free(&data->targets, data->amount, data->outputAmount);
+}
+
+/*
+ * Run a measure once
+ *
+ * The trainer is shared by the runs of a measure, so only the first run creates its workspace
+ *
+ * RETURN (double samplesPerSecond)
+ * - The amount of samples per second, or 0 if the measure failed
+ */
+static double bench_measure_run(measure_t measure, Trainer* trainer, Network* network, const BenchScenario* scenario, BenchData* data)
+{
+  size_t outputAmount = data->outputAmount;
+
+  float outputs[outputAmount];
+
+  size_t samples = 0;
+
+  int status = 0;
+
+  uint64_t start = timer_nanos();
+
+  switch(measure)
+  {
+    case MEASURE_FORWARD:
+      for(; samples < scenario->forwardSamples; samples++)
+      {
+        network_forward(outputs, *network, data->inputs[samples % data->amount]);
+      }
+      break;
+
+    case MEASURE_STEP:
+      for(size_t batch = 0; samples < scenario->stepSamples; batch++)
+      {
+        size_t offset = (batch * scenario->bsize) % data->amount;
+
+        if((status = network_train_mini_batch(trainer, network, data->inputs + offset, data->targets + offset, scenario->bsize)) != 0) break;
+
+        samples += scenario->bsize;
+      }
+      break;
+
+    case MEASURE_EPOCH:
+      status = network_train_mini_batch_epochs(trainer, network, data->inputs, data->targets, data->amount, scenario->bsize, scenario->epochs);
+
+      samples = data->amount * scenario->epochs;
+      break;
+
+    default: status = 1;
+  }
+  uint64_t nanos = timer_nanos() - start;
+
+  if(status != 0) return 0;
+
+  return (nanos > 0) ? (1e9 * samples / nanos) : 0;
+}
+
+static int double_compare(const void* double1, const void* double2)
+{
+  double value1 = *(const double*) double1;
+  double value2 = *(const double*) double2;
+
+  return (value1 > value2) - (value1 < value2);
+}
+
+/*
+ * Run a measure multiple times and write the median and variance as a JSON object
+ */
+static void bench_measure_write(FILE* stream, measure_t measure, Network* network, const BenchScenario* scenario, BenchData* data, size_t reps, size_t warmups, bool* first)
+{
+  Trainer trainer;
+
+  trainer_init(&trainer, NULL);
+
+  // The first run creates the workspace and touches its pages, so it is always a warm-up
+  size_t warmupRuns = (warmups > 0) ? warmups : 1;
+
+  for(size_t index = 0; index < warmupRuns; index++) bench_measure_run(measure, &trainer, network, scenario, data);
+
+  double values[BENCH_REPS];
+
+  double sum = 0;
+
+  for(size_t index = 0; index < reps; index++)
+  {
+    values[index] = bench_measure_run(measure, &trainer, network, scenario, data);
+
+    sum += values[index];
+  }
+  trainer_free(&trainer);
+
+  double mean = sum / reps;
+
+  double squares = 0;
+
+  for(size_t index = 0; index < reps; index++)
+  {
+    squares += (values[index] - mean) * (values[index] - mean);
+  }
+  double variance = (reps > 1) ? (squares / (reps - 1)) : 0;
+
+  qsort(values, reps, sizeof(double), double_compare);
+
+  double median = (reps % 2) ? values[reps / 2] : ((values[reps / 2 - 1] + values[reps / 2]) / 2);
+
+  // Every result is on its own line, so a baseline can be read back line by line
+  fprintf(stream, "%s    {\"scenario\": \"%s\", \"measure\": \"%s\", \"unit\": \"samples/s\", \"median\": %.3f, \"mean\": %.3f, \"variance\": %.3f, \"min\": %.3f, \"max\": %.3f}",
+    *first ? "" : ",\n", scenario->name, measureNames[measure], median, mean, variance, values[0], values[reps - 1]);
+
+  fflush(stream);
+
+  *first = false;
+
+  fprintf(stderr, "%-8s %-8s : %14.1f samples/s (stddev %.1f%%)\n", scenario->name, measureNames[measure], median,
+    (mean > 0) ? (100 * sqrt(variance) / mean) : 0);
+}
+
+/*
+ * Run every measure of a scenario
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to create the data or the network
+ */
+static int bench_scenario_write(FILE* stream, const BenchScenario* scenario, size_t reps, size_t warmups, bool* first)
+{
+  // Every scenario starts from the same weights, whatever scenarios were run before it
+  srand(420);
+
+  BenchData data;
+
+  int status;
+
+  if(!strcmp(scenario->name, "xor")) status = bench_xor_data_create(&data);
+
+  else if(!strcmp(scenario->name, "smiley")) status = bench_smiley_data_create(&data);
+
+  else status = bench_random_data_create(&data, 16, scenario->amounts[0], scenario->amounts[scenario->amount - 1]);
+
+  if(status != 0)
+  {
+    error_print("Failed to create the data of %s", scenario->name);
+
+    return 1;
+  }
+
+  Network network;
+
+  if(network_init(&network, scenario->amount, scenario->amounts, scenario->activs, scenario->learnrate, scenario->momentum) != 0)
+  {
+    bench_data_free(&data);
+
+    return 1;
+  }
+
+  for(measure_t measure = 0; measure < MEASURE_AMOUNT; measure++)
+  {
+    bench_measure_write(stream, measure, &network, scenario, &data, reps, warmups, first);
+  }
+  network_free(&network);
+
+  bench_data_free(&data);
+
+  return 0; // Success!
+}
+
+/*
+ * Run the forward passes or the training steps of a scaling measure once, on the threads of a pool
+ *
+ * The trainer (with the pool) and the outputs are shared by the runs of a thread count
+ *
+ * RETURN (double seconds)
+ * - The time of the batches, or 0 if the measure failed
+ */
+static double bench_scaling_run(measure_t measure, Trainer* trainer, float** outputs, Network* network, const BenchScenario* scenario, BenchData* data, size_t bsize)
+{
+  ThreadPool* pool = trainer->options.pool;
+
+  int status = 0;
+
+  uint64_t start = timer_nanos();
+
+  for(size_t batch = 0; batch < scenario->scalingBatches && status == 0; batch++)
+  {
+    if(measure == MEASURE_FORWARD) status = network_forward_batch(outputs, *network, data->inputs, bsize, pool);
+
+    else status = network_train_mini_batch(trainer, network, data->inputs, data->targets, bsize);
+  }
+  uint64_t nanos = timer_nanos() - start;
+
+  return (status == 0) ? (nanos / 1e9) : 0;
+}
+
+/*
+ * Measure how the forward passes and the training steps of a scenario scale from 1 to N threads
+ *
+ * Strong scaling keeps the batch size, so the ideal time is 1 / threads of the time of one thread.
+ * Weak scaling grows the batch size with the threads, so the ideal time is the time of one thread.
+ * The speedup is the work per second relative to one thread, and the efficiency is the speedup per thread
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to create the data, the network or a pool
+ */
+static int bench_scaling_write(FILE* stream, const BenchScenario* scenario, size_t maxThreads, bool pin, size_t reps, size_t warmups, bool* first)
+{
+  srand(420);
+
+  // The values of the samples do not matter for the timings, only the sizes of the layers
+  BenchData data;
+
+  size_t inputAmount = scenario->amounts[0];
+  size_t outputAmount = scenario->amounts[scenario->amount - 1];
+
+  bench_random_data_create(&data, scenario->scalingBsize * maxThreads, inputAmount, outputAmount);
+
+  Network network;
+
+  if(network_init(&network, scenario->amount, scenario->amounts, scenario->activs, scenario->learnrate, scenario->momentum) != 0)
+  {
+    bench_data_free(&data);
+
+    return 1;
+  }
+
+  int status = 0;
+
+  for(measure_t measure = MEASURE_FORWARD; measure <= MEASURE_STEP && status == 0; measure++)
+  {
+    for(scaling_t scaling = 0; scaling < SCALING_AMOUNT && status == 0; scaling++)
+    {
+      double oneSeconds = 0;
+
+      for(size_t threads = 1; threads <= maxThreads; threads++)
+      {
+        ThreadPool pool;
+
+        if(pool_init(&pool, threads, pin) != 0)
+        {
+          error_print("Failed to start a pool of %ld threads", threads);
+
+          status = 1;
+
+          break;
+        }
+        size_t bsize = (scaling == SCALING_WEAK) ? (scenario->scalingBsize * threads) : scenario->scalingBsize;
+
+        float** outputs = float_matrix_create(bsize, outputAmount);
+
+        TrainOptions options = { .pool = &pool, .seed = 0 };
+
+        Trainer trainer;
+
+        trainer_init(&trainer, &options);
+
+        // The first run creates the workspace and touches its pages, so it is always a warm-up
+        size_t warmupRuns = (warmups > 0) ? warmups : 1;
+
+        for(size_t index = 0; index < warmupRuns; index++) bench_scaling_run(measure, &trainer, outputs, &network, scenario, &data, bsize);
+
+        double values[BENCH_REPS];
+
+        for(size_t index = 0; index < reps; index++)
+        {
+          values[index] = bench_scaling_run(measure, &trainer, outputs, &network, scenario, &data, bsize);
+        }
+        trainer_free(&trainer);
+
+        float_matrix_free(&outputs, bsize, outputAmount);
+
+        pool_free(&pool);
+
+        qsort(values, reps, sizeof(double), double_compare);
+
+        double seconds = (reps % 2) ? values[reps / 2] : ((values[reps / 2 - 1] + values[reps / 2]) / 2);
+
+        if(threads == 1) oneSeconds = seconds;
+
+        // Weak scaling does (threads) times the work of one thread
+        double work = (scaling == SCALING_WEAK) ? threads : 1;
+
+        double speedup = (seconds > 0) ? (work * oneSeconds / seconds) : 0;
+
+        double efficiency = speedup / threads;
+
+        fprintf(stream, "%s    {\"scenario\": \"%s\", \"measure\": \"%s\", \"scaling\": \"%s\", \"threads\": %ld, \"bsize\": %ld, \"seconds\": %.6f, \"speedup\": %.3f, \"efficiency\": %.3f}",
+          *first ? "" : ",\n", scenario->name, measureNames[measure], scalingNames[scaling], threads, bsize, seconds, speedup, efficiency);
+
+        fflush(stream);
+
+        *first = false;
+
+        fprintf(stderr, "%-8s %-8s %-6s %3ld threads : %10.3f ms (speedup %5.2f efficiency %5.1f%%)\n", scenario->name,
+          measureNames[measure], scalingNames[scaling], threads, 1e3 * seconds, speedup, 100 * efficiency);
+      }
+    }
+  }
+  network_free(&network);
+
+  bench_data_free(&data);
+
+  return status;
+}
+
+/*
+ * Read the results of a baseline file, that was written by this program
+ *
+ * RETURN (size_t amount)
+ * - The amount of read results
+ */
+static size_t bench_baseline_read(BenchResult* results, const char* path)
+{
+  FILE* file = fopen(path, "r");
+
+  if(file == NULL)
+  {
+    error_print("fopen: %s: %s", path, strerror(errno));
+
+    return 0;
+  }
+
+  char line[512];
+
+  size_t amount = 0;
+
+  while(amount < BENCH_RESULTS && fgets(line, sizeof(line), file) != NULL)
+  {
+    BenchResult* result = &results[amount];
+
+    if(sscanf(line, " {\"scenario\": \"%31[^\"]\", \"measure\": \"%31[^\"]\", \"unit\": \"samples/s\", \"median\": %lf",
+      result->scenario, result->measure, &result->median) == 3) amount++;
+  }
+  fclose(file);
+
+  return amount;
+}
+
+/*
+ * Compare the results of the current file with the baseline
+ *
+ * RETURN (size_t regressions)
+ * - The amount of results that are slower than the baseline by more than the threshold
+ */
+static size_t bench_baseline_compare(const char* path, const char* baselinePath, double threshold)
+{
+  BenchResult results[BENCH_RESULTS];
+  BenchResult baselines[BENCH_RESULTS];
+
+  size_t amount = bench_baseline_read(results, path);
+  size_t baselineAmount = bench_baseline_read(baselines, baselinePath);
+
+  size_t regressions = 0;
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    const BenchResult* result = &results[index];
+
+    for(size_t baseIndex = 0; baseIndex < baselineAmount; baseIndex++)
+    {
+      const BenchResult* baseline = &baselines[baseIndex];
+
+      if(strcmp(result->scenario, baseline->scenario) || strcmp(result->measure, baseline->measure) || baseline->median <= 0) continue;
+
+      double change = (result->median / baseline->median) - 1;
+
+      bool regressed = (change < -threshold);
+
+      fprintf(stderr, "%-8s %-8s : %+7.1f%% (%.1f -> %.1f samples/s)%s\n", result->scenario, result->measure,
+        100 * change, baseline->median, result->median, regressed ? " REGRESSION" : "");
+
+      regressions += regressed;
+    }
+  }
+  return regressions;
+}
+
+/*
+ * Benchmark the throughput of the forward pass, the training steps and whole epochs
+ *
+ * ./bench [--reps N] [--warmups N] [--scenario NAME] [--output PATH] [--baseline PATH] [--threshold FRACTION]
+ *         [--scaling] [--threads N] [--pin]
+ *
+ * The results are written as JSON to the output (stdout by default), and can be saved as a baseline.
+ * With a baseline, the median of every measure is compared, and the exit status is 2 if any
+ * measure is slower than the baseline by more than the threshold (0.10 by default)
+ *
+ * With --scaling, the strong and weak thread scaling of the forward passes and the training steps
+ * is measured instead, from 1 to N threads (one per online processor by default).
+ * With --pin, every thread is pinned to its own processor, so the results are repeatable
+ */
+int main(int argc, char* argv[])
+{
+  size_t reps = 5;
+  size_t warmups = 1;
+
+  const char* scenarioName = NULL;
+  const char* outputPath = NULL;
+  const char* baselinePath = NULL;
+
+  double threshold = 0.10;
+
+  bool scaling = false;
+  bool pin = false;
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  size_t maxThreads = (processors > 0) ? processors : 1;
+
+  for(int index = 1; index < argc; index++)
+  {
+    if(!strcmp(argv[index], "--scaling"))
+    {
+      scaling = true;
+
+      continue;
+    }
+
+    if(!strcmp(argv[index], "--pin"))
+    {
+      pin = true;
+
+      continue;
+    }
+
+    const char* value = ((index + 1) < argc) ? argv[index + 1] : NULL;
+
+    if(value == NULL) break;
+
+    if(!strcmp(argv[index], "--reps")) reps = atol(value);
+
+    else if(!strcmp(argv[index], "--warmups")) warmups = atol(value);
+
+    else if(!strcmp(argv[index], "--scenario")) scenarioName = value;
+
+    else if(!strcmp(argv[index], "--output")) outputPath = value;
+
+    else if(!strcmp(argv[index], "--baseline")) baselinePath = value;
+
+    else if(!strcmp(argv[index], "--threshold")) threshold = atof(value);
+
+    else if(!strcmp(argv[index], "--threads")) maxThreads = atol(value);
+
+    else continue;
+
+    index++;
+  }
+
+  if(reps < 1 || reps > BENCH_REPS)
+  {
+    error_print("The reps have to be between 1 and %d", BENCH_REPS);
+
+    return 1;
+  }
+
+  if(maxThreads < 1 || maxThreads > POOL_THREADS)
+  {
+    error_print("The threads have to be between 1 and %d", POOL_THREADS);
+
+    return 1;
+  }
+
+  // The epochs log their progress, which would drown the results
+  log_level_set(LOG_LEVEL_WARN);
+
+  // The blocking of the matrix kernels is tuned once for every CPU model, and loaded from the cache after that
+  if(secure_blocking_init("../assets/.cache/blocking.txt") != 0) error_print("secure_blocking_init");
+
+  // A baseline is compared with a file, so the results are written to a temporary file if there is no output
+  char tempPath[] = "/tmp/bench-XXXXXX";
+
+  if(outputPath == NULL && baselinePath != NULL)
+  {
+    int fd = mkstemp(tempPath);
+
+    if(fd == -1) return 1;
+
+    close(fd);
+
+    outputPath = tempPath;
+  }
+
+  FILE* stream = (outputPath != NULL) ? fopen(outputPath, "w") : stdout;
+
+  if(stream == NULL)
+  {
+    error_print("fopen: %s: %s", outputPath, strerror(errno));
+
+    return 1;
+  }
+
+  fprintf(stream, "{\n  \"reps\": %ld,\n  \"warmups\": %ld,\n", reps, warmups);
+
+  if(scaling) fprintf(stream, "  \"threads\": %ld,\n  \"pinned\": %s,\n", maxThreads, pin ? "true" : "false");
+
+  fprintf(stream, "  \"results\": [\n");
+
+  bool first = true;
+
+  int status = 0;
+
+  for(size_t index = 0; index < scenarioAmount; index++)
+  {
+    if(scenarioName != NULL && strcmp(scenarioName, scenarios[index].name)) continue;
+
+    const BenchScenario* scenario = &scenarios[index];
+
+    int result = scaling ? bench_scaling_write(stream, scenario, maxThreads, pin, reps, warmups, &first) : bench_scenario_write(stream, scenario, reps, warmups, &first);
+
+    if(result != 0) status = 1;
+  }
+  fprintf(stream, "\n  ]\n}\n");
+
+  if(stream != stdout) fclose(stream);
+
+  if(baselinePath != NULL)
+  {
+    size_t regressions = bench_baseline_compare(outputPath, baselinePath, threshold);
+
+    if(regressions > 0 && status == 0) status = 2;
+  }
+
+  if(outputPath == tempPath) unlink(tempPath);
+
+  return status;
+}
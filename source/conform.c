@@ -0,0 +1,908 @@
+#include "review.h"
+#include "secure.h"
+#include "persue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+
+// The amount of random shapes of every check, besides the edge sizes
+#define CONFORM_SHAPES 32
+
+// The largest random height or width
+#define CONFORM_MAX_SIZE 300
+
+// The amount of failures that are printed for every check
+#define CONFORM_PRINTS 3
+
+// The sizes around the widths of vector registers and unrolled loops, where the tails are handled
+static const size_t edgeSizes[] = {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129};
+
+static const size_t edgeAmount = sizeof(edgeSizes) / sizeof(size_t);
+
+typedef struct ConformCheck ConformCheck;
+
+// A check is run with a shape, and compares every value with conform_compare
+typedef void (*conform_run_t)(ConformCheck* check, size_t height, size_t width, size_t offset);
+
+struct ConformCheck
+{
+  const char* name;     // The name of the check
+  conform_run_t run;    // The function that runs the check on one shape
+  double ulps;          // The allowed error in units in the last place of the reference
+  double relative;      // The allowed error relative to the magnitude of the terms of the reference
+  size_t values;        // The amount of compared values
+  size_t failures;      // The amount of values outside of the tolerance
+  double worst;         // The largest error, as a fraction of the tolerance
+  size_t height;        // The height of the current shape
+  size_t width;         // The width of the current shape
+  size_t offset;        // The amount of floats that the current buffers are shifted off their alignment
+};
+
+/*
+ * Get the distance from a value to the next float away from 0
+ */
+static double float_ulp(double value)
+{
+  float absolute = fabsf((float) value);
+
+  return nextafterf(absolute, INFINITY) - absolute;
+}
+
+/*
+ * Compare a value with its reference
+ *
+ * The value passes if it is within the ulps or within the relative tolerance
+ * of the magnitude, which is the sum of the absolute terms for sums like dot products
+ */
+static void conform_compare(ConformCheck* check, double value, double reference, double magnitude)
+{
+  double error = fabs(value - reference);
+
+  double ulpsError = error / float_ulp(reference);
+  double relativeError = (magnitude > 0) ? (error / magnitude) : ((error > 0) ? INFINITY : 0);
+
+  double ulpsMargin = (check->ulps > 0) ? (ulpsError / check->ulps) : ((error > 0) ? INFINITY : 0);
+  double relativeMargin = (check->relative > 0) ? (relativeError / check->relative) : ((error > 0) ? INFINITY : 0);
+
+  double margin = (ulpsMargin < relativeMargin) ? ulpsMargin : relativeMargin;
+
+  if(isnan(value) || isnan(reference)) margin = INFINITY;
+
+  check->values++;
+
+  if(margin > check->worst) check->worst = margin;
+
+  if(margin <= 1) return;
+
+  if(check->failures++ < CONFORM_PRINTS)
+  {
+    fprintf(stderr, "%-28s %3ldx%-3ld +%ld : %.9g != %.9g (%.1f ulps, %.3g relative)\n", check->name,
+      check->height, check->width, check->offset, value, reference, ulpsError, relativeError);
+  }
+}
+
+/*
+ * Create a random vector that starts (offset) floats after an aligned allocation
+ */
+static float* conform_vector_create(float** block, size_t length, size_t offset)
+{
+  *block = malloc(sizeof(float) * (length + offset));
+
+  float* vector = *block + offset;
+
+  for(size_t index = 0; index < length; index++) vector[index] = float_random_create(-1.0f, +1.0f);
+
+  return vector;
+}
+
+/*
+ * Create a random matrix of rows in one block, where every row is shifted (offset) floats
+ */
+static float** conform_matrix_create(float** block, size_t height, size_t width, size_t offset)
+{
+  // An odd stride makes every row start at another alignment
+  size_t stride = width + offset + 1;
+
+  *block = malloc(sizeof(float) * (height * stride + offset));
+
+  float** matrix = malloc(sizeof(float*) * height);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    matrix[hIndex] = *block + (hIndex * stride) + offset;
+
+    for(size_t wIndex = 0; wIndex < width; wIndex++) matrix[hIndex][wIndex] = float_random_create(-1.0f, +1.0f);
+  }
+  return matrix;
+}
+
+static void conform_matrix_free(float* block, float** matrix)
+{
+  free(block);
+  free(matrix);
+}
+
+static void vector_copy_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2;
+
+  float* source = conform_vector_create(&block1, width, offset);
+  float* destin = conform_vector_create(&block2, width, (offset + 1) % 4);
+
+  float_vector_copy(destin, source, width);
+
+  for(size_t index = 0; index < width; index++) conform_compare(check, destin[index], source[index], 0);
+
+  free(block1);
+  free(block2);
+}
+
+static void vector_scale_multi_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2;
+
+  float* vector = conform_vector_create(&block1, width, offset);
+  float* result = conform_vector_create(&block2, width, offset);
+
+  float scalor = float_random_create(-2.0f, +2.0f);
+
+  float_vector_scale_multi(result, vector, width, scalor);
+
+  for(size_t index = 0; index < width; index++)
+  {
+    float reference = vector[index] * scalor;
+
+    conform_compare(check, result[index], reference, 0);
+  }
+  free(block1);
+  free(block2);
+}
+
+static void vector_elem_addit_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2, *block3;
+
+  float* vector1 = conform_vector_create(&block1, width, offset);
+  float* vector2 = conform_vector_create(&block2, width, (offset + 1) % 4);
+  float* result = conform_vector_create(&block3, width, (offset + 2) % 4);
+
+  float_vector_elem_addit(result, vector1, vector2, width);
+
+  for(size_t index = 0; index < width; index++)
+  {
+    float reference = vector1[index] + vector2[index];
+
+    conform_compare(check, result[index], reference, 0);
+  }
+  free(block1);
+  free(block2);
+  free(block3);
+}
+
+static void vector_dotprod_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2, *block3;
+
+  float* vector1 = conform_vector_create(&block1, height, offset);
+  float* vector2 = conform_vector_create(&block2, width, (offset + 1) % 4);
+  float** result = conform_matrix_create(&block3, height, width, offset);
+
+  float_vector_dotprod(result, vector1, height, vector2, width);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      float reference = vector1[hIndex] * vector2[wIndex];
+
+      conform_compare(check, result[hIndex][wIndex], reference, 0);
+    }
+  }
+  free(block1);
+  free(block2);
+  conform_matrix_free(block3, result);
+}
+
+static void matrix_transp_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2;
+
+  float** matrix = conform_matrix_create(&block1, height, width, offset);
+  float** transp = conform_matrix_create(&block2, width, height, (offset + 1) % 4);
+
+  float_matrix_transp(transp, matrix, height, width);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      conform_compare(check, transp[wIndex][hIndex], matrix[hIndex][wIndex], 0);
+    }
+  }
+  conform_matrix_free(block1, matrix);
+  conform_matrix_free(block2, transp);
+}
+
+static void matrix_scale_multi_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2;
+
+  float** matrix = conform_matrix_create(&block1, height, width, offset);
+  float** result = conform_matrix_create(&block2, height, width, (offset + 1) % 4);
+
+  float scalor = float_random_create(-2.0f, +2.0f);
+
+  float_matrix_scale_multi(result, matrix, height, width, scalor);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      float reference = matrix[hIndex][wIndex] * scalor;
+
+      conform_compare(check, result[hIndex][wIndex], reference, 0);
+    }
+  }
+  conform_matrix_free(block1, matrix);
+  conform_matrix_free(block2, result);
+}
+
+static void matrix_elem_addit_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  float* block1, *block2, *block3;
+
+  float** matrix1 = conform_matrix_create(&block1, height, width, offset);
+  float** matrix2 = conform_matrix_create(&block2, height, width, (offset + 1) % 4);
+  float** result = conform_matrix_create(&block3, height, width, (offset + 2) % 4);
+
+  float_matrix_elem_addit(result, matrix1, matrix2, height, width);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      float reference = matrix1[hIndex][wIndex] + matrix2[hIndex][wIndex];
+
+      conform_compare(check, result[hIndex][wIndex], reference, 0);
+    }
+  }
+  conform_matrix_free(block1, matrix1);
+  conform_matrix_free(block2, matrix2);
+  conform_matrix_free(block3, result);
+}
+
+/*
+ * Check the matrix vector product, with the result in its own vector or in the input vector,
+ * like the forward pass does
+ *
+ * If blocked, the blocking is picked from the shape, with blocks that leave tails of columns
+ */
+static void matrix_vector_dotprod_check(ConformCheck* check, size_t height, size_t width, size_t offset, bool inplace, bool blocked)
+{
+  MatrixBlocking oldBlocking;
+
+  secure_blocking_get(&oldBlocking);
+
+  if(blocked)
+  {
+    size_t blocks[] = {0, 7, 16, 64};
+
+    MatrixBlocking blocking = { .rows = (size_t) 1 << ((height + offset) % 3), .block = blocks[(width + offset) % 4] };
+
+    secure_blocking_set(&blocking);
+  }
+  float* block1, *block2, *block3;
+
+  float** matrix = conform_matrix_create(&block1, height, width, offset);
+
+  // The input vector is large enough to hold the result, if the result is written in place
+  size_t length = (height > width) ? height : width;
+
+  float* vector = conform_vector_create(&block2, length, (offset + 1) % 4);
+  float* result = inplace ? vector : conform_vector_create(&block3, height, (offset + 2) % 4);
+
+  double references[height];
+  double magnitudes[height];
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    references[hIndex] = 0;
+    magnitudes[hIndex] = 0;
+
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      double term = (double) matrix[hIndex][wIndex] * vector[wIndex];
+
+      references[hIndex] += term;
+      magnitudes[hIndex] += fabs(term);
+    }
+  }
+  float_matrix_vector_dotprod(result, matrix, height, width, vector);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    conform_compare(check, result[hIndex], references[hIndex], magnitudes[hIndex]);
+  }
+  conform_matrix_free(block1, matrix);
+  free(block2);
+
+  if(!inplace) free(block3);
+
+  secure_blocking_set(&oldBlocking);
+}
+
+static void matrix_vector_dotprod_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matrix_vector_dotprod_check(check, height, width, offset, false, false);
+}
+
+static void matrix_vector_dotprod_inplace_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matrix_vector_dotprod_check(check, height, width, offset, true, false);
+}
+
+static void matrix_vector_dotprod_blocked_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matrix_vector_dotprod_check(check, height, width, offset, false, true);
+}
+
+static void matrix_vector_dotprod_blocked_inplace_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matrix_vector_dotprod_check(check, height, width, offset, true, true);
+}
+
+/*
+ * Check the element-wise kernels of matrix arrays, with 1 to 4 matrices
+ */
+static void matarr_check(ConformCheck* check, size_t height, size_t width, size_t offset, bool addit)
+{
+  size_t amount = 1 + (height + width) % 4;
+
+  float*** matarr1 = float_matarr_create(amount, height, width);
+  float*** matarr2 = float_matarr_create(amount, height, width);
+  float*** result = float_matarr_create(amount, height, width);
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    for(size_t hIndex = 0; hIndex < height; hIndex++)
+    {
+      for(size_t wIndex = 0; wIndex < width; wIndex++)
+      {
+        matarr1[index][hIndex][wIndex] = float_random_create(-1.0f, +1.0f);
+        matarr2[index][hIndex][wIndex] = float_random_create(-1.0f, +1.0f);
+      }
+    }
+  }
+  float scalor = float_random_create(-2.0f, +2.0f);
+
+  if(addit) float_matarr_elem_addit(result, matarr1, matarr2, amount, height, width);
+
+  else float_matarr_scale_multi(result, matarr1, amount, height, width, scalor);
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    for(size_t hIndex = 0; hIndex < height; hIndex++)
+    {
+      for(size_t wIndex = 0; wIndex < width; wIndex++)
+      {
+        float value1 = matarr1[index][hIndex][wIndex];
+
+        float reference = addit ? (value1 + matarr2[index][hIndex][wIndex]) : (value1 * scalor);
+
+        conform_compare(check, result[index][hIndex][wIndex], reference, 0);
+      }
+    }
+  }
+  float_matarr_free(&matarr1, amount, height, width);
+  float_matarr_free(&matarr2, amount, height, width);
+  float_matarr_free(&result, amount, height, width);
+}
+
+static void matarr_scale_multi_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matarr_check(check, height, width, offset, false);
+}
+
+static void matarr_elem_addit_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  matarr_check(check, height, width, offset, true);
+}
+
+/*
+ * The reference of the activation functions, the same formulas as persue
+ */
+static void reference_activ_values(double* values, size_t amount, activ_t activ)
+{
+  double sum = 0;
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    double value = values[index];
+
+    switch(activ)
+    {
+      case ACTIV_SIGMOID: values[index] = 1 / (1 + exp(-value)); break;
+
+      case ACTIV_RELU: values[index] = (value > 0) ? value : 0; break;
+
+      case ACTIV_TANH: values[index] = (exp(2 * value) - 1) / (exp(2 * value) + 1); break;
+
+      case ACTIV_SOFTMAX: sum += exp(value); break;
+
+      default: break;
+    }
+  }
+
+  if(activ == ACTIV_SOFTMAX)
+  {
+    for(size_t index = 0; index < amount; index++) values[index] = exp(values[index]) / sum;
+  }
+}
+
+/*
+ * The reference of applying the derivatives of the activation functions, the same formulas as persue
+ *
+ * Note: The softmax derivatives are the jacobian times the values, like persue calculates them,
+ * which does not depend on the incoming derivatives
+ */
+static void reference_activ_derivs_apply(double* derivs, const double* values, size_t amount, activ_t activ)
+{
+  double squares = 0;
+
+  for(size_t index = 0; index < amount; index++) squares += values[index] * values[index];
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    double value = values[index];
+
+    switch(activ)
+    {
+      case ACTIV_SIGMOID: derivs[index] *= value * (1 - value); break;
+
+      case ACTIV_RELU: derivs[index] *= (value > 0) ? 1 : 0; break;
+
+      case ACTIV_TANH: derivs[index] *= (1 - value * value); break;
+
+      case ACTIV_SOFTMAX: derivs[index] = value * (value - squares); break;
+
+      default: break;
+    }
+  }
+}
+
+/*
+ * Create a network of one layer, with weights that keep the node values around 1
+ */
+static int conform_layer_network_init(Network* network, size_t height, size_t width, activ_t activ)
+{
+  if(network_init(network, 2, (size_t[]) {width, height}, (activ_t[]) {activ}, 1.0f, 0.0f) != 0) return 1;
+
+  NetworkLayer* layer = &network->layers[0];
+
+  float scale = 1.0f / sqrtf(width);
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++) layer->weights[hIndex][wIndex] *= scale;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Calculate the reference node values of a one layer network, and the magnitudes of their terms
+ */
+static void reference_layer_forward(double* values, double* magnitudes, Network network, const float* inputs)
+{
+  NetworkLayer layer = network.layers[0];
+
+  for(size_t hIndex = 0; hIndex < layer.amount; hIndex++)
+  {
+    values[hIndex] = layer.biases[hIndex];
+    magnitudes[hIndex] = fabs(layer.biases[hIndex]);
+
+    for(size_t wIndex = 0; wIndex < network.inputs; wIndex++)
+    {
+      double term = (double) layer.weights[hIndex][wIndex] * inputs[wIndex];
+
+      values[hIndex] += term;
+      magnitudes[hIndex] += fabs(term);
+    }
+  }
+  reference_activ_values(values, layer.amount, layer.activ);
+}
+
+/*
+ * Check the forward pass of a one layer network, with the activation of the check
+ */
+static void forward_check(ConformCheck* check, size_t height, size_t width, size_t offset, activ_t activ)
+{
+  Network network;
+
+  if(conform_layer_network_init(&network, height, width, activ) != 0) return;
+
+  float* block;
+
+  float* inputs = conform_vector_create(&block, width, offset);
+
+  float outputs[height];
+
+  double references[height];
+  double magnitudes[height];
+
+  network_forward(outputs, network, inputs);
+
+  reference_layer_forward(references, magnitudes, network, inputs);
+
+  for(size_t index = 0; index < height; index++)
+  {
+    conform_compare(check, outputs[index], references[index], magnitudes[index]);
+  }
+  free(block);
+
+  network_free(&network);
+}
+
+static void forward_sigmoid_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  forward_check(check, height, width, offset, ACTIV_SIGMOID);
+}
+
+static void forward_relu_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  forward_check(check, height, width, offset, ACTIV_RELU);
+}
+
+static void forward_tanh_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  forward_check(check, height, width, offset, ACTIV_TANH);
+}
+
+static void forward_softmax_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  forward_check(check, height, width, offset, ACTIV_SOFTMAX);
+}
+
+// The amount of samples of the mini batches of the backward checks and the gradient checks
+#define CONFORM_BATCH 3
+
+/*
+ * Get the mean weight and bias derivatives of a batch from one training step
+ *
+ * The network has a learning rate of 1 and no momentum, so a step subtracts exactly the derivatives
+ */
+static int network_gradient_create(float** wderivs, float* bderivs, Network network, size_t layer, float** inputs, float** targets, size_t amount)
+{
+  Network clone;
+
+  if(network_clone(&clone, network) != 0) return 1;
+
+  clone.learnrate = 1.0f;
+  clone.momentum = 0.0f;
+
+  Trainer trainer;
+
+  trainer_init(&trainer, NULL);
+
+  network_train_mini_batch(&trainer, &clone, inputs, targets, amount);
+
+  trainer_free(&trainer);
+
+  size_t height = network.layers[layer].amount;
+  size_t width = (layer >= 1) ? network.layers[layer - 1].amount : network.inputs;
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      wderivs[hIndex][wIndex] = network.layers[layer].weights[hIndex][wIndex] - clone.layers[layer].weights[hIndex][wIndex];
+    }
+    bderivs[hIndex] = network.layers[layer].biases[hIndex] - clone.layers[layer].biases[hIndex];
+  }
+  network_free(&clone);
+
+  return 0; // Success!
+}
+
+/*
+ * Check the backward pass of a one layer network against the reference derivatives
+ */
+static void backward_check(ConformCheck* check, size_t height, size_t width, size_t offset, activ_t activ)
+{
+  Network network;
+
+  if(conform_layer_network_init(&network, height, width, activ) != 0) return;
+
+  float* blocks[2];
+
+  float** inputs = conform_matrix_create(&blocks[0], CONFORM_BATCH, width, offset);
+  float** targets = conform_matrix_create(&blocks[1], CONFORM_BATCH, height, offset);
+
+  float** wderivs = float_matrix_create(height, width);
+  float* bderivs = float_vector_create(height);
+
+  network_gradient_create(wderivs, bderivs, network, 0, inputs, targets, CONFORM_BATCH);
+
+  double wreferences[height][width];
+  double wmagnitudes[height][width];
+  double breferences[height];
+  double bmagnitudes[height];
+
+  memset(wreferences, 0, sizeof(wreferences));
+  memset(wmagnitudes, 0, sizeof(wmagnitudes));
+  memset(breferences, 0, sizeof(breferences));
+  memset(bmagnitudes, 0, sizeof(bmagnitudes));
+
+  for(size_t sample = 0; sample < CONFORM_BATCH; sample++)
+  {
+    double values[height];
+    double magnitudes[height];
+    double derivs[height];
+
+    reference_layer_forward(values, magnitudes, network, inputs[sample]);
+
+    for(size_t hIndex = 0; hIndex < height; hIndex++) derivs[hIndex] = 2 * (values[hIndex] - targets[sample][hIndex]);
+
+    reference_activ_derivs_apply(derivs, values, height, activ);
+
+    for(size_t hIndex = 0; hIndex < height; hIndex++)
+    {
+      // The error of the node value is carried into the derivative, and the step is taken from the weight
+      double magnitude = 4 * (magnitudes[hIndex] + 1) / CONFORM_BATCH;
+
+      for(size_t wIndex = 0; wIndex < width; wIndex++)
+      {
+        wreferences[hIndex][wIndex] += derivs[hIndex] * inputs[sample][wIndex] / CONFORM_BATCH;
+        wmagnitudes[hIndex][wIndex] += magnitude * fabs(inputs[sample][wIndex]) + fabs(network.layers[0].weights[hIndex][wIndex]) / CONFORM_BATCH;
+      }
+      breferences[hIndex] += derivs[hIndex] / CONFORM_BATCH;
+      bmagnitudes[hIndex] += magnitude + fabs(network.layers[0].biases[hIndex]) / CONFORM_BATCH;
+    }
+  }
+
+  for(size_t hIndex = 0; hIndex < height; hIndex++)
+  {
+    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    {
+      conform_compare(check, wderivs[hIndex][wIndex], wreferences[hIndex][wIndex], wmagnitudes[hIndex][wIndex]);
+    }
+    conform_compare(check, bderivs[hIndex], breferences[hIndex], bmagnitudes[hIndex]);
+  }
+  float_matrix_free(&wderivs, height, width);
+  float_vector_free(&bderivs, height);
+
+  conform_matrix_free(blocks[0], inputs);
+  conform_matrix_free(blocks[1], targets);
+
+  network_free(&network);
+}
+
+static void backward_sigmoid_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  backward_check(check, height, width, offset, ACTIV_SIGMOID);
+}
+
+static void backward_relu_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  backward_check(check, height, width, offset, ACTIV_RELU);
+}
+
+static void backward_tanh_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  backward_check(check, height, width, offset, ACTIV_TANH);
+}
+
+static void backward_softmax_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  backward_check(check, height, width, offset, ACTIV_SOFTMAX);
+}
+
+/*
+ * Calculate the loss that the derivatives of backprop are derivatives of,
+ * the mean over the samples of the summed squared errors
+ */
+static double network_loss(Network network, float** inputs, float** targets, size_t amount)
+{
+  size_t outputAmount = network.layers[network.amount - 1].amount;
+
+  float outputs[outputAmount];
+
+  double loss = 0;
+
+  for(size_t sample = 0; sample < amount; sample++)
+  {
+    network_forward(outputs, network, inputs[sample]);
+
+    for(size_t index = 0; index < outputAmount; index++)
+    {
+      double error = outputs[index] - targets[sample][index];
+
+      loss += error * error;
+    }
+  }
+  return loss / amount;
+}
+
+// The step of the central differences
+#define GRADIENT_EPSILON 1e-2f
+
+/*
+ * Compare the derivatives of full backprop with central differences of the loss,
+ * for every weight and bias of a network of three layers
+ *
+ * Note: Only smooth activations are checked, the kink of relu breaks the differences,
+ * and the softmax derivatives of persue are not the derivatives of the loss (see reference_activ_derivs_apply)
+ */
+static void gradient_check(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  // The widths are kept small, because every parameter needs two forward passes of the batch
+  size_t inputAmount = 1 + width % 8;
+  size_t hiddenAmount = 1 + height % 8;
+  size_t outputAmount = 1 + (height + width) % 4;
+
+  activ_t activs[2][3] = {{ACTIV_TANH, ACTIV_SIGMOID, ACTIV_SIGMOID}, {ACTIV_SIGMOID, ACTIV_TANH, ACTIV_NONE}};
+
+  Network network;
+
+  if(network_init(&network, 4, (size_t[]) {inputAmount, hiddenAmount, hiddenAmount, outputAmount}, activs[offset % 2], 1.0f, 0.0f) != 0) return;
+
+  float* blocks[2];
+
+  float** inputs = conform_matrix_create(&blocks[0], CONFORM_BATCH, inputAmount, offset);
+  float** targets = conform_matrix_create(&blocks[1], CONFORM_BATCH, outputAmount, offset);
+
+  for(size_t layer = 0; layer < network.amount; layer++)
+  {
+    size_t layerHeight = network.layers[layer].amount;
+    size_t layerWidth = (layer >= 1) ? network.layers[layer - 1].amount : network.inputs;
+
+    float** wderivs = float_matrix_create(layerHeight, layerWidth);
+    float* bderivs = float_vector_create(layerHeight);
+
+    network_gradient_create(wderivs, bderivs, network, layer, inputs, targets, CONFORM_BATCH);
+
+    for(size_t hIndex = 0; hIndex < layerHeight; hIndex++)
+    {
+      // The last column is the bias
+      for(size_t wIndex = 0; wIndex <= layerWidth; wIndex++)
+      {
+        float* parameter = (wIndex < layerWidth) ? &network.layers[layer].weights[hIndex][wIndex] : &network.layers[layer].biases[hIndex];
+
+        float deriv = (wIndex < layerWidth) ? wderivs[hIndex][wIndex] : bderivs[hIndex];
+
+        float value = *parameter;
+
+        *parameter = value + GRADIENT_EPSILON;
+
+        double lossPlus = network_loss(network, inputs, targets, CONFORM_BATCH);
+
+        *parameter = value - GRADIENT_EPSILON;
+
+        double lossMinus = network_loss(network, inputs, targets, CONFORM_BATCH);
+
+        *parameter = value;
+
+        double difference = (lossPlus - lossMinus) / (2 * GRADIENT_EPSILON);
+
+        // The magnitude has a floor, so derivatives around 0 are compared absolutely
+        double magnitude = fmax(fabs(difference), fabs(deriv)) + 0.1;
+
+        conform_compare(check, deriv, difference, magnitude);
+      }
+    }
+    float_matrix_free(&wderivs, layerHeight, layerWidth);
+    float_vector_free(&bderivs, layerHeight);
+  }
+  conform_matrix_free(blocks[0], inputs);
+  conform_matrix_free(blocks[1], targets);
+
+  network_free(&network);
+}
+
+// Every check declares its tolerance: the element-wise kernels have to be exact,
+// the sums may be reordered (blocked or vectorized) within the relative tolerance of their terms
+static ConformCheck checks[] = {
+  {.name = "float_vector_copy",                   .run = vector_copy_run,                   .ulps = 0, .relative = 0},
+  {.name = "float_vector_scale_multi",            .run = vector_scale_multi_run,            .ulps = 0, .relative = 0},
+  {.name = "float_vector_elem_addit",             .run = vector_elem_addit_run,             .ulps = 0, .relative = 0},
+  {.name = "float_vector_dotprod",                .run = vector_dotprod_run,                .ulps = 0, .relative = 0},
+  {.name = "float_matrix_transp",                 .run = matrix_transp_run,                 .ulps = 0, .relative = 0},
+  {.name = "float_matrix_scale_multi",            .run = matrix_scale_multi_run,            .ulps = 0, .relative = 0},
+  {.name = "float_matrix_elem_addit",             .run = matrix_elem_addit_run,             .ulps = 0, .relative = 0},
+  {.name = "float_matrix_vector_dotprod",         .run = matrix_vector_dotprod_run,         .ulps = 4, .relative = 2e-5},
+  {.name = "float_matrix_vector_dotprod inplace", .run = matrix_vector_dotprod_inplace_run, .ulps = 4, .relative = 2e-5},
+  {.name = "float_matrix_vector_dotprod blocked", .run = matrix_vector_dotprod_blocked_run, .ulps = 4, .relative = 2e-5},
+  {.name = "float_matrix_vector_dotprod blocked inplace", .run = matrix_vector_dotprod_blocked_inplace_run, .ulps = 4, .relative = 2e-5},
+  {.name = "float_matarr_scale_multi",            .run = matarr_scale_multi_run,            .ulps = 0, .relative = 0},
+  {.name = "float_matarr_elem_addit",             .run = matarr_elem_addit_run,             .ulps = 0, .relative = 0},
+  {.name = "network_forward sigmoid",             .run = forward_sigmoid_run,               .ulps = 4, .relative = 2e-5},
+  {.name = "network_forward relu",                .run = forward_relu_run,                  .ulps = 4, .relative = 2e-5},
+  {.name = "network_forward tanh",                .run = forward_tanh_run,                  .ulps = 4, .relative = 2e-5},
+  {.name = "network_forward softmax",             .run = forward_softmax_run,               .ulps = 4, .relative = 2e-5},
+  {.name = "network_train sigmoid",               .run = backward_sigmoid_run,              .ulps = 8, .relative = 2e-5},
+  {.name = "network_train relu",                  .run = backward_relu_run,                 .ulps = 8, .relative = 2e-5},
+  {.name = "network_train tanh",                  .run = backward_tanh_run,                 .ulps = 8, .relative = 2e-5},
+  {.name = "network_train softmax",               .run = backward_softmax_run,              .ulps = 8, .relative = 2e-5},
+  {.name = "gradient check",                      .run = gradient_check,                    .ulps = 0, .relative = 1e-2}
+};
+
+static const size_t checkAmount = sizeof(checks) / sizeof(ConformCheck);
+
+/*
+ * Run a check on a shape
+ */
+static void conform_shape_run(ConformCheck* check, size_t height, size_t width, size_t offset)
+{
+  check->height = height;
+  check->width = width;
+  check->offset = offset;
+
+  check->run(check, height, width, offset);
+}
+
+/*
+ * Check that the kernels of secure and persue give the same results as the scalar references
+ *
+ * ./conform [--seed N] [--shapes N] [--check NAME]
+ *
+ * Every check is run on the edge sizes, with every alignment offset, and on random shapes.
+ * The exit status is 1 if any value is outside of the tolerance of its check
+ */
+int main(int argc, char* argv[])
+{
+  unsigned int seed = 420;
+  size_t shapes = CONFORM_SHAPES;
+
+  const char* checkName = NULL;
+
+  for(int index = 1; index < argc; index++)
+  {
+    const char* value = ((index + 1) < argc) ? argv[index + 1] : NULL;
+
+    if(value == NULL) break;
+
+    if(!strcmp(argv[index], "--seed")) seed = atol(value);
+
+    else if(!strcmp(argv[index], "--shapes")) shapes = atol(value);
+
+    else if(!strcmp(argv[index], "--check")) checkName = value;
+
+    else continue;
+
+    index++;
+  }
+
+  srand(seed);
+
+  size_t failures = 0;
+
+  for(size_t index = 0; index < checkAmount; index++)
+  {
+    ConformCheck* check = &checks[index];
+
+    if(checkName != NULL && strcmp(checkName, check->name)) continue;
+
+    // The edge sizes as widths, next to other edge sizes as heights, at every offset
+    for(size_t edge = 0; edge < edgeAmount; edge++)
+    {
+      size_t height = edgeSizes[(edge * 7) % edgeAmount];
+
+      for(size_t offset = 0; offset < 4; offset++) conform_shape_run(check, height, edgeSizes[edge], offset);
+    }
+
+    for(size_t shape = 0; shape < shapes; shape++)
+    {
+      size_t height = 1 + rand() % CONFORM_MAX_SIZE;
+      size_t width = 1 + rand() % CONFORM_MAX_SIZE;
+
+      conform_shape_run(check, height, width, rand() % 4);
+    }
+    printf("%-44s : %9ld values %6ld failures (worst %.3f of tolerance) %s\n", check->name, check->values,
+      check->failures, check->worst, (check->failures > 0) ? "FAIL" : "ok");
+
+    failures += check->failures;
+  }
+  printf("seed %u: %s\n", seed, (failures > 0) ? "FAIL" : "ok");
+
+  return (failures > 0) ? 1 : 0;
+}
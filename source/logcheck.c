@@ -0,0 +1,94 @@
+#include "review.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// The length of every long string argument, so that the second one is cut off and the others don't fit
+#define LOGCHECK_LENGTH 60
+
+/*
+ * Log an event with several long string arguments into a file, and check the printed line
+ *
+ * The strings that fit are printed, the string that does not fit is cut off,
+ * the strings after it are empty, and the arguments after the strings are still printed
+ *
+ * RETURN (bool passed)
+ */
+static bool logcheck_strings_run(const char* name, bool background)
+{
+  char strings[4][LOGCHECK_LENGTH + 1];
+
+  for(size_t index = 0; index < 4; index++)
+  {
+    memset(strings[index], 'a' + index, LOGCHECK_LENGTH);
+
+    strings[index][LOGCHECK_LENGTH] = '\0';
+  }
+
+  FILE* file = tmpfile();
+
+  if(file == NULL) return false;
+
+  // The warnings are printed to stderr, which is sent to the file while the event is logged
+  fflush(stderr);
+
+  int savedFd = dup(STDERR_FILENO);
+
+  dup2(fileno(file), STDERR_FILENO);
+
+  if(background) logger_start();
+
+  log_warn("%s|%s|%s|%s|%d", strings[0], strings[1], strings[2], strings[3], 420);
+
+  if(background) logger_stop();
+
+  fflush(stderr);
+
+  dup2(savedFd, STDERR_FILENO);
+
+  close(savedFd);
+
+  char line[1024] = "";
+
+  rewind(file);
+
+  bool read = (fgets(line, sizeof(line), file) != NULL);
+
+  fclose(file);
+
+  // The second string gets the space that is left after the first string and its terminator
+  char expected[256];
+
+  snprintf(expected, sizeof(expected), "%s|%.*s|||420\n", strings[0], 96 - (LOGCHECK_LENGTH + 1) - 1, strings[1]);
+
+  const char* message = strstr(line, "]: ");
+
+  bool passed = read && message != NULL && !strcmp(message + 3, expected);
+
+  printf("%-44s : %s\n", name, passed ? "ok" : "FAIL");
+
+  if(!passed) printf("  expected: %s  printed : %s", expected, line);
+
+  return passed;
+}
+
+/*
+ * Check that the logger captures and prints the arguments of its events
+ *
+ * ./logcheck
+ *
+ * The exit status is 1 if any check fails
+ */
+int main(int argc, char* argv[])
+{
+  size_t failures = 0;
+
+  if(!logcheck_strings_run("long strings (direct)", false)) failures++;
+
+  if(!logcheck_strings_run("long strings (background)", true)) failures++;
+
+  printf("logger: %s\n", (failures > 0) ? "FAIL" : "ok");
+
+  return (failures > 0) ? 1 : 0;
+}
@@ -4,6 +4,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -20,10 +22,76 @@ int main(int argc, char* argv[])
 
   info_print("Neural Network");
 
+  // The training can be traced with: ./master --trace trace.json
+  // and every sample in the trace with: ./master --trace-detail --trace trace.json
+  // and profiled with:                 ./master --profile stacks.folded
+  // The hardware counters are printed with: ./master --perf
+  // A preview is rendered every 100 epochs with: ./master --preview previews
+  // The stats are served on a socket with: ./master --stats
+  // The batch size and the threads can be tuned with: ./master --autotune
+  bool profile = false;
+
+  bool autotune = false;
+
+  bool perfCount = false;
+
+  const char* previewDir = NULL;
+
+  bool serving = false;
+
+  for(int index = 1; index < argc; index++)
+  {
+    if(!strcmp(argv[index], "--trace") && (index + 1) < argc)
+    {
+      trace_thread_name("main");
+
+      if(trace_start(argv[++index]) != 0) error_print("trace_start");
+    }
+    else if(!strcmp(argv[index], "--profile") && (index + 1) < argc)
+    {
+      profile = (profile_start(argv[++index], 99) == 0);
+
+      if(!profile) error_print("profile_start");
+    }
+    else if(!strcmp(argv[index], "--trace-detail")) trace_detail_set(true);
+    else if(!strcmp(argv[index], "--autotune")) autotune = true;
+    else if(!strcmp(argv[index], "--perf")) perfCount = true;
+    else if(!strcmp(argv[index], "--preview") && (index + 1) < argc) previewDir = argv[++index];
+    else if(!strcmp(argv[index], "--stats")) serving = true;
+  }
+
   char imgPath[] = "../assets/smilie.png";
 
-  size_t imgWidth, imgHeight;
-  float** matrix = image_values_matrix_read(&imgWidth, &imgHeight, imgPath);
+  char cacheDir[] = "../assets/.cache";
+
+  // The network learns one grey channel, so a colour image is rejected instead of being converted to grey
+  int infoWidth, infoHeight, infoComp;
+
+  if(!stbi_info(imgPath, &infoWidth, &infoHeight, &infoComp) || infoComp != 1)
+  {
+    error_print("Image %s has to be grey (one channel)", imgPath);
+
+    return 1;
+  }
+
+  ImageCache image;
+
+  if(image_cache_read(&image, imgPath, 1, IMAGE_LAYOUT_INTERLEAVED, cacheDir) != 0)
+  {
+    error_print("Failed to read image\n");
+
+    return 1;
+  }
+
+  // The blocking of the matrix kernels is tuned once for every CPU model, and loaded from the cache after that
+  if(secure_blocking_init("../assets/.cache/blocking.txt") != 0) error_print("secure_blocking_init");
+
+  size_t imgWidth = image.width;
+  size_t imgHeight = image.height;
+
+  float** matrix = image_values_matrix_create(image.values, imgWidth, imgHeight);
+
+  image_cache_free(&image);
 
   if(matrix == NULL)
   {
@@ -54,8 +122,156 @@ int main(int argc, char* argv[])
 
   network_print(network);
 
+  NetworkMemory memory;
+
+  if(network_memory_usage(&memory, network) == 0) network_memory_print(&memory);
+
+  // Without autotune, the network is trained stochastically on this thread
+  size_t bsize = 1;
+
+  ThreadPool pool;
+
+  bool pooled = false;
+
+  if(autotune)
+  {
+    TuneResult tune;
+
+    if(network_tune(&tune, network, inputs, targets, imgWidth * imgHeight, 0, 200000000) == 0)
+    {
+      network_tune_print(&tune);
+
+      bsize = tune.best.bsize;
+
+      pooled = (tune.best.threads > 1 && pool_init(&pool, tune.best.threads, false) == 0);
+    }
+    else error_print("network_tune");
+  }
+
+  TrainOptions options = { .pool = pooled ? &pool : NULL, .seed = 420 };
+
+  Trainer trainer;
+
+  trainer_init(&trainer, &options);
+
+  // The allocations of the training are counted, to see what the steps allocate
+  secure_alloc_tracking(true);
+
   
-  network_train_mini_batch_epochs(&network, inputs, targets, imgWidth * imgHeight, 1, 10000);
+  // The hardware counters are only printed if they are asked for and supported
+  bool perf = perfCount && (perf_open() == 0);
+
+  // The training is logged from a background thread, so it doesn't wait for the console
+  if(logger_start() != 0) error_print("logger_start");
+
+  // The progress can be scraped from the socket, or dumped to stderr with SIGUSR1 (only with --stats)
+  char socketPath[64];
+
+  snprintf(socketPath, sizeof(socketPath), "/tmp/neuralnet-%d.sock", (int) getpid());
+
+  bool server = serving && (stats_server_start(socketPath) == 0);
+
+  if(server) info_print("Serving stats on %s", socketPath);
+
+  // The preview frames are only written if a directory is given, the directory is created if it is missing
+  Preview preview;
+
+  bool previewing = false;
+
+  char previewFormat[256];
+
+  if(previewDir != NULL)
+  {
+    if(mkdir(previewDir, 0755) == -1 && errno != EEXIST) error_print("Failed to create %s", previewDir);
+
+    else if(strchr(previewDir, '%') != NULL) error_print("The preview directory can not contain a percent sign");
+
+    else
+    {
+      snprintf(previewFormat, sizeof(previewFormat), "%s/preview-%%04ld.png", previewDir);
+
+      previewing = (preview_init(&preview, network, 64, 64, 100, previewFormat) == 0);
+
+      if(!previewing) error_print("preview_init");
+
+      else train_observer_add(&trainer, &preview.observer);
+    }
+  }
+
+  train_observer_add(&trainer, &trainPrintObserver);
+
+  // The activations are probed with pixels spread over the whole image
+  size_t probeAmount = 64;
+
+  float* probes[probeAmount];
+
+  for(size_t index = 0; index < probeAmount; index++)
+  {
+    probes[index] = inputs[index * (imgWidth * imgHeight) / probeAmount];
+  }
+
+  // The health is only reported, the dead and saturated units are printed after the training
+  HealthMonitor health;
+
+  bool monitor = (health_monitor_init(&health, &network, probes, probeAmount, 1000, HEALTH_NONE, &trainer.random) == 0);
+
+  if(monitor) train_observer_add(&trainer, &health.observer);
+
+  if(server) train_observer_add(&trainer, &trainGaugeObserver);
+
+
+  network_train_mini_batch_epochs(&trainer, &network, inputs, targets, imgWidth * imgHeight, bsize, 10000);
+
+  // The memory of the training is counted before the pool is freed
+  TrainMemory trainMemory;
+
+  if(train_memory_usage(&trainMemory, &trainer) == 0) train_memory_print(&trainMemory);
+
+  if(pooled) pool_free(&pool);
+
+  train_observer_remove(&trainer, &trainPrintObserver);
+
+  if(monitor) train_observer_remove(&trainer, &health.observer);
+
+  if(server) train_observer_remove(&trainer, &trainGaugeObserver);
+
+  if(previewing) train_observer_remove(&trainer, &preview.observer);
+
+  logger_stop();
+
+  if(server) stats_server_stop();
+
+  TrainStats stats;
+
+  if(train_stats_get(&trainer, &stats) == 0)
+  {
+    train_stats_print(&stats);
+
+    TrainWork work;
+
+    if(train_work_count(&work, network, &stats) == 0) train_work_print(&work, &stats);
+  }
+
+  if(perf)
+  {
+    perf_regions_print(stdout);
+
+    perf_close();
+  }
+
+  secure_alloc_tracking(false);
+
+  AllocStats allocStats;
+
+  secure_alloc_stats_get(&allocStats);
+
+  secure_alloc_print(stdout, &allocStats);
+
+  if(monitor) health_print(&health);
+
+  if(previewing) preview_free(&preview);
+
+  trainer_free(&trainer);
 
   
   size_t outWidth = 256;
@@ -63,24 +279,20 @@ int main(int argc, char* argv[])
 
   float outPixels[outWidth * outHeight];
 
-  for(size_t yValue = 0; yValue < outHeight; yValue++)
-  {
-    for(size_t xValue = 0; xValue < outWidth; xValue++)
-    {
-      float outputs[1];
+  // The latency of every rendered pixel, to see the tail and not only the mean
+  Histogram inferenceHisto;
 
-      float normX = (float) xValue / (outWidth - 1);
-      float normY = (float) yValue / (outHeight - 1);
+  histo_init(&inferenceHisto);
 
-      float outInputs[2] = {normX, normY};
+  network_forward_histo_set(&inferenceHisto);
 
-      network_forward(outputs, network, outInputs);
+  image_network_values_render(outPixels, network, outWidth, outHeight);
 
-      size_t index = (yValue * outWidth + xValue);
+  network_forward_histo_set(NULL);
 
-      outPixels[index] = outputs[0];
-    }
-  }
+  histo_print(stdout, &inferenceHisto, "inference");
+
+  if(profile) profile_stop();
 
   char outputPath[128] = "result.png";
 
@@ -0,0 +1,428 @@
+#include "review.h"
+#include "secure.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// The minimum time of a measured batch of calls, so the timer resolution does not matter
+#define MICRO_TARGET_NANOS 10000000
+
+// The amount of measured batches, the fastest batch is reported
+#define MICRO_REPS 3
+
+// The amount of floats of every STREAM array, large enough to not fit in the caches
+#define STREAM_LENGTH (1 << 22)
+
+typedef enum { KERNEL_VECTOR, KERNEL_MATRIX, KERNEL_MATARR } kernel_shape_t;
+
+// The amount of matrices of the matrix array kernels
+#define MATARR_AMOUNT 4
+
+typedef struct
+{
+  float* vector1;
+  float* vector2;
+  float* vector3;
+  float** matrix1;
+  float** matrix2;
+  float** matrix3;
+  float*** matarr1;
+  float*** matarr2;
+  float*** matarr3;
+  size_t size;
+} MicroData;
+
+// The kernels are run with a pointer to their MicroData, like the STREAM and peak runs are
+typedef void (*kernel_run_t)(void* data);
+
+typedef struct
+{
+  const char* name;     // The name of the kernel
+  kernel_shape_t shape; // If the size is the length of vectors, or the height and width of square matrices
+  kernel_run_t run;     // The function that calls the kernel once
+  double flops;         // The floating point operations per element (size, or size x size)
+  double bytes;         // The bytes read and written per element
+  double vectorBytes;   // The bytes per row (size), for the vectors next to a matrix
+} MicroKernel;
+
+static void vector_elem_addit_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_vector_elem_addit(micro->vector3, micro->vector1, micro->vector2, micro->size);
+}
+
+static void vector_scale_multi_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_vector_scale_multi(micro->vector3, micro->vector1, micro->size, 1.0001f);
+}
+
+static void vector_dotprod_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_vector_dotprod(micro->matrix3, micro->vector1, micro->size, micro->vector2, micro->size);
+}
+
+static void matrix_vector_dotprod_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matrix_vector_dotprod(micro->vector3, micro->matrix1, micro->size, micro->size, micro->vector1);
+}
+
+static void matrix_transp_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matrix_transp(micro->matrix3, micro->matrix1, micro->size, micro->size);
+}
+
+static void matrix_elem_addit_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matrix_elem_addit(micro->matrix3, micro->matrix1, micro->matrix2, micro->size, micro->size);
+}
+
+static void matrix_scale_multi_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matrix_scale_multi(micro->matrix3, micro->matrix1, micro->size, micro->size, 1.0001f);
+}
+
+static void matarr_elem_addit_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matarr_elem_addit(micro->matarr3, micro->matarr1, micro->matarr2, MATARR_AMOUNT, micro->size, micro->size);
+}
+
+static void matarr_scale_multi_run(void* data)
+{
+  MicroData* micro = data;
+
+  float_matarr_scale_multi(micro->matarr3, micro->matarr1, MATARR_AMOUNT, micro->size, micro->size, 1.0001f);
+}
+
+// The work of every kernel, counted like train_work_count counts it:
+// every float that is read or written is 4 bytes, the row pointers are not counted
+static const MicroKernel kernels[] = {
+  { "vector_elem_addit",     KERNEL_VECTOR, vector_elem_addit_run,     1, 12, 0 },
+  { "vector_scale_multi",    KERNEL_VECTOR, vector_scale_multi_run,    1,  8, 0 },
+  // The outer product writes size x size, and reads both vectors (the second one once per row)
+  { "vector_dotprod",        KERNEL_MATRIX, vector_dotprod_run,        1,  8, 4 },
+  // The matrix is read once, the vector once per row, and the result goes through a temporary copy
+  { "matrix_vector_dotprod", KERNEL_MATRIX, matrix_vector_dotprod_run, 2,  8, 12 },
+  { "matrix_transp",         KERNEL_MATRIX, matrix_transp_run,         0,  8, 0 },
+  { "matrix_elem_addit",     KERNEL_MATRIX, matrix_elem_addit_run,     1, 12, 0 },
+  { "matrix_scale_multi",    KERNEL_MATRIX, matrix_scale_multi_run,    1,  8, 0 },
+  { "matarr_elem_addit",     KERNEL_MATARR, matarr_elem_addit_run,     1, 12, 0 },
+  { "matarr_scale_multi",    KERNEL_MATARR, matarr_scale_multi_run,    1,  8, 0 }
+};
+
+static const size_t kernelAmount = sizeof(kernels) / sizeof(MicroKernel);
+
+static const size_t vectorSizes[] = {256, 4096, 65536, 1048576};
+static const size_t matrixSizes[] = {16, 64, 256, 1024, 2048};
+static const size_t matarrSizes[] = {16, 64, 256, 1024};
+
+/*
+ * Measure the fastest time of one call, by timing batches of calls that are long enough
+ *
+ * RETURN (double nanos)
+ * - The nanoseconds of one call
+ */
+static double micro_call_nanos(kernel_run_t run, void* data)
+{
+  size_t calls = 1;
+
+  // Double the calls until a batch takes long enough to be timed
+  while(true)
+  {
+    uint64_t start = timer_nanos();
+
+    for(size_t index = 0; index < calls; index++) run(data);
+
+    uint64_t nanos = timer_nanos() - start;
+
+    if(nanos >= MICRO_TARGET_NANOS || calls >= (1UL << 30)) break;
+
+    calls *= 2;
+  }
+
+  double best = 0;
+
+  for(size_t rep = 0; rep < MICRO_REPS; rep++)
+  {
+    uint64_t start = timer_nanos();
+
+    for(size_t index = 0; index < calls; index++) run(data);
+
+    double nanos = (double) (timer_nanos() - start) / calls;
+
+    if(rep == 0 || nanos < best) best = nanos;
+  }
+  return best;
+}
+
+static float* streamA;
+static float* streamB;
+static float* streamC;
+
+/*
+ * The STREAM triad: a = b + scalar * c
+ *
+ * PARAMS
+ * - void* data | The amount of floats of every array (size_t*)
+ */
+static void stream_triad_run(void* data)
+{
+  size_t length = *(size_t*) data;
+
+  // The arrays are loaded once, so the loop is as tight as the loops of the kernels
+  float* arrayA = streamA;
+  const float* arrayB = streamB;
+  const float* arrayC = streamC;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    arrayA[index] = arrayB[index] + 3.0f * arrayC[index];
+  }
+}
+
+// The measured bandwidths of the triad, for every power of two of the footprint
+static double streamBandwidths[64];
+
+/*
+ * Measure the bandwidth of the triad with the same footprint as a kernel,
+ * so a kernel that fits in a cache is judged against the bandwidth of that cache
+ *
+ * RETURN (double bandwidth)
+ * - The bandwidth in GB/s
+ */
+static double stream_bandwidth(double bytes)
+{
+  size_t power = 0;
+
+  while(power < 63 && ((double) (1UL << (power + 1))) <= bytes) power++;
+
+  if(streamBandwidths[power] > 0) return streamBandwidths[power];
+
+  size_t length = (1UL << power) / (3 * sizeof(float));
+
+  if(length < 256) length = 256;
+
+  if(length > STREAM_LENGTH) length = STREAM_LENGTH;
+
+  // The triad reads two arrays and writes one, the write allocation is not counted (like STREAM)
+  streamBandwidths[power] = (3.0 * sizeof(float) * length) / micro_call_nanos(stream_triad_run, &length);
+
+  return streamBandwidths[power];
+}
+
+// The result of the peak kernel, so that the compiler keeps the work
+static volatile float peakSink;
+
+#define PEAK_ITERATIONS 1000000
+
+/*
+ * Eight independent multiply-add chains, which hide the latency of the operations
+ */
+static void peak_flops_run(void* data)
+{
+  float value0 = 1.0f, value1 = 1.1f, value2 = 1.2f, value3 = 1.3f;
+  float value4 = 1.4f, value5 = 1.5f, value6 = 1.6f, value7 = 1.7f;
+
+  const float multi = 0.999999f;
+  const float addit = 0.000001f;
+
+  for(size_t index = 0; index < PEAK_ITERATIONS; index++)
+  {
+    value0 = value0 * multi + addit;
+    value1 = value1 * multi + addit;
+    value2 = value2 * multi + addit;
+    value3 = value3 * multi + addit;
+    value4 = value4 * multi + addit;
+    value5 = value5 * multi + addit;
+    value6 = value6 * multi + addit;
+    value7 = value7 * multi + addit;
+  }
+  peakSink = value0 + value1 + value2 + value3 + value4 + value5 + value6 + value7;
+}
+
+/*
+ * Create the operands of a kernel of a size
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to allocate the operands
+ */
+static int micro_data_create(MicroData* data, kernel_shape_t shape, size_t size)
+{
+  memset(data, 0, sizeof(MicroData));
+
+  data->size = size;
+
+  data->vector1 = float_vector_random_create(size, -1.0f, +1.0f);
+  data->vector2 = float_vector_random_create(size, -1.0f, +1.0f);
+  data->vector3 = float_vector_create(size);
+
+  if(data->vector1 == NULL || data->vector2 == NULL || data->vector3 == NULL) return 1;
+
+  if(shape == KERNEL_MATRIX)
+  {
+    data->matrix1 = float_matrix_random_create(size, size, -1.0f, +1.0f);
+    data->matrix2 = float_matrix_random_create(size, size, -1.0f, +1.0f);
+    data->matrix3 = float_matrix_create(size, size);
+
+    if(data->matrix1 == NULL || data->matrix2 == NULL || data->matrix3 == NULL) return 1;
+  }
+
+  if(shape == KERNEL_MATARR)
+  {
+    data->matarr1 = float_matarr_create(MATARR_AMOUNT, size, size);
+    data->matarr2 = float_matarr_create(MATARR_AMOUNT, size, size);
+    data->matarr3 = float_matarr_create(MATARR_AMOUNT, size, size);
+
+    if(data->matarr1 == NULL || data->matarr2 == NULL || data->matarr3 == NULL) return 1;
+  }
+  return 0; // Success!
+}
+
+static void micro_data_free(MicroData* data)
+{
+  size_t size = data->size;
+
+  float_vector_free(&data->vector1, size);
+  float_vector_free(&data->vector2, size);
+  float_vector_free(&data->vector3, size);
+
+  float_matrix_free(&data->matrix1, size, size);
+  float_matrix_free(&data->matrix2, size, size);
+  float_matrix_free(&data->matrix3, size, size);
+
+  float_matarr_free(&data->matarr1, MATARR_AMOUNT, size, size);
+  float_matarr_free(&data->matarr2, MATARR_AMOUNT, size, size);
+  float_matarr_free(&data->matarr3, MATARR_AMOUNT, size, size);
+}
+
+/*
+ * Measure every size of a kernel and print it against the roofline
+ */
+static void micro_kernel_print(const MicroKernel* kernel, double peakGflops)
+{
+  const size_t* sizes;
+  size_t sizeAmount;
+
+  switch(kernel->shape)
+  {
+    case KERNEL_VECTOR: sizes = vectorSizes; sizeAmount = sizeof(vectorSizes) / sizeof(size_t); break;
+    case KERNEL_MATRIX: sizes = matrixSizes; sizeAmount = sizeof(matrixSizes) / sizeof(size_t); break;
+    default:            sizes = matarrSizes; sizeAmount = sizeof(matarrSizes) / sizeof(size_t); break;
+  }
+
+  for(size_t index = 0; index < sizeAmount; index++)
+  {
+    size_t size = sizes[index];
+
+    MicroData data;
+
+    if(micro_data_create(&data, kernel->shape, size) != 0)
+    {
+      error_print("Failed to create the operands of %s %ld", kernel->name, size);
+
+      micro_data_free(&data);
+
+      continue;
+    }
+
+    double nanos = micro_call_nanos(kernel->run, &data);
+
+    double elements = (kernel->shape == KERNEL_VECTOR) ? size : ((double) size * size);
+
+    if(kernel->shape == KERNEL_MATARR) elements *= MATARR_AMOUNT;
+
+    double flops = kernel->flops * elements;
+    double bytes = kernel->bytes * elements + kernel->vectorBytes * size;
+
+    double gflops = flops / nanos;
+    double gbytes = bytes / nanos;
+
+    double intensity = bytes > 0 ? (flops / bytes) : 0;
+
+    double bandwidth = stream_bandwidth(bytes);
+
+    // The roofline is the lower of the compute roof and the memory roof at the intensity,
+    // a kernel without flops is judged against the bandwidth instead
+    double roof = (flops > 0) ? fmin(peakGflops, intensity * bandwidth) : bandwidth;
+
+    double achieved = (flops > 0) ? gflops : gbytes;
+
+    printf("%-22s %8ld : %12.1f ns/op | %7.3f GFLOP/s | %7.3f GB/s | %5.3f FLOP/B | %5.1f%% of roofline (%.3f GB/s)\n",
+      kernel->name, size, nanos, gflops, gbytes, intensity, (roof > 0) ? (100 * achieved / roof) : 0, bandwidth);
+
+    micro_data_free(&data);
+  }
+}
+
+/*
+ * Benchmark every secure kernel over a sweep of sizes, against a measured roofline
+ *
+ * ./microbench [KERNEL]
+ *
+ * The roofline is measured with the same compile flags as the kernels:
+ * the memory roof with the STREAM triad, and the compute roof with independent multiply-adds.
+ * Every kernel is judged against the bandwidth of a triad with the same footprint,
+ * so the small sizes that fit in a cache get the roof of that cache
+ */
+int main(int argc, char* argv[])
+{
+  srand(420);
+
+  // The kernels are timed with the blocking that the networks use
+  if(secure_blocking_init("../assets/.cache/blocking.txt") != 0) error_print("secure_blocking_init");
+
+  const char* kernelName = (argc >= 2) ? argv[1] : NULL;
+
+  streamA = float_vector_create(STREAM_LENGTH);
+  streamB = float_vector_random_create(STREAM_LENGTH, -1.0f, +1.0f);
+  streamC = float_vector_random_create(STREAM_LENGTH, -1.0f, +1.0f);
+
+  if(streamA == NULL || streamB == NULL || streamC == NULL)
+  {
+    error_print("Failed to create the STREAM arrays");
+
+    return 1;
+  }
+
+  double bandwidth = stream_bandwidth(3.0 * sizeof(float) * STREAM_LENGTH);
+
+  double peakGflops = (2.0 * 8 * PEAK_ITERATIONS) / micro_call_nanos(peak_flops_run, NULL);
+
+  printf("Roofline: memory %.3f GB/s (STREAM triad) | compute %.3f GFLOP/s (multiply-add) | ridge %.3f FLOP/B\n",
+    bandwidth, peakGflops, peakGflops / bandwidth);
+
+  printf("Cached:  ");
+
+  for(size_t kilos = 16; kilos <= 16384; kilos *= 4)
+  {
+    printf(" %ld KB %.3f GB/s |", kilos, stream_bandwidth(kilos * 1024.0));
+  }
+  printf("\n");
+
+  for(size_t index = 0; index < kernelAmount; index++)
+  {
+    if(kernelName != NULL && strcmp(kernelName, kernels[index].name)) continue;
+
+    micro_kernel_print(&kernels[index], peakGflops);
+  }
+  float_vector_free(&streamA, STREAM_LENGTH);
+  float_vector_free(&streamB, STREAM_LENGTH);
+  float_vector_free(&streamC, STREAM_LENGTH);
+
+  return 0;
+}
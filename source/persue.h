@@ -34,21 +34,287 @@ typedef struct
   float momentum;       // The momentum
 } Network;
 
+typedef struct
+{
+  size_t weights; // The bytes of the weights, with the row pointers
+  size_t biases;  // The bytes of the biases
+  size_t deltas;  // The bytes of the momentum deltas of the weights and biases
+  size_t layers;  // The bytes of the layer structs
+  size_t total;   // The bytes of the whole network
+} NetworkMemory;
+
+// This is the maximum amount of threads of a pool
+#define POOL_THREADS 64
+
+// A task of a pool job, which is called with the index of the task and the index of the thread
+typedef void (*pool_task_t)(size_t index, size_t thread, void* data);
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct
+{
+  ThreadPool* pool; // The pool that the worker belongs to
+  size_t thread;    // The index of the thread (the calling thread is 0)
+  pthread_t handle; // The handle of the thread
+} PoolWorker;
+
+struct ThreadPool
+{
+  size_t threads;                     // The amount of threads, including the calling thread
+  bool pinned;                        // If every thread is pinned to its own processor
+  void* oldAffinity;                  // The affinity of the calling thread before it was pinned (cpu_set_t)
+  PoolWorker workers[POOL_THREADS];   // The worker threads (index 0 is unused)
+  pthread_mutex_t mutex;              // The mutex of the fields below
+  pthread_cond_t startCond;           // Signaled when a job is started or the pool is stopped
+  pthread_cond_t doneCond;            // Signaled when every worker is done with the job
+  size_t generation;                  // The number of the current job
+  size_t running;                     // The amount of workers that are still working on the job
+  bool stopping;                      // If the workers should stop
+  pool_task_t task;                   // The task of the current job
+  void* data;                         // The data of the current job
+  size_t amount;                      // The amount of tasks of the current job
+  size_t next;                        // The index of the next task to claim
+};
+
+// This is the maximum amount of configurations that the tuner tries
+#define TUNE_TRIALS 64
+
+typedef struct
+{
+  size_t bsize;             // The batch size
+  size_t threads;           // The amount of threads
+  double samplesPerSecond;  // The amount of samples trained per second
+} TuneTrial;
+
+typedef struct
+{
+  size_t trialAmount;             // The amount of tried configurations
+  TuneTrial trials[TUNE_TRIALS];  // Every tried configuration
+  TuneTrial best;                 // The configuration with the most samples per second
+} TuneResult;
+
+// This are identifiers for the phases of a training step
+typedef enum { PHASE_VALUES, PHASE_DERIVS, PHASE_GRADIENT, PHASE_UPDATE, PHASE_COST, PHASE_AMOUNT } phase_t;
+
+// This is the amount of layers that are timed one by one, the rest are only timed in total
+#define STATS_LAYERS 16
+
+typedef struct
+{
+  size_t epoch;                         // The number of the epoch
+  size_t steps;                         // The amount of training steps (samples or batches)
+  size_t samples;                       // The amount of samples
+  size_t layers;                        // The amount of layers that were timed
+  size_t bsize;                         // The batch size (0 if the network was trained stochastically)
+  size_t sums;                          // The amount of thread sums of the batch derivatives (one per used thread and batch)
+  uint64_t epochNanos;                  // The total time of the epoch
+  uint64_t allocations;                 // The amount of secure allocations (only if secure_alloc_tracking is on)
+  uint64_t phaseNanos[PHASE_AMOUNT];    // The time of every phase
+  uint64_t forwardNanos[STATS_LAYERS];  // The time of every layer calculating node values
+  uint64_t backwardNanos[STATS_LAYERS]; // The time of every layer calculating node derivatives
+  uint64_t updateNanos[STATS_LAYERS];   // The time of every layer updating weights and biases
+} TrainStats;
+
+typedef struct
+{
+  size_t epoch;             // The number of the epoch
+  size_t step;              // The number of the step in the epoch (the amount of steps, for an epoch)
+  size_t samples;           // The amount of samples of the step or the epoch
+  float loss;               // The mean cost of the samples
+  uint64_t nanos;           // The time of the step or the epoch
+  double samplesPerSecond;  // The amount of samples trained per second
+  const TrainStats* stats;  // The timings of the phases and layers (only for epochs, else NULL)
+} TrainMetrics;
+
+typedef struct
+{
+  uint64_t flops; // The floating point operations
+  uint64_t bytes; // The bytes read from and written to memory
+} WorkCount;
+
+typedef struct
+{
+  size_t layers;                     // The amount of layers that were counted
+  WorkCount phases[PHASE_AMOUNT];    // The work of every phase
+  WorkCount forward[STATS_LAYERS];   // The work of every layer calculating node values
+  WorkCount backward[STATS_LAYERS];  // The work of every layer calculating node derivatives
+  WorkCount update[STATS_LAYERS];    // The work of every layer updating weights and biases
+} TrainWork;
+
+// This is the signature of a function that receives the metrics of a training step or epoch,
+// it returns 0 to go on, OBSERVE_STOP to stop the training, or any other value as an error
+typedef int (*observe_t)(const Network* network, const TrainMetrics* metrics, void* data);
+
+#define OBSERVE_STOP -1
+
+// This is the maximum amount of observers that can be added at the same time
+#define TRAIN_OBSERVERS 8
+
+typedef struct
+{
+  observe_t step;  // The function called after every step, or NULL
+  observe_t epoch; // The function called after every epoch, or NULL
+  void* data;      // The data that is passed to the functions
+} TrainObserver;
+
+typedef struct
+{
+  ThreadPool* pool;   // The pool that the samples of every mini batch are spread over, or NULL
+  unsigned int seed;  // The seed of the random order of the samples
+} TrainOptions;
+
+typedef struct
+{
+  float** values;     // The node values of every layer, the inputs first (layers + 1 x maxSize)
+  float** derivs;     // The node derivatives of every layer (layers x maxSize)
+  float** transp;     // The transposed weights of the layer closer to the output (maxSize x maxSize)
+  float*** wderivs;   // The weight derivatives of one sample (layers x maxSize x maxSize)
+  float** bderivs;    // The bias derivatives of one sample (layers x maxSize)
+  float*** swderivs;  // The sum of the weight derivatives of the samples of the thread
+  float** sbderivs;   // The sum of the bias derivatives of the samples of the thread
+} ThreadWorkspace;
+
+// The buffers of the training steps, sized from the network, so a step does not allocate
+typedef struct
+{
+  size_t layers;            // The amount of layers that the buffers are sized for (0 if not created)
+  size_t maxSize;           // The most nodes of a layer or the inputs, the size of the matrices
+  size_t outputAmount;      // The amount of output nodes
+  size_t threads;           // The amount of thread workspaces
+  size_t bsize;             // The amount of samples that the outputs have room for
+  ThreadWorkspace* spaces;  // The buffers of every thread of the pool
+  float** twdeltas;         // The new weight deltas of a layer (maxSize x maxSize)
+  float** outputs;          // The outputs of every sample of a batch (bsize x outputs)
+} TrainWorkspace;
+
+typedef struct
+{
+  size_t threadSpaces;  // The bytes of the buffers of every thread workspace together
+  size_t shared;        // The bytes of the buffers that the threads share (weight deltas and batch outputs)
+  size_t pool;          // The bytes of the pool struct and the saved affinity
+  size_t stacks;        // The bytes of the stacks of the pool workers (the default stack size)
+  size_t total;         // The bytes of the whole training state
+} TrainMemory;
+
+// A trainer holds everything that a training changes besides the network,
+// so independent trainings can run at the same time with their own trainers
+typedef struct
+{
+  TrainOptions options;                             // The options of the training
+  float cost;                                       // The summed cost of the current step or epoch
+  unsigned int random;                              // The state of the random generator (rand_r)
+  const TrainObserver* observers[TRAIN_OBSERVERS];  // The observers that receive the metrics
+  size_t observerAmount;                            // The amount of observers
+  size_t stepperAmount;                             // The amount of observers with a step function
+  TrainStats stats;                                 // The stats of the current epoch, that the timers add to
+  TrainStats epochStats;                            // The stats of the last completed epoch
+  uint64_t epochStart;                              // The time that the current epoch started
+  uint64_t allocStart;                              // The amount of secure allocations when the current epoch started
+  TrainWorkspace workspace;                         // The buffers of the steps, created by the first step
+} Trainer;
+
+// This observer logs the loss and the throughput of every epoch
+extern const TrainObserver trainPrintObserver;
+
+// This observer sets the stats gauges (stats_server_start) to the metrics of every epoch
+extern const TrainObserver trainGaugeObserver;
+
+// This are identifiers for what a health monitor does when the network is broken
+typedef enum { HEALTH_NONE, HEALTH_ABORT, HEALTH_REINIT } health_action_t;
+
+typedef struct
+{
+  size_t nonFinite;        // The amount of NaN or infinite weights, biases and deltas
+  float saturatedFraction; // The fraction of the activations that are saturated, over the probes
+  float deadFraction;      // The fraction of the relu units that are active for no probe
+  float weightNorm;        // The norm of the weights and biases
+  float gradientNorm;      // The norm of the last deltas, divided by the learning rate
+} LayerHealth;
+
+typedef struct
+{
+  Network* network;                 // The network that is checked
+  float** probes;                   // The inputs that the activations are measured with
+  size_t probeAmount;               // The amount of probe inputs
+  size_t interval;                  // The amount of steps between every check
+  health_action_t action;           // What to do when the network is broken
+  unsigned int* random;             // The state of the random generator that re-initializes units (rand_r)
+  float deadLimit;                  // The fraction of dead units that makes a layer broken
+  size_t steps;                     // The amount of steps since the last check
+  size_t checks;                    // The amount of checks that have been done
+  size_t reinits;                   // The amount of units that have been re-initialized
+  size_t layerAmount;               // The amount of layers that were checked
+  LayerHealth layers[STATS_LAYERS]; // The health of every layer from the last check
+  TrainObserver observer;           // The observer that does the checks (train_observer_add)
+} HealthMonitor;
+
 extern int network_init(Network* network, size_t amount, const size_t* amounts, const activ_t* activs, float learnrate, float momentum);
 
 extern void network_free(Network* network);
 
 extern void network_print(Network network);
 
+extern int network_memory_usage(NetworkMemory* memory, Network network);
+
+extern void network_memory_print(const NetworkMemory* memory);
+
+extern int network_clone(Network* clone, Network network);
+
+extern int network_copy(Network* destin, Network source);
+
 extern int network_forward(float* outputs, Network network, const float* inputs);
 
-extern int network_train_stcast_epochs(Network* network, float** inputs, float** targets, size_t amount, size_t epochs);
+extern void network_forward_histo_set(Histogram* histo);
+
+extern int network_forward_batch(float** outputs, Network network, float** inputs, size_t amount, ThreadPool* pool);
+
+extern int trainer_init(Trainer* trainer, const TrainOptions* options);
+
+extern void trainer_free(Trainer* trainer);
+
+extern int train_memory_usage(TrainMemory* memory, const Trainer* trainer);
+
+extern void train_memory_print(const TrainMemory* memory);
+
+extern int network_train_stcast_epochs(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t epochs);
+
+extern int network_train_stcast(Trainer* trainer, Network* network, const float* inputs, const float* targets);
+
+extern int network_train_mini_batch(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount);
+
+extern int network_train_mini_batch_epochs(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t bsize, size_t epochs);
+
+extern int network_tune(TuneResult* result, Network network, float** inputs, float** targets, size_t amount, size_t maxThreads, uint64_t trialNanos);
+
+extern void network_tune_print(const TuneResult* result);
+
+extern int pool_init(ThreadPool* pool, size_t threads, bool pin);
+
+extern int pool_run(ThreadPool* pool, pool_task_t task, void* data, size_t amount);
+
+extern size_t pool_threads(const ThreadPool* pool);
+
+extern void pool_free(ThreadPool* pool);
+
+extern int train_observer_add(Trainer* trainer, const TrainObserver* observer);
+
+extern int train_observer_remove(Trainer* trainer, const TrainObserver* observer);
+
+extern int train_stats_get(const Trainer* trainer, TrainStats* stats);
+
+extern void train_stats_print(const TrainStats* stats);
+
+extern int train_work_count(TrainWork* work, Network network, const TrainStats* stats);
+
+extern void train_work_print(const TrainWork* work, const TrainStats* stats);
+
+extern int health_monitor_init(HealthMonitor* monitor, Network* network, float** probes, size_t probeAmount, size_t interval, health_action_t action, unsigned int* random);
 
-extern int network_train_stcast(Network* network, const float* inputs, const float* targets);
+extern int health_check(HealthMonitor* monitor);
 
-extern int network_train_mini_batch(Network* network, float** inputs, float** targets, size_t amount);
+extern int health_monitor_step(const Network* network, const TrainMetrics* metrics, void* data);
 
-extern int network_train_mini_batch_epochs(Network* network, float** inputs, float** targets, size_t amount, size_t bsize, size_t epochs);
+extern void health_print(const HealthMonitor* monitor);
 
 extern float cross_entropy_cost(const float* nodes, const float* targets, size_t amount);
 
@@ -85,37 +85,28 @@ static float* tanh_values(float* result, const float* values, size_t amount)
   return result;
 }
 
-static float** softmax_derivs(float** result, const float* values, size_t amount)
-{
-  if(result == NULL || values == NULL) return NULL;
-
-  for(size_t iIndex = 0; iIndex < amount; iIndex++)
-  {
-    for(size_t jIndex = 0; jIndex < amount; jIndex++)
-    {
-      if(iIndex == jIndex) result[iIndex][jIndex] = values[iIndex] * (1 - values[iIndex]);
-
-      else result[iIndex][jIndex] = -values[iIndex] * values[jIndex];
-    }
-  }
-  return result;
-}
-
 /*
  * Apply the derivatives of the softmax activation function
+ *
+ * The result is the Jacobian of the softmax times the values,
+ * J[i][j] = v[i] * (d[i][j] - v[j]), so the product is v[i] * (v[i] - S) where S is the sum of v[j]^2.
+ * The closed form is the same product as the whole Jacobian, without creating it
  */
 static float* softmax_derivs_apply(float* result, const float* values, size_t amount)
 {
   if(result == NULL || values == NULL) return NULL;
- 
-  float** derivs = float_matrix_create(amount, amount);
-
-  softmax_derivs(derivs, values, amount);
 
-  float_matrix_vector_dotprod(result, derivs, amount, amount, values);
+  float squares = 0.0f;
 
-  float_matrix_free(&derivs, amount, amount);
+  for(size_t index = 0; index < amount; index++)
+  {
+    squares += values[index] * values[index];
+  }
 
+  for(size_t index = 0; index < amount; index++)
+  {
+    result[index] = values[index] * (values[index] - squares);
+  }
   return result;
 }
 
@@ -0,0 +1,295 @@
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-network-intern.h"
+#include "p-stats-intern.h"
+
+// The work is counted from what the kernels do, not from the minimum that is needed.
+// The bytes are the arrays every kernel reads and writes, assuming that nothing is
+// reused from the cache between kernels. Allocating and zeroing memory is not counted.
+
+#define FLOAT_BYTES sizeof(float)
+
+// The floating point operations of every activation function, for every value
+// (exp, division and comparison count as one operation each)
+static const uint64_t activValueFlops[] = {
+  [ACTIV_NONE]    = 0,
+  [ACTIV_SIGMOID] = 4, // 1 / (1 + exp(-x))
+  [ACTIV_RELU]    = 1, // (x > 0) ? x : 0
+  [ACTIV_TANH]    = 7, // (exp(2x) - 1) / (exp(2x) + 1)
+  [ACTIV_SOFTMAX] = 4  // exp(x) added to the sum, then exp(x) / sum
+};
+
+// The floating point operations of applying every activation derivative, for every value
+static const uint64_t activDerivFlops[] = {
+  [ACTIV_NONE]    = 0,
+  [ACTIV_SIGMOID] = 3, // d *= v * (1 - v)
+  [ACTIV_RELU]    = 2, // d *= (v > 0) ? 1 : 0
+  [ACTIV_TANH]    = 3, // d *= 1 - v * v
+  [ACTIV_SOFTMAX] = 0  // The whole jacobian is created, see work_activ_derivs
+};
+
+static void work_add(WorkCount* work, uint64_t flops, uint64_t bytes)
+{
+  work->flops += flops;
+  work->bytes += bytes;
+}
+
+static void work_scaled_add(WorkCount* result, const WorkCount* work, uint64_t scalor)
+{
+  result->flops += (work->flops * scalor);
+  result->bytes += (work->bytes * scalor);
+}
+
+/*
+ * The work of float_matrix_vector_dotprod, that sums into a temporary vector and copies it
+ */
+static void work_matrix_vector(WorkCount* work, size_t height, size_t width)
+{
+  work_add(work, 2 * height * width, FLOAT_BYTES * (height * width + width + 3 * height));
+}
+
+/*
+ * The work of activ_values
+ */
+static void work_activ_values(WorkCount* work, size_t amount, activ_t activ)
+{
+  if(activ == ACTIV_NONE) return;
+
+  work_add(work, activValueFlops[activ] * amount, FLOAT_BYTES * 2 * amount);
+}
+
+/*
+ * The work of activ_derivs_apply
+ */
+static void work_activ_derivs(WorkCount* work, size_t amount, activ_t activ)
+{
+  if(activ == ACTIV_NONE) return;
+
+  if(activ == ACTIV_SOFTMAX)
+  {
+    // The jacobian (amount x amount) is filled, and then multiplied with the values
+    work_add(work, 2 * amount * amount, FLOAT_BYTES * (amount * amount + amount));
+
+    work_matrix_vector(work, amount, amount);
+  }
+  else work_add(work, activDerivFlops[activ] * amount, FLOAT_BYTES * 3 * amount);
+}
+
+/*
+ * The work of one layer in node_values_create and network_forward, for one sample
+ */
+static void work_layer_forward(WorkCount* work, size_t height, size_t width, activ_t activ)
+{
+  work_matrix_vector(work, height, width);
+
+  // Adding the biases
+  work_add(work, height, FLOAT_BYTES * 3 * height);
+
+  work_activ_values(work, height, activ);
+}
+
+/*
+ * The work of one layer in node_derivs_create, for one sample
+ */
+static void work_layer_backward(WorkCount* work, Network network, size_t index)
+{
+  NetworkLayer layer = network.layers[index];
+
+  if(index == network.amount - 1)
+  {
+    // The derivatives of the cost: 2 * (node - target)
+    work_add(work, 2 * layer.amount, FLOAT_BYTES * 3 * layer.amount);
+  }
+  else
+  {
+    size_t height = network.layers[index + 1].amount;
+    size_t width = layer.amount;
+
+    // Transposing the weights of the layer closer to the output
+    work_add(work, 0, FLOAT_BYTES * 2 * height * width);
+
+    work_matrix_vector(work, width, height);
+  }
+  work_activ_derivs(work, layer.amount, layer.activ);
+}
+
+/*
+ * The work of one layer in weight_bias_deltas_from_derivs_create and
+ * of adding the deltas to the weights and biases, for one step
+ */
+static void work_layer_update(WorkCount* work, size_t height, size_t width)
+{
+  size_t length = (height * width + height);
+
+  // Scaling the derivatives, scaling the old deltas and adding them
+  work_add(work, 3 * length, FLOAT_BYTES * 7 * length);
+
+  // Adding the deltas to the weights and biases
+  work_add(work, length, FLOAT_BYTES * 3 * length);
+}
+
+/*
+ * Count the floating point operations and the bytes moved by a training epoch
+ *
+ * The work is calculated from the topology of the network and the amount of
+ * samples and steps of the epoch, the layers are counted the same way they are timed:
+ * - forward  | Every sample, calculating the node values
+ * - backward | Every sample, calculating the node derivatives
+ * - update   | Every step, creating the deltas and adding them
+ *
+ * Note: The amount of samples and steps are only counted if PERSUE_TIMERS is defined
+ *
+ * PARAMS
+ * - TrainWork* work         | The counted work
+ * - Network network         | The network that was trained
+ * - const TrainStats* stats | The stats of the epoch (train_stats_get)
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int train_work_count(TrainWork* work, Network network, const TrainStats* stats)
+{
+  if(work == NULL || stats == NULL || network.amount <= 0) return 1;
+
+  memset(work, 0, sizeof(TrainWork));
+
+  work->layers = (network.amount < STATS_LAYERS) ? network.amount : STATS_LAYERS;
+
+  uint64_t samples = stats->samples;
+  uint64_t steps = stats->steps;
+
+  // The work of one sample (forward, backward and gradient) and of one step (update)
+  WorkCount forward = {0}, backward = {0}, gradient = {0}, update = {0};
+
+  size_t width = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    NetworkLayer layer = network.layers[index];
+
+    size_t height = layer.amount;
+
+    WorkCount layerForward = {0}, layerBackward = {0}, layerUpdate = {0};
+
+    work_layer_forward(&layerForward, height, width, layer.activ);
+
+    work_layer_backward(&layerBackward, network, index);
+
+    work_layer_update(&layerUpdate, height, width);
+
+    // The weight derivatives (outer product) and copying the bias derivatives
+    work_add(&gradient, height * width, FLOAT_BYTES * (height * width + height + width));
+    work_add(&gradient, 0, FLOAT_BYTES * 2 * height);
+
+    if(index < STATS_LAYERS)
+    {
+      work_scaled_add(&work->forward[index], &layerForward, samples);
+      work_scaled_add(&work->backward[index], &layerBackward, samples);
+      work_scaled_add(&work->update[index], &layerUpdate, steps);
+    }
+
+    work_scaled_add(&forward, &layerForward, 1);
+    work_scaled_add(&backward, &layerBackward, 1);
+    work_scaled_add(&update, &layerUpdate, 1);
+
+    width = layer.amount;
+  }
+
+  work_scaled_add(&work->phases[PHASE_VALUES], &forward, samples);
+  work_scaled_add(&work->phases[PHASE_DERIVS], &backward, samples);
+  work_scaled_add(&work->phases[PHASE_GRADIENT], &gradient, samples);
+  work_scaled_add(&work->phases[PHASE_UPDATE], &update, steps);
+
+  if(stats->bsize > 0)
+  {
+    // The mini batch only sums and scales the part of every matrix that the layers use
+    uint64_t length = 0;
+
+    width = network.inputs;
+
+    for(size_t index = 0; index < network.amount; index++)
+    {
+      length += network.layers[index].amount * (width + 1);
+
+      width = network.layers[index].amount;
+    }
+    uint64_t sums = stats->sums;
+
+    // Every sample is added to the sum of its thread, and every used thread set its sum to zero
+    work_add(&work->phases[PHASE_GRADIENT], samples * length, samples * FLOAT_BYTES * 3 * length);
+    work_add(&work->phases[PHASE_GRADIENT], 0, sums * FLOAT_BYTES * length);
+
+    // The sums of the used threads are added together, then scaled by the batch size
+    uint64_t reduced = (sums > steps) ? (sums - steps) : 0;
+
+    work_add(&work->phases[PHASE_GRADIENT], reduced * length, reduced * FLOAT_BYTES * 3 * length);
+    work_add(&work->phases[PHASE_GRADIENT], steps * length, steps * FLOAT_BYTES * 2 * length);
+  }
+
+  // The cost is calculated with a new forward pass of every sample
+  size_t outputs = network.layers[network.amount - 1].amount;
+
+  work_scaled_add(&work->phases[PHASE_COST], &forward, samples);
+  work_add(&work->phases[PHASE_COST], samples * (3 * outputs + 1), samples * FLOAT_BYTES * 2 * outputs);
+
+  return 0; // Success!
+}
+
+/*
+ * Print the work per nanosecond, as GFLOP/s and GB/s
+ */
+static void work_rate_print(const char* name, const WorkCount* work, uint64_t nanos)
+{
+  double gflops = (nanos > 0) ? ((double) work->flops / nanos) : 0;
+  double gbytes = (nanos > 0) ? ((double) work->bytes / nanos) : 0;
+
+  // The arithmetic intensity says if the work is bound by compute or by bandwidth
+  double intensity = (work->bytes > 0) ? ((double) work->flops / work->bytes) : 0;
+
+  printf("%s %8.3f GFLOP/s %8.3f GB/s (%.3f FLOP/B)", name, gflops, gbytes, intensity);
+}
+
+/*
+ * Print the achieved GFLOP/s and GB/s of every phase and layer of a training epoch
+ */
+void train_work_print(const TrainWork* work, const TrainStats* stats)
+{
+  if(work == NULL || stats == NULL) return;
+
+  WorkCount total = {0};
+
+  for(size_t phase = 0; phase < PHASE_AMOUNT; phase++)
+  {
+    work_scaled_add(&total, &work->phases[phase], 1);
+  }
+
+  printf("Work #%02ld: %.3f GFLOP %.3f GB :", stats->epoch, (double) total.flops / 1e9, (double) total.bytes / 1e9);
+
+  work_rate_print("", &total, stats->epochNanos);
+
+  printf("\n");
+
+  for(size_t phase = 0; phase < PHASE_AMOUNT; phase++)
+  {
+    printf("  %-8s :", phaseNames[phase]);
+
+    work_rate_print("", &work->phases[phase], stats->phaseNanos[phase]);
+
+    printf("\n");
+  }
+
+  size_t layers = (work->layers < stats->layers) ? work->layers : stats->layers;
+
+  for(size_t layer = 0; layer < layers; layer++)
+  {
+    printf("  layer %02ld :", layer);
+
+    work_rate_print(" forward", &work->forward[layer], stats->forwardNanos[layer]);
+    work_rate_print(" | backward", &work->backward[layer], stats->backwardNanos[layer]);
+    work_rate_print(" | update", &work->update[layer], stats->updateNanos[layer]);
+
+    printf("\n");
+  }
+}
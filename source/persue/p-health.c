@@ -0,0 +1,344 @@
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-activs-intern.h"
+#include "p-network-intern.h"
+
+// An activation this close to the limits of sigmoid or tanh has (almost) no gradient
+#define SATURATED_MARGIN 0.01f
+
+/*
+ * Count the values that are NaN or infinite
+ *
+ * (value - value) is 0 for every finite value and NaN otherwise,
+ * which keeps the loop free of branches and library calls
+ */
+static size_t float_vector_nonfinite_count(const float* vector, size_t length)
+{
+  size_t count = 0;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    count += ((vector[index] - vector[index]) != 0.0f);
+  }
+  return count;
+}
+
+/*
+ * Sum the squares of the values
+ */
+static double float_vector_square_sum(const float* vector, size_t length)
+{
+  float sum = 0.0f;
+
+  for(size_t index = 0; index < length; index++)
+  {
+    sum += (vector[index] * vector[index]);
+  }
+  return sum;
+}
+
+/*
+ * Check if an activation value has (almost) no gradient
+ *
+ * A saturated sigmoid or tanh unit can be right, like an output unit that fits black and white targets,
+ * so only a relu unit is dead when it is saturated for every probe (it is active for none of them)
+ */
+static bool activ_value_saturated(float value, activ_t activ)
+{
+  switch(activ)
+  {
+    case ACTIV_RELU: return (value <= 0.0f);
+
+    case ACTIV_SIGMOID: return (value < SATURATED_MARGIN || value > (1.0f - SATURATED_MARGIN));
+
+    case ACTIV_TANH: return (value < (-1.0f + SATURATED_MARGIN) || value > (1.0f - SATURATED_MARGIN));
+
+    default: return false;
+  }
+}
+
+/*
+ * Initialize a monitor that checks the health of a network while it is training
+ *
+ * Every interval steps, the monitor checks every layer for:
+ * - NaN or infinite weights, biases and deltas
+ * - Saturated units (sigmoid or tanh near their limits, relu at 0), over the probe inputs
+ * - Dead relu units, that are active for no probe input (saturated sigmoid or tanh units are only reported)
+ * - The norm of the weights and of the gradient (the last deltas / the learning rate)
+ *
+ * PARAMS
+ * - HealthMonitor* monitor | The pointer to the HealthMonitor struct
+ * - Network* network       | The network that is going to be trained
+ * - float** probes         | The inputs that the activations are measured with (kept, not copied)
+ * - size_t probeAmount     | The amount of probe inputs
+ * - size_t interval        | The amount of steps between every check
+ * - health_action_t action | What to do when the network is broken
+ * - unsigned int* random   | The state of the random generator of the trainer (&trainer.random),
+ *                            so the re-initialized units follow from the seed of the training
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int health_monitor_init(HealthMonitor* monitor, Network* network, float** probes, size_t probeAmount, size_t interval, health_action_t action, unsigned int* random)
+{
+  if(monitor == NULL || network == NULL || probes == NULL || probeAmount <= 0 || interval <= 0 || random == NULL) return 1;
+
+  memset(monitor, 0, sizeof(HealthMonitor));
+
+  monitor->network = network;
+  monitor->probes = probes;
+  monitor->probeAmount = probeAmount;
+  monitor->interval = interval;
+  monitor->action = action;
+  monitor->random = random;
+
+  // A layer is broken when every relu unit of it is dead
+  monitor->deadLimit = 1.0f;
+
+  monitor->observer = (TrainObserver) { .step = health_monitor_step, .epoch = NULL, .data = monitor };
+
+  return 0; // Success!
+}
+
+/*
+ * Re-initialize a dead relu unit, like network_layer_init does, and forget its momentum
+ *
+ * The bias is made positive, so that a relu unit starts out active
+ */
+static void layer_unit_reinit(NetworkLayer* layer, size_t unit, size_t width, unsigned int* random)
+{
+  for(size_t index = 0; index < width; index++)
+  {
+    layer->weights[unit][index] = float_random_seed_create(-1.0f, +1.0f, random);
+
+    layer->wdeltas[unit][index] = 0.0f;
+  }
+  layer->biases[unit] = float_random_seed_create(0.0f, +1.0f, random);
+
+  layer->bdeltas[unit] = 0.0f;
+}
+
+/*
+ * Measure the saturated and dead units of every layer, by a forward pass of every probe input
+ *
+ * PARAMS
+ * - bool** dead | Every unit of every layer, set to true if it is a relu unit that is active for no probe
+ */
+static void health_activations_check(HealthMonitor* monitor, bool** dead)
+{
+  Network network = *monitor->network;
+
+  size_t maxSize = network_max_layer_nodes(network);
+
+  float values[maxSize];
+
+  size_t saturated[network.amount];
+  memset(saturated, 0, sizeof(saturated));
+
+  // Only relu units can be dead
+  for(size_t layer = 0; layer < network.amount; layer++)
+  {
+    memset(dead[layer], network.layers[layer].activ == ACTIV_RELU, sizeof(bool) * network.layers[layer].amount);
+  }
+
+  for(size_t probe = 0; probe < monitor->probeAmount; probe++)
+  {
+    float_vector_copy(values, monitor->probes[probe], network.inputs);
+
+    size_t width = network.inputs;
+
+    for(size_t layer = 0; layer < network.amount; layer++)
+    {
+      NetworkLayer current = network.layers[layer];
+
+      float_matrix_vector_dotprod(values, current.weights, current.amount, width, values);
+
+      float_vector_elem_addit(values, values, current.biases, current.amount);
+
+      activ_values(values, values, current.amount, current.activ);
+
+      for(size_t unit = 0; unit < current.amount; unit++)
+      {
+        bool unitSaturated = activ_value_saturated(values[unit], current.activ);
+
+        saturated[layer] += unitSaturated;
+
+        dead[layer][unit] &= unitSaturated;
+      }
+      width = current.amount;
+    }
+  }
+
+  for(size_t layer = 0; layer < network.amount && layer < STATS_LAYERS; layer++)
+  {
+    size_t amount = network.layers[layer].amount;
+
+    size_t deadAmount = 0;
+
+    for(size_t unit = 0; unit < amount; unit++) deadAmount += dead[layer][unit];
+
+    monitor->layers[layer].saturatedFraction = (float) saturated[layer] / (amount * monitor->probeAmount);
+
+    monitor->layers[layer].deadFraction = (float) deadAmount / amount;
+  }
+}
+
+/*
+ * Check the health of the network of a monitor, and act on what is found
+ *
+ * A layer is only acted on when the fraction of dead units reaches the dead limit,
+ * then the dead units are re-initialized (HEALTH_REINIT) or the layer is reported as broken
+ *
+ * RETURN (int status)
+ * - 0 | The network is healthy (or every dead unit was re-initialized)
+ * - 1 | The inputted arguments are bad
+ * - 2 | The network has NaN or infinite values
+ * - 3 | A layer has at least the limit of dead units
+ */
+int health_check(HealthMonitor* monitor)
+{
+  if(monitor == NULL || monitor->network == NULL) return 1;
+
+  Network* network = monitor->network;
+
+  monitor->checks++;
+
+  int status = 0;
+
+  size_t width = network->inputs;
+
+  for(size_t layer = 0; layer < network->amount; layer++)
+  {
+    NetworkLayer current = network->layers[layer];
+
+    size_t nonFinite = float_vector_nonfinite_count(current.biases, current.amount) +
+      float_vector_nonfinite_count(current.bdeltas, current.amount);
+
+    double weightSquares = float_vector_square_sum(current.biases, current.amount);
+    double deltaSquares = float_vector_square_sum(current.bdeltas, current.amount);
+
+    for(size_t unit = 0; unit < current.amount; unit++)
+    {
+      nonFinite += float_vector_nonfinite_count(current.weights[unit], width) +
+        float_vector_nonfinite_count(current.wdeltas[unit], width);
+
+      weightSquares += float_vector_square_sum(current.weights[unit], width);
+      deltaSquares += float_vector_square_sum(current.wdeltas[unit], width);
+    }
+
+    if(layer < STATS_LAYERS)
+    {
+      monitor->layers[layer].nonFinite = nonFinite;
+      monitor->layers[layer].weightNorm = sqrt(weightSquares);
+      monitor->layers[layer].gradientNorm = (network->learnrate > 0) ? (sqrt(deltaSquares) / network->learnrate) : 0;
+    }
+
+    if(nonFinite > 0)
+    {
+      log_error("Layer %ld has %ld NaN or infinite values", layer, nonFinite);
+
+      status = 2;
+    }
+    width = current.amount;
+  }
+  monitor->layerAmount = (network->amount < STATS_LAYERS) ? network->amount : STATS_LAYERS;
+
+  // The activations can not be trusted if the values are not finite
+  if(status != 0) return status;
+
+  size_t maxSize = network_max_layer_nodes(*network);
+
+  bool deadUnits[network->amount][maxSize];
+
+  bool* dead[network->amount];
+
+  for(size_t layer = 0; layer < network->amount; layer++) dead[layer] = deadUnits[layer];
+
+  health_activations_check(monitor, dead);
+
+  width = network->inputs;
+
+  for(size_t layer = 0; layer < monitor->layerAmount; layer++)
+  {
+    NetworkLayer* current = &network->layers[layer];
+
+    float deadFraction = monitor->layers[layer].deadFraction;
+
+    if(deadFraction >= monitor->deadLimit && monitor->action == HEALTH_REINIT)
+    {
+      size_t reinits = 0;
+
+      for(size_t unit = 0; unit < current->amount; unit++)
+      {
+        if(!dead[layer][unit]) continue;
+
+        layer_unit_reinit(current, unit, width, monitor->random);
+
+        reinits++;
+      }
+      monitor->reinits += reinits;
+
+      log_warn("Layer %ld: re-initialized %ld dead units", layer, reinits);
+    }
+    else if(deadFraction >= monitor->deadLimit)
+    {
+      log_error("Layer %ld: %.0f%% of the units are dead", layer, 100 * deadFraction);
+
+      status = 3;
+    }
+    width = current->amount;
+  }
+  return status;
+}
+
+/*
+ * Check the health every interval steps
+ *
+ * This function is the step function of the observer of the monitor, add it with train_observer_add(trainer, &monitor->observer).
+ * If the action is HEALTH_ABORT, the training is stopped when the network is broken
+ */
+int health_monitor_step(const Network* network, const TrainMetrics* metrics, void* data)
+{
+  HealthMonitor* monitor = data;
+
+  if(monitor == NULL || metrics == NULL) return 1;
+
+  if(++monitor->steps < monitor->interval) return 0;
+
+  monitor->steps = 0;
+
+  int status = health_check(monitor);
+
+  if(status == 0 || status == 1) return status;
+
+  if(monitor->action == HEALTH_NONE) return 0;
+
+  // The values can not be repaired, so only aborting helps
+  if(monitor->action == HEALTH_ABORT || status == 2)
+  {
+    log_error("Stopping the training (epoch: #%ld step: #%ld)", metrics->epoch, metrics->step);
+
+    return OBSERVE_STOP;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Print the health of every layer from the last check
+ */
+void health_print(const HealthMonitor* monitor)
+{
+  if(monitor == NULL) return;
+
+  printf("Health: %ld checks, %ld re-initialized units\n", monitor->checks, monitor->reinits);
+
+  for(size_t layer = 0; layer < monitor->layerAmount; layer++)
+  {
+    const LayerHealth* health = &monitor->layers[layer];
+
+    printf("  layer %02ld : non-finite %ld | saturated %5.1f%% | dead %5.1f%% | weight norm %.3f | gradient norm %.3f\n", layer,
+      health->nonFinite, 100 * health->saturatedFraction, 100 * health->deadFraction, health->weightNorm, health->gradientNorm);
+  }
+}
@@ -1,5 +1,6 @@
 #include "../persue.h"
 #include "p-activs-intern.h"
+#include "p-stats-intern.h"
 
 size_t network_max_layer_nodes(Network network)
 {
@@ -14,10 +15,32 @@ size_t network_max_layer_nodes(Network network)
   return maxSize;
 }
 
+// The histogram that the latency of every forward pass is recorded to, or NULL
+static Histogram* forwardHisto = NULL;
+
+/*
+ * Record the latency of every call to network_forward in a histogram, from every thread
+ *
+ * PARAMS
+ * - Histogram* histo | The initialized histogram, or NULL to stop recording
+ */
+void network_forward_histo_set(Histogram* histo)
+{
+  __atomic_store_n(&forwardHisto, histo, __ATOMIC_RELEASE);
+}
+
 int network_forward(float* outputs, Network network, const float* inputs)
 {
   if(outputs == NULL || inputs == NULL) return 1;
 
+  Histogram* histo = __atomic_load_n(&forwardHisto, __ATOMIC_ACQUIRE);
+
+  uint64_t start = (histo != NULL) ? timer_nanos() : 0;
+
+  PERF_REGION_BEGIN(REGION_INFERENCE);
+
+  TRACE_DETAIL_BEGIN("inference", "forward", NULL, 0);
+
   size_t maxSize = network_max_layer_nodes(network);
 
   float toutputs[maxSize];
@@ -30,6 +53,9 @@ int network_forward(float* outputs, Network network, const float* inputs)
 
   for(size_t index = 0; index < network.amount; index++)
   {
+    // The layers of the inference are counted apart from the forward pass of the training
+    PERF_REGION_BEGIN(REGION_LAYER(inference, index));
+
     NetworkLayer layer = network.layers[index];
 
     size_t height = layer.amount;
@@ -42,13 +68,69 @@ int network_forward(float* outputs, Network network, const float* inputs)
 
     // The width of the next layer is the height of this layer
     width = layer.amount;
+
+    PERF_REGION_END(REGION_LAYER(inference, index));
   }
   // Width is the size of the last layer (output layer)
   outputs = float_vector_copy(outputs, toutputs, width);
 
+  TRACE_DETAIL_END("inference", "forward");
+
+  PERF_REGION_END(REGION_INFERENCE);
+
+  if(histo != NULL) histo_record(histo, timer_nanos() - start);
+
   return 0; // Success
 }
 
+typedef struct
+{
+  float** outputs;  // The outputs of every sample
+  Network network;  // The neural network
+  float** inputs;   // The inputs of every sample
+} ForwardJob;
+
+/*
+ * Run the forward pass of one sample of a batch
+ */
+static void forward_task(size_t index, size_t thread, void* data)
+{
+  (void) thread;
+
+  ForwardJob* job = data;
+
+  network_forward(job->outputs[index], job->network, job->inputs[index]);
+}
+
+/*
+ * Run the forward pass of a batch of samples, spread over the threads of a pool
+ *
+ * PARAMS
+ * - float** outputs  | The outputs of every sample (amount x output nodes)
+ * - Network network  | The neural network
+ * - float** inputs   | The inputs of every sample (amount x input nodes)
+ * - size_t amount    | The amount of samples
+ * - ThreadPool* pool | The pool, or NULL to run every sample on the calling thread
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int network_forward_batch(float** outputs, Network network, float** inputs, size_t amount, ThreadPool* pool)
+{
+  if(outputs == NULL || inputs == NULL) return 1;
+
+  ForwardJob job = {
+    .outputs = outputs,
+    .network = network,
+    .inputs = inputs
+  };
+
+  pool_run(pool, forward_task, &job, amount);
+
+  return 0; // Success!
+}
+
 /*
  * Initialize the values of a NetworkLayer struct
  *
@@ -136,6 +218,122 @@ void network_layer_free(NetworkLayer* layer, size_t inputs)
   float_vector_free(&layer->bdeltas, layer->amount);
 }
 
+/*
+ * Initialize a NetworkLayer struct with the same values as another layer
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Inputted arguments are bad
+ * - 2 | Failed to allocate the layer
+ */
+static int network_layer_clone(NetworkLayer* clone, NetworkLayer layer, size_t inputs)
+{
+  if(clone == NULL || layer.amount <= 0 || inputs <= 0) return 1;
+
+  // The amount is set first, so a half allocated layer can be freed
+  clone->amount = layer.amount;
+  clone->activ = layer.activ;
+
+  clone->weights = float_matrix_create(layer.amount, inputs);
+  clone->biases = float_vector_create(layer.amount);
+
+  clone->wdeltas = float_matrix_create(layer.amount, inputs);
+  clone->bdeltas = float_vector_create(layer.amount);
+
+  if(clone->weights == NULL || clone->biases == NULL || clone->wdeltas == NULL || clone->bdeltas == NULL)
+  {
+    network_layer_free(clone, inputs);
+
+    return 2;
+  }
+  float_matrix_copy(clone->weights, layer.weights, layer.amount, inputs);
+  float_vector_copy(clone->biases, layer.biases, layer.amount);
+
+  return 0; // Success!
+}
+
+/*
+ * Initialize a Network struct with the same layers, weights and biases as another network
+ *
+ * Note: The momentum deltas are not cloned, they start at 0
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to allocate or clone the network layers
+ */
+int network_clone(Network* clone, Network network)
+{
+  if(clone == NULL || network.layers == NULL) return 1;
+
+  clone->inputs = network.inputs;
+  clone->amount = network.amount;
+
+  clone->layers = calloc(network.amount, sizeof(NetworkLayer));
+
+  if(clone->layers == NULL)
+  {
+    error_print("Failed to allocate network layers");
+
+    return 2;
+  }
+
+  size_t inputs = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    int status = network_layer_clone(&clone->layers[index], network.layers[index], inputs);
+
+    if(status != 0)
+    {
+      error_print("Failed to clone network layer");
+
+      network_free(clone);
+
+      return 2;
+    }
+    inputs = network.layers[index].amount;
+  }
+  clone->learnrate = network.learnrate;
+  clone->momentum = network.momentum;
+
+  return 0; // Success!
+}
+
+/*
+ * Copy the weights and biases of a network to another network with the same layers
+ *
+ * Note: Nothing is allocated, so this is cheap enough to call between epochs
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | The networks have different layers
+ */
+int network_copy(Network* destin, Network source)
+{
+  if(destin == NULL || destin->layers == NULL || source.layers == NULL) return 1;
+
+  if(destin->inputs != source.inputs || destin->amount != source.amount) return 2;
+
+  size_t width = source.inputs;
+
+  for(size_t index = 0; index < source.amount; index++)
+  {
+    NetworkLayer* layer = &destin->layers[index];
+
+    size_t height = source.layers[index].amount;
+
+    if(layer->amount != height) return 2;
+
+    float_matrix_copy(layer->weights, source.layers[index].weights, height, width);
+    float_vector_copy(layer->biases, source.layers[index].biases, height);
+
+    width = height;
+  }
+  return 0; // Success!
+}
+
 /*
  * Free the allocated memory in the inputted Network struct
  *
@@ -163,6 +361,54 @@ void network_free(Network* network)
   network->layers = NULL;
 }
 
+/*
+ * Calculate the memory that a network uses, as it is allocated by network_init
+ *
+ * Note: The overhead of malloc is not counted, but every row of a matrix is its own allocation
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int network_memory_usage(NetworkMemory* memory, Network network)
+{
+  if(memory == NULL || network.layers == NULL) return 1;
+
+  memset(memory, 0, sizeof(NetworkMemory));
+
+  memory->layers = sizeof(NetworkLayer) * network.amount;
+
+  size_t width = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    size_t height = network.layers[index].amount;
+
+    size_t matrixBytes = (sizeof(float*) * height) + (sizeof(float) * height * width);
+
+    memory->weights += matrixBytes;
+    memory->biases += sizeof(float) * height;
+
+    memory->deltas += matrixBytes + (sizeof(float) * height);
+
+    width = height;
+  }
+  memory->total = memory->weights + memory->biases + memory->deltas + memory->layers;
+
+  return 0; // Success!
+}
+
+/*
+ * Print the memory that a network uses
+ */
+void network_memory_print(const NetworkMemory* memory)
+{
+  if(memory == NULL) return;
+
+  printf("Network memory: %ld bytes (weights %ld | biases %ld | deltas %ld | layers %ld)\n",
+    memory->total, memory->weights, memory->biases, memory->deltas, memory->layers);
+}
+
 void network_print(Network network)
 {
   printf("%ld ", network.inputs);
@@ -0,0 +1,10 @@
+#ifndef P_OBSERVE_INTERN_H
+#define P_OBSERVE_INTERN_H
+
+extern bool train_observers_stepping(const Trainer* trainer);
+
+extern bool train_observers_step(const Trainer* trainer, const Network* network, size_t epoch, size_t step, size_t samples, float cost, uint64_t nanos);
+
+extern bool train_observers_epoch(const Trainer* trainer, const Network* network, size_t epoch, size_t steps, size_t samples, float cost);
+
+#endif // P_OBSERVE_INTERN_H
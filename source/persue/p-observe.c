@@ -0,0 +1,189 @@
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-observe-intern.h"
+#include "p-stats-intern.h"
+
+/*
+ * Add an observer to a trainer, that receives the metrics of the training
+ *
+ * The observers are pointers, so the added structs have to outlive the training
+ *
+ * Note: The observers should not be added or removed while the trainer is training
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | There are already TRAIN_OBSERVERS observers
+ */
+int train_observer_add(Trainer* trainer, const TrainObserver* observer)
+{
+  if(trainer == NULL || observer == NULL) return 1;
+
+  for(size_t index = 0; index < trainer->observerAmount; index++)
+  {
+    if(trainer->observers[index] == observer) return 0; // Success!
+  }
+
+  if(trainer->observerAmount >= TRAIN_OBSERVERS) return 2;
+
+  trainer->observers[trainer->observerAmount++] = observer;
+
+  // The steps are only timed if an observer has a step function
+  if(observer->step != NULL) trainer->stepperAmount++;
+
+  return 0; // Success!
+}
+
+/*
+ * Remove an observer that has been added to a trainer
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | The observer has not been added
+ */
+int train_observer_remove(Trainer* trainer, const TrainObserver* observer)
+{
+  if(trainer == NULL || observer == NULL) return 1;
+
+  for(size_t index = 0; index < trainer->observerAmount; index++)
+  {
+    if(trainer->observers[index] != observer) continue;
+
+    if(observer->step != NULL) trainer->stepperAmount--;
+
+    // The order of the observers is kept, so they are called in the order they were added
+    memmove(trainer->observers + index, trainer->observers + index + 1, sizeof(TrainObserver*) * (trainer->observerAmount - index - 1));
+
+    trainer->observerAmount--;
+
+    return 0; // Success!
+  }
+  return 2;
+}
+
+/*
+ * Check if any observer of a trainer wants the metrics of every step
+ */
+bool train_observers_stepping(const Trainer* trainer)
+{
+  return (trainer->stepperAmount > 0);
+}
+
+/*
+ * Pass the metrics of a training step to the observers of a trainer
+ *
+ * RETURN (bool stop)
+ * - true  | An observer returned OBSERVE_STOP
+ * - false | The training should go on
+ */
+bool train_observers_step(const Trainer* trainer, const Network* network, size_t epoch, size_t step, size_t samples, float cost, uint64_t nanos)
+{
+  TrainMetrics metrics = {
+    .epoch = epoch,
+    .step = step,
+    .samples = samples,
+    .loss = (samples > 0) ? (cost / samples) : 0,
+    .nanos = nanos,
+    .samplesPerSecond = (nanos > 0) ? (1e9 * samples / nanos) : 0,
+    .stats = NULL
+  };
+
+  bool stop = false;
+
+  for(size_t index = 0; index < trainer->observerAmount; index++)
+  {
+    const TrainObserver* observer = trainer->observers[index];
+
+    if(observer->step == NULL) continue;
+
+    int status = observer->step(network, &metrics, observer->data);
+
+    if(status == OBSERVE_STOP) stop = true;
+
+    else if(status != 0) log_error("step observer (epoch: #%ld step: #%ld)", epoch, step);
+  }
+  return stop;
+}
+
+/*
+ * Pass the metrics of a training epoch to the observers of a trainer
+ *
+ * The time of the epoch is taken from the stats of the last completed epoch
+ *
+ * RETURN (bool stop)
+ * - true  | An observer returned OBSERVE_STOP
+ * - false | The training should go on
+ */
+bool train_observers_epoch(const Trainer* trainer, const Network* network, size_t epoch, size_t steps, size_t samples, float cost)
+{
+  if(trainer->observerAmount == 0) return false;
+
+  TrainStats stats;
+
+  train_stats_get(trainer, &stats);
+
+  TrainMetrics metrics = {
+    .epoch = epoch,
+    .step = steps,
+    .samples = samples,
+    .loss = (samples > 0) ? (cost / samples) : 0,
+    .nanos = stats.epochNanos,
+    .samplesPerSecond = (stats.epochNanos > 0) ? (1e9 * samples / stats.epochNanos) : 0,
+    .stats = &stats
+  };
+
+  bool stop = false;
+
+  for(size_t index = 0; index < trainer->observerAmount; index++)
+  {
+    const TrainObserver* observer = trainer->observers[index];
+
+    if(observer->epoch == NULL) continue;
+
+    int status = observer->epoch(network, &metrics, observer->data);
+
+    if(status == OBSERVE_STOP) stop = true;
+
+    else if(status != 0) log_error("epoch observer (epoch: #%ld)", epoch);
+  }
+  return stop;
+}
+
+/*
+ * Log the mean cost and the throughput of an epoch
+ */
+static int train_print_epoch(const Network* network, const TrainMetrics* metrics, void* data)
+{
+  log_info("Mean Cost #%02ld: %f (%.0f samples/s)", metrics->epoch, metrics->loss, metrics->samplesPerSecond);
+
+  return 0; // Success!
+}
+
+const TrainObserver trainPrintObserver = { .step = NULL, .epoch = train_print_epoch, .data = NULL };
+
+/*
+ * Set the stats gauges of review to the metrics of an epoch
+ */
+static int train_gauge_epoch(const Network* network, const TrainMetrics* metrics, void* data)
+{
+  stats_gauge_set("train_epoch", "The number of the last completed epoch", metrics->epoch);
+  stats_gauge_set("train_loss", "The mean cost of the last epoch", metrics->loss);
+  stats_gauge_set("train_samples_per_second", "The amount of samples trained per second in the last epoch", metrics->samplesPerSecond);
+  stats_gauge_set("train_epoch_seconds", "The time of the last epoch", (double) metrics->nanos / 1e9);
+
+  if(metrics->stats == NULL) return 0; // Success!
+
+  for(size_t phase = 0; phase < PHASE_AMOUNT; phase++)
+  {
+    char name[64];
+
+    snprintf(name, sizeof(name), "train_phase_seconds{phase=\"%s\"}", phaseNames[phase]);
+
+    stats_gauge_set(name, "The time of every phase in the last epoch", (double) metrics->stats->phaseNanos[phase] / 1e9);
+  }
+  return 0; // Success!
+}
+
+const TrainObserver trainGaugeObserver = { .step = NULL, .epoch = train_gauge_epoch, .data = NULL };
@@ -0,0 +1,241 @@
+#define _GNU_SOURCE
+
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-stats-intern.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+/*
+ * Pin the current thread to one of the online processors
+ */
+static void pool_thread_pin(size_t thread)
+{
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  if(processors < 1) return;
+
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+  CPU_SET(thread % processors, &set);
+
+  if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set) != 0) log_warn("Failed to pin pool thread %ld", thread);
+}
+
+/*
+ * Claim and run tasks of the current job until every task is claimed
+ */
+static void pool_tasks_run(ThreadPool* pool, size_t thread)
+{
+  size_t index;
+
+  while((index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < pool->amount)
+  {
+    TRACE_DETAIL_BEGIN("pool", "task", "index", index);
+
+    pool->task(index, thread, pool->data);
+
+    TRACE_DETAIL_END("pool", "task");
+  }
+}
+
+/*
+ * The routine of a worker thread, that waits for jobs and helps running them
+ */
+static void* pool_worker_routine(void* data)
+{
+  PoolWorker* worker = data;
+
+  ThreadPool* pool = worker->pool;
+
+  trace_thread_name("pool");
+
+  if(pool->pinned) pool_thread_pin(worker->thread);
+
+  size_t generation = 0;
+
+  while(true)
+  {
+    pthread_mutex_lock(&pool->mutex);
+
+    while(pool->generation == generation && !pool->stopping) pthread_cond_wait(&pool->startCond, &pool->mutex);
+
+    if(pool->stopping)
+    {
+      pthread_mutex_unlock(&pool->mutex);
+
+      break;
+    }
+    generation = pool->generation;
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    pool_tasks_run(pool, worker->thread);
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if(--pool->running == 0) pthread_cond_signal(&pool->doneCond);
+
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  return NULL;
+}
+
+/*
+ * Initialize a pool of threads that runs the tasks of a job in parallel
+ *
+ * The calling thread is one of the threads, so (threads - 1) worker threads are started
+ *
+ * PARAMS
+ * - ThreadPool* pool | The pointer to the ThreadPool struct
+ * - size_t threads   | The amount of threads, or 0 for one per online processor
+ * - bool pin         | If every thread should be pinned to its own processor, for repeatable timings
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to start the threads
+ */
+int pool_init(ThreadPool* pool, size_t threads, bool pin)
+{
+  if(pool == NULL) return 1;
+
+  if(threads == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    threads = (processors > 0) ? processors : 1;
+  }
+
+  if(threads > POOL_THREADS) return 1;
+
+  memset(pool, 0, sizeof(ThreadPool));
+
+  pool->threads = threads;
+  pool->pinned = pin;
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->startCond, NULL);
+  pthread_cond_init(&pool->doneCond, NULL);
+
+  if(pin)
+  {
+    // The calling thread is pinned as thread 0, and gets its old affinity back in pool_free
+    pool->oldAffinity = malloc(sizeof(cpu_set_t));
+
+    if(pool->oldAffinity != NULL) pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), pool->oldAffinity);
+
+    pool_thread_pin(0);
+  }
+
+  for(size_t thread = 1; thread < threads; thread++)
+  {
+    pool->workers[thread] = (PoolWorker) { .pool = pool, .thread = thread };
+
+    if(pthread_create(&pool->workers[thread].handle, NULL, pool_worker_routine, &pool->workers[thread]) != 0)
+    {
+      // Only the started threads are stopped
+      pool->threads = thread;
+
+      pool_free(pool);
+
+      return 2;
+    }
+  }
+  return 0; // Success!
+}
+
+/*
+ * Run a job of tasks on the threads of the pool, and wait until every task is done
+ *
+ * Every task is called with its index and the index of the thread that runs it,
+ * so a job can keep one accumulator per thread without locks
+ *
+ * PARAMS
+ * - ThreadPool* pool | The pool, or NULL to run every task on the calling thread
+ * - pool_task_t task | The function that runs one task
+ * - void* data       | The data that is passed to every task
+ * - size_t amount    | The amount of tasks
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int pool_run(ThreadPool* pool, pool_task_t task, void* data, size_t amount)
+{
+  if(task == NULL) return 1;
+
+  if(pool == NULL || pool->threads <= 1 || amount <= 1)
+  {
+    for(size_t index = 0; index < amount; index++) task(index, 0, data);
+
+    return 0; // Success!
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->task = task;
+  pool->data = data;
+  pool->amount = amount;
+  pool->next = 0;
+  pool->running = pool->threads - 1;
+  pool->generation++;
+
+  pthread_cond_broadcast(&pool->startCond);
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  pool_tasks_run(pool, 0);
+
+  pthread_mutex_lock(&pool->mutex);
+
+  while(pool->running > 0) pthread_cond_wait(&pool->doneCond, &pool->mutex);
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  return 0; // Success!
+}
+
+/*
+ * Get the amount of threads of a pool, 1 if the pool is NULL
+ */
+size_t pool_threads(const ThreadPool* pool)
+{
+  return (pool != NULL && pool->threads > 0) ? pool->threads : 1;
+}
+
+/*
+ * Stop the threads of a pool, and give the calling thread its old affinity back
+ */
+void pool_free(ThreadPool* pool)
+{
+  if(pool == NULL) return;
+
+  pthread_mutex_lock(&pool->mutex);
+
+  pool->stopping = true;
+
+  pthread_cond_broadcast(&pool->startCond);
+
+  pthread_mutex_unlock(&pool->mutex);
+
+  for(size_t thread = 1; thread < pool->threads; thread++)
+  {
+    pthread_join(pool->workers[thread].handle, NULL);
+  }
+
+  if(pool->oldAffinity != NULL)
+  {
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), pool->oldAffinity);
+
+    free(pool->oldAffinity);
+  }
+  pthread_mutex_destroy(&pool->mutex);
+  pthread_cond_destroy(&pool->startCond);
+  pthread_cond_destroy(&pool->doneCond);
+
+  memset(pool, 0, sizeof(ThreadPool));
+}
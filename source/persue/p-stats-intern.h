@@ -0,0 +1,113 @@
+#ifndef P_STATS_INTERN_H
+#define P_STATS_INTERN_H
+
+// The perf regions of persue, the phases first, then the layers
+#define REGION_PHASE(phase)     (phase)
+#define REGION_INFERENCE        (PHASE_AMOUNT)
+#define REGION_forward          (PHASE_AMOUNT + 1)
+#define REGION_backward         (REGION_forward + STATS_LAYERS)
+#define REGION_update           (REGION_backward + STATS_LAYERS)
+#define REGION_inference        (REGION_update + STATS_LAYERS)
+#define REGION_AMOUNT           (REGION_inference + STATS_LAYERS)
+
+#define REGION_LAYER(kind, layer) (((layer) < STATS_LAYERS) ? (REGION_##kind + (layer)) : -1)
+
+// The timers are only compiled in if PERSUE_TIMERS is defined,
+// else every macro expands to nothing and there is no overhead at all
+// The timers add to the stats of the trainer that is in scope, which has to be called trainer
+#ifdef PERSUE_TIMERS
+
+#define STATS_TIMER_START(timer) uint64_t timer = timer_nanos()
+
+// The times are added atomically, because the samples of a mini batch can be run on a thread pool,
+// then a phase is the sum of the time that every thread has spent in it
+#define STATS_NANOS_ADD(nanos, timer) __atomic_fetch_add(&(nanos), timer_nanos() - (timer), __ATOMIC_RELAXED)
+
+#define STATS_PHASE_ADD(phase, timer) STATS_NANOS_ADD(trainer->stats.phaseNanos[(phase)], timer)
+
+#define STATS_LAYER_ADD(kind, layer, timer) \
+  do { if((layer) < STATS_LAYERS) STATS_NANOS_ADD(trainer->stats.kind##Nanos[(layer)], timer); } while(0)
+
+#define STATS_STEP_ADD(amount) (trainer->stats.steps++, trainer->stats.samples += (amount))
+
+#define STATS_SUMS_ADD(amount) (trainer->stats.sums += (amount))
+
+#else // PERSUE_TIMERS
+
+#define STATS_TIMER_START(timer)
+
+#define STATS_PHASE_ADD(phase, timer)
+
+#define STATS_LAYER_ADD(kind, layer, timer)
+
+#define STATS_STEP_ADD(amount)
+
+#define STATS_SUMS_ADD(amount)
+
+#endif // PERSUE_TIMERS
+
+// The perf regions are only compiled in if PERSUE_PERF is defined,
+// and they only count something if the thread has called perf_open
+#ifdef PERSUE_PERF
+
+#define PERF_REGION_BEGIN(index) perf_region_begin(persue_perf_region(index))
+
+#define PERF_REGION_END(index) perf_region_end(persue_perf_region(index))
+
+#else // PERSUE_PERF
+
+#define PERF_REGION_BEGIN(index)
+
+#define PERF_REGION_END(index)
+
+#endif // PERSUE_PERF
+
+// The trace events are only compiled in if PERSUE_TRACE is defined,
+// and they are only recorded while the tracing is started (trace_start)
+// The detail events happen for every sample, so they are only recorded if trace_detail_set is called
+#ifdef PERSUE_TRACE
+
+#define TRACE_REGION_BEGIN(category, name, argName, arg) trace_begin((category), (name), (argName), (arg))
+
+#define TRACE_REGION_END(category, name) trace_end((category), (name))
+
+#define TRACE_DETAIL_BEGIN(category, name, argName, arg) trace_detail_begin((category), (name), (argName), (arg))
+
+#define TRACE_DETAIL_END(category, name) trace_detail_end((category), (name))
+
+#else // PERSUE_TRACE
+
+#define TRACE_REGION_BEGIN(category, name, argName, arg)
+
+#define TRACE_REGION_END(category, name)
+
+#define TRACE_DETAIL_BEGIN(category, name, argName, arg)
+
+#define TRACE_DETAIL_END(category, name)
+
+#endif // PERSUE_TRACE
+
+// Mark a phase of a training step
+#define PHASE_BEGIN(phase, timer) STATS_TIMER_START(timer); PERF_REGION_BEGIN(REGION_PHASE(phase)); \
+  TRACE_DETAIL_BEGIN("train", phaseNames[(phase)], NULL, 0)
+
+#define PHASE_END(phase, timer) TRACE_DETAIL_END("train", phaseNames[(phase)]); \
+  PERF_REGION_END(REGION_PHASE(phase)); STATS_PHASE_ADD(phase, timer)
+
+// Mark the work of a layer (kind is forward, backward or update)
+#define LAYER_BEGIN(kind, layer, timer) STATS_TIMER_START(timer); PERF_REGION_BEGIN(REGION_LAYER(kind, layer)); \
+  TRACE_DETAIL_BEGIN("layer", #kind, "layer", (layer))
+
+#define LAYER_END(kind, layer, timer) TRACE_DETAIL_END("layer", #kind); \
+  PERF_REGION_END(REGION_LAYER(kind, layer)); STATS_LAYER_ADD(kind, layer, timer)
+
+// The names of the phases, as they are printed
+extern const char* phaseNames[PHASE_AMOUNT];
+
+extern int persue_perf_region(int index);
+
+extern void train_stats_epoch_begin(Trainer* trainer, size_t epoch, size_t layers, size_t bsize);
+
+extern void train_stats_epoch_end(Trainer* trainer);
+
+#endif // P_STATS_INTERN_H
@@ -0,0 +1,155 @@
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-stats-intern.h"
+
+const char* phaseNames[PHASE_AMOUNT] = {"values", "derivs", "gradient", "update", "cost"};
+
+// The review regions of every persue region, created the first time a region is used
+static int perfRegions[REGION_AMOUNT];
+
+static pthread_once_t perfRegionsOnce = PTHREAD_ONCE_INIT;
+
+static void persue_perf_regions_create(void)
+{
+  char name[32];
+
+  for(size_t phase = 0; phase < PHASE_AMOUNT; phase++)
+  {
+    snprintf(name, sizeof(name), "train %s", phaseNames[phase]);
+
+    perfRegions[REGION_PHASE(phase)] = perf_region_create(name);
+  }
+  perfRegions[REGION_INFERENCE] = perf_region_create("inference");
+
+  for(size_t layer = 0; layer < STATS_LAYERS; layer++)
+  {
+    snprintf(name, sizeof(name), "layer %02ld forward", layer);
+    perfRegions[REGION_LAYER(forward, layer)] = perf_region_create(name);
+
+    snprintf(name, sizeof(name), "layer %02ld backward", layer);
+    perfRegions[REGION_LAYER(backward, layer)] = perf_region_create(name);
+
+    snprintf(name, sizeof(name), "layer %02ld update", layer);
+    perfRegions[REGION_LAYER(update, layer)] = perf_region_create(name);
+
+    snprintf(name, sizeof(name), "layer %02ld inference", layer);
+    perfRegions[REGION_LAYER(inference, layer)] = perf_region_create(name);
+  }
+}
+
+/*
+ * Get the review perf region of a persue region
+ *
+ * RETURN (int region)
+ * - SUCCESS | The review region
+ * - ERROR   | -1, if the index is out of range or the region could not be created
+ */
+int persue_perf_region(int index)
+{
+  if(index < 0 || index >= REGION_AMOUNT) return -1;
+
+  pthread_once(&perfRegionsOnce, persue_perf_regions_create);
+
+  return perfRegions[index];
+}
+
+/*
+ * Start timing a new epoch of a trainer
+ */
+void train_stats_epoch_begin(Trainer* trainer, size_t epoch, size_t layers, size_t bsize)
+{
+  memset(&trainer->stats, 0, sizeof(TrainStats));
+
+  trainer->stats.epoch = epoch;
+  trainer->stats.layers = (layers < STATS_LAYERS) ? layers : STATS_LAYERS;
+  trainer->stats.bsize = bsize;
+
+  trainer->allocStart = secure_alloc_count();
+
+  TRACE_REGION_BEGIN("train", "epoch", "epoch", epoch);
+
+  trainer->epochStart = timer_nanos();
+}
+
+/*
+ * Stop timing the current epoch of a trainer, and keep its stats as the last completed epoch
+ *
+ * Note: The allocations are counted for the whole process, so they include the other trainings
+ */
+void train_stats_epoch_end(Trainer* trainer)
+{
+  trainer->stats.epochNanos = (timer_nanos() - trainer->epochStart);
+
+  trainer->stats.allocations = (secure_alloc_count() - trainer->allocStart);
+
+  TRACE_REGION_END("train", "epoch");
+
+  trainer->epochStats = trainer->stats;
+}
+
+/*
+ * Get the stats of the last completed training epoch of a trainer
+ *
+ * Note: If the timers are compiled out (PERSUE_TIMERS is not defined),
+ * only the epoch number and the total time of the epoch are measured
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | No epoch has been completed
+ */
+int train_stats_get(const Trainer* trainer, TrainStats* stats)
+{
+  if(trainer == NULL || stats == NULL) return 1;
+
+  *stats = trainer->epochStats;
+
+  return (trainer->epochStats.epoch > 0) ? 0 : 2;
+}
+
+/*
+ * Print the stats of a training epoch to the console
+ */
+void train_stats_print(const TrainStats* stats)
+{
+  if(stats == NULL) return;
+
+  double epochMs = (double) stats->epochNanos / 1e6;
+
+  printf("Epoch #%02ld: %.3f ms (%ld steps, %ld samples)\n", stats->epoch, epochMs, stats->steps, stats->samples);
+
+  uint64_t phasesNanos = 0;
+
+  for(size_t phase = 0; phase < PHASE_AMOUNT; phase++)
+  {
+    double phaseMs = (double) stats->phaseNanos[phase] / 1e6;
+
+    double procent = (epochMs > 0) ? (100 * phaseMs / epochMs) : 0;
+
+    printf("  %-8s : %10.3f ms (%5.1f%%)\n", phaseNames[phase], phaseMs, procent);
+
+    phasesNanos += stats->phaseNanos[phase];
+  }
+
+  // The rest of the time is spent outside of the phases, for example allocating memory
+  uint64_t otherNanos = (stats->epochNanos > phasesNanos) ? (stats->epochNanos - phasesNanos) : 0;
+
+  printf("  %-8s : %10.3f ms\n", "other", (double) otherNanos / 1e6);
+
+  // The allocations are only counted if the tracking of secure is on
+  if(stats->allocations > 0)
+  {
+    double perStep = (stats->steps > 0) ? ((double) stats->allocations / stats->steps) : 0;
+
+    printf("  %-8s : %10lu (%.1f per step)\n", "mallocs", (unsigned long) stats->allocations, perStep);
+  }
+
+  for(size_t layer = 0; layer < stats->layers; layer++)
+  {
+    printf("  layer %02ld : forward %10.3f ms | backward %10.3f ms | update %10.3f ms\n", layer,
+      (double) stats->forwardNanos[layer] / 1e6,
+      (double) stats->backwardNanos[layer] / 1e6,
+      (double) stats->updateNanos[layer] / 1e6);
+  }
+}
@@ -2,12 +2,14 @@
 #include "../review.h"
 
 #include "p-activs-intern.h"
-#include "p-network-intern.h"
+#include "p-stats-intern.h"
+#include "p-observe-intern.h"
+#include "p-workspace-intern.h"
 
 /*
  * Calculate the values of each node in the inputted network from the inputs
  */
-static int node_values_create(float** values, Network network, const float* inputs)
+static int node_values_create(Trainer* trainer, float** values, Network network, const float* inputs)
 {
   if(values == NULL || inputs == NULL) return 1;
 
@@ -18,6 +20,8 @@ static int node_values_create(float** values, Network network, const float* inpu
   // From the first hidden layer (second layer) to the last layer
   for(size_t index = 1; index <= network.amount; index++)
   {
+    LAYER_BEGIN(forward, index - 1, layerTimer);
+
     NetworkLayer layer = network.layers[index - 1];
 
     size_t height = layer.amount;
@@ -29,6 +33,8 @@ static int node_values_create(float** values, Network network, const float* inpu
     activ_values(values[index], values[index], height, layer.activ);
 
     width = layer.amount;
+
+    LAYER_END(forward, index - 1, layerTimer);
   }
   return 0;
 }
@@ -36,24 +42,30 @@ static int node_values_create(float** values, Network network, const float* inpu
 /*
  *
  */
-static int node_derivs_create(float** derivs, Network network, float** values, const float* targets)
+static int node_derivs_create(Trainer* trainer, float** derivs, float** transp, Network network, float** values, const float* targets)
 {
-  if(derivs == NULL || values == NULL || targets == NULL) return 1;
+  if(derivs == NULL || transp == NULL || values == NULL || targets == NULL) return 1;
 
   // If no hidden or output layer exist, there is no need for derivatives
   if(network.amount <= 0) return 0; // Success!
 
   // 1. Calculating the derivatives for the output layer
+  LAYER_BEGIN(backward, network.amount - 1, outputTimer);
+
   NetworkLayer outputLayer = network.layers[network.amount - 1];
 
   cross_entropy_derivs(derivs[network.amount - 1], values[network.amount], targets, outputLayer.amount);
 
   activ_derivs_apply(derivs[network.amount - 1], values[network.amount], outputLayer.amount, outputLayer.activ);
 
+  LAYER_END(backward, network.amount - 1, outputTimer);
+
   // 2. Calculating the derivatives for the hidden layers
   // From the last hidden layer (next to last layer) to the first hidden layer (first layer)
   for(size_t index = (network.amount - 1); index-- >= 1;)
   {
+    LAYER_BEGIN(backward, index, layerTimer);
+
     NetworkLayer layer = network.layers[index];
 
     // The height and with will be the height and with for the layer before (closer to output)
@@ -63,39 +75,52 @@ static int node_derivs_create(float** derivs, Network network, float** values, c
 
     // The weights are from the layer before (close to output)
     float** weights = network.layers[index + 1].weights;
-    float** weightsTransp = float_matrix_create(width, height);
 
-    float_matrix_transp(weightsTransp, weights, height, width);
+    float_matrix_transp(transp, weights, height, width);
 
     // derivs[index + 1] is the derivs from the layer before (closer to output layer)
-    float_matrix_vector_dotprod(derivs[index], weightsTransp, width, height, derivs[index + 1]);
-
-    float_matrix_free(&weightsTransp, width, height);
+    float_matrix_vector_dotprod(derivs[index], transp, width, height, derivs[index + 1]);
 
     activ_derivs_apply(derivs[index], values[index + 1], width, layer.activ);
+
+    LAYER_END(backward, index, layerTimer);
   }
   return 0; // Success!
 }
 
 /*
+ * Calculate the weight and bias derivatives of one sample,
+ * into the wderivs and bderivs of the thread workspace
+ *
  * PARAMS
- * - float*** wderivs     | The derivatives for the weights
- * - float** bderivs      | The derivatives for the biases
- * - Network network      | The nerual network
- * - const float* inputs  | The inputs
- * - const float* targets | The targets
+ * - ThreadWorkspace* space | The buffers of the thread
+ * - Network network        | The nerual network
+ * - const float* inputs    | The inputs
+ * - const float* targets   | The targets
  */
-static int weight_bias_derivs_create(float*** wderivs, float** bderivs, Network network, const float* inputs, const float* targets)
+static int weight_bias_derivs_create(Trainer* trainer, ThreadWorkspace* space, Network network, const float* inputs, const float* targets)
 {
-  if(wderivs == NULL || bderivs == NULL || inputs == NULL || targets == NULL) return 1;
+  if(space == NULL || inputs == NULL || targets == NULL) return 1;
+
+  float*** wderivs = space->wderivs;
+  float** bderivs = space->bderivs;
+
+  float** nvalues = space->values;
+  float** nderivs = space->derivs;
+
+  PHASE_BEGIN(PHASE_VALUES, valuesTimer);
 
-  size_t maxSize = network_max_layer_nodes(network);
+  node_values_create(trainer, nvalues, network, inputs);
 
-  float** nvalues = float_matrix_create(network.amount + 1, maxSize);
-  float** nderivs = float_matrix_create(network.amount, maxSize);
+  PHASE_END(PHASE_VALUES, valuesTimer);
 
-  node_values_create(nvalues, network, inputs);
-  node_derivs_create(nderivs, network, nvalues, targets);
+  PHASE_BEGIN(PHASE_DERIVS, derivsTimer);
+
+  node_derivs_create(trainer, nderivs, space->transp, network, nvalues, targets);
+
+  PHASE_END(PHASE_DERIVS, derivsTimer);
+
+  PHASE_BEGIN(PHASE_GRADIENT, gradientTimer);
 
   // From the last layer (output layer) to the first layer (first hidden layer)
   for(size_t index = network.amount; index-- >= 1;)
@@ -110,59 +135,162 @@ static int weight_bias_derivs_create(float*** wderivs, float** bderivs, Network
 
     float_vector_copy(bderivs[index], nderivs[index], height);
   }
-  float_matrix_free(&nvalues, network.amount + 1, maxSize);
-  float_matrix_free(&nderivs, network.amount, maxSize);
+  PHASE_END(PHASE_GRADIENT, gradientTimer);
 
   return 0; // Success!
 }
 
 /*
- * Calculate the mean weight and bias derivatives of multiple inputs and targets
+ * Set the sums of the weight and bias derivatives of a thread to zero,
+ * only the part of every matrix that the layers use is set
+ */
+static void derivs_sums_zero(ThreadWorkspace* space, Network network)
+{
+  size_t width = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    size_t height = network.layers[index].amount;
+
+    for(size_t hIndex = 0; hIndex < height; hIndex++)
+    {
+      memset(space->swderivs[index][hIndex], 0, sizeof(float) * width);
+    }
+    memset(space->sbderivs[index], 0, sizeof(float) * height);
+
+    width = height;
+  }
+}
+
+/*
+ * Add the weight and bias derivatives of a sample to the sums of a thread,
+ * only the part of every matrix that the layers use is added
+ */
+static void derivs_sums_add(float*** swderivs, float** sbderivs, float*** wderivs, float** bderivs, Network network)
+{
+  size_t width = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    size_t height = network.layers[index].amount;
+
+    float_matrix_elem_addit(swderivs[index], swderivs[index], wderivs[index], height, width);
+
+    float_vector_elem_addit(sbderivs[index], sbderivs[index], bderivs[index], height);
+
+    width = height;
+  }
+}
+
+typedef struct
+{
+  Trainer* trainer;           // The trainer, that the timers add to
+  Network network;            // The neural network
+  float** inputs;             // The inputs of the batch
+  float** targets;            // The targets of the batch
+  ThreadWorkspace* spaces;    // The buffers of every thread
+  bool used[POOL_THREADS];    // If the thread has summed any sample (only set by the thread itself)
+} MeanDerivsJob;
+
+/*
+ * Add the weight and bias derivatives of one sample to the sums of the thread
+ */
+static void mean_derivs_task(size_t index, size_t thread, void* data)
+{
+  MeanDerivsJob* job = data;
+
+  Trainer* trainer = job->trainer;
+
+  ThreadWorkspace* space = &job->spaces[thread];
+
+  // The sums are set to zero by the first sample of the thread
+  if(!job->used[thread])
+  {
+    derivs_sums_zero(space, job->network);
+
+    job->used[thread] = true;
+  }
+  weight_bias_derivs_create(trainer, space, job->network, job->inputs[index], job->targets[index]);
+
+  PHASE_BEGIN(PHASE_GRADIENT, sumTimer);
+
+  derivs_sums_add(space->swderivs, space->sbderivs, space->wderivs, space->bderivs, job->network);
+
+  PHASE_END(PHASE_GRADIENT, sumTimer);
+}
+
+/*
+ * Calculate the mean weight and bias derivatives of multiple inputs and targets,
+ * into the wderivs and bderivs of the workspace of the first thread
+ *
+ * The samples are spread over the pool of the trainer, every thread sums the derivatives of its samples
+ * and the sums are added together after the batch, so the result is the same as on one thread,
+ * apart from the order of the float additions
  *
  * PARAMS
  * - size_t amount | The amount of inputs and targets
  */
-int weight_bias_mean_derivs_create(float*** wderivs, float** bderivs, Network network, float** inputs, float** targets, size_t amount)
+static int weight_bias_mean_derivs_create(Trainer* trainer, TrainWorkspace* workspace, Network network, float** inputs, float** targets, size_t amount)
 {
-  if(wderivs == NULL || bderivs == NULL || inputs == NULL || targets == NULL) return 1;
+  if(workspace == NULL || inputs == NULL || targets == NULL || amount == 0) return 1;
 
-  size_t maxSize = network_max_layer_nodes(network);
+  MeanDerivsJob job = {
+    .trainer = trainer,
+    .network = network,
+    .inputs = inputs,
+    .targets = targets,
+    .spaces = workspace->spaces
+  };
 
-  // Sum of the weight derivatives
-  float*** swderivs = float_matarr_create(network.amount, maxSize, maxSize);
-  float** sbderivs = float_matrix_create(network.amount, maxSize);
+  // Any thread of the pool can take a sample, so only the threads that did are summed
+  pool_run(trainer->options.pool, mean_derivs_task, &job, amount);
 
-  // Temporary weight derivatives
-  float*** twderivs = float_matarr_create(network.amount, maxSize, maxSize);
-  float** tbderivs = float_matrix_create(network.amount, maxSize);
+  PHASE_BEGIN(PHASE_GRADIENT, meanTimer);
 
-  for(size_t index = 0; index < amount; index++)
+  size_t first = 0;
+
+  while(!job.used[first]) first++;
+
+  ThreadWorkspace* sums = &workspace->spaces[first];
+
+  STATS_SUMS_ADD(1);
+
+  // The sums of the other threads are added to the sum of the first thread
+  for(size_t thread = first + 1; thread < workspace->threads; thread++)
   {
-    weight_bias_derivs_create(twderivs, tbderivs, network, inputs[index], targets[index]);
+    if(!job.used[thread]) continue;
+
+    ThreadWorkspace* space = &workspace->spaces[thread];
+
+    STATS_SUMS_ADD(1);
 
-    float_matarr_elem_addit(swderivs, swderivs, twderivs, network.amount, maxSize, maxSize);
-    float_matrix_elem_addit(sbderivs, sbderivs, tbderivs, network.amount, maxSize);
+    derivs_sums_add(sums->swderivs, sums->sbderivs, space->swderivs, space->sbderivs, network);
   }
 
   // Dividing the sum of the weight/bias derivatives by the batch size, you get the average derivatives
   float scalor = (1.0f / (float) amount);
 
-  float_matarr_scale_multi(wderivs, swderivs, network.amount, maxSize, maxSize, scalor);
-  float_matrix_scale_multi(bderivs, sbderivs, network.amount, maxSize, scalor);
+  ThreadWorkspace* mean = &workspace->spaces[0];
 
-  float_matarr_free(&twderivs, network.amount, maxSize, maxSize);
-  float_matrix_free(&tbderivs, network.amount, maxSize);
+  size_t width = network.inputs;
+
+  for(size_t index = 0; index < network.amount; index++)
+  {
+    size_t height = network.layers[index].amount;
 
-  float_matarr_free(&swderivs, network.amount, maxSize, maxSize);
-  float_matrix_free(&sbderivs, network.amount, maxSize);
+    float_matrix_scale_multi(mean->wderivs[index], sums->swderivs[index], height, width, scalor);
+
+    float_vector_scale_multi(mean->bderivs[index], sums->sbderivs[index], height, scalor);
+
+    width = height;
+  }
+  PHASE_END(PHASE_GRADIENT, meanTimer);
 
   return 0; // Success!
 }
 
-static int layer_weight_deltas_create(float** wdeltas, float** wderivs, size_t height, size_t width, float learnrate, float momentum)
+static int layer_weight_deltas_create(float** wdeltas, float** wderivs, float** twdeltas, size_t height, size_t width, float learnrate, float momentum)
 {
-  float** twdeltas = float_matrix_create(height, width);
-
   float_matrix_scale_multi(twdeltas, wderivs, height, width, -learnrate);
 
   // If old weight deltas exist, add a small part of the old deltas to the new deltas
@@ -177,8 +305,6 @@ static int layer_weight_deltas_create(float** wdeltas, float** wderivs, size_t h
   }
   else float_matrix_copy(wdeltas, twdeltas, height, width);
 
-  float_matrix_free(&twdeltas, height, width);
-
   return 0; // Success!
 }
 
@@ -212,24 +338,28 @@ static int layer_bias_deltas_create(float* bdeltas, float* bderivs, size_t heigh
  * - 0 | Success!
  * - 1 |
  */
-static int weight_bias_deltas_from_derivs_create(Network* network, float*** wderivs, float** bderivs)
+static int weight_bias_deltas_from_derivs_create(Trainer* trainer, Network* network, float*** wderivs, float** bderivs, float** twdeltas)
 {
-  if(wderivs == NULL || bderivs == NULL) return 1;
+  if(wderivs == NULL || bderivs == NULL || twdeltas == NULL) return 1;
 
   size_t width = network->inputs;
 
   for(size_t index = 0; index < network->amount; index++)
   {
+    LAYER_BEGIN(update, index, layerTimer);
+
     NetworkLayer* layer = &network->layers[index];
 
     size_t height = layer->amount;
 
-    layer_weight_deltas_create(layer->wdeltas, wderivs[index], height, width, network->learnrate, network->momentum);
+    layer_weight_deltas_create(layer->wdeltas, wderivs[index], twdeltas, height, width, network->learnrate, network->momentum);
 
     layer_bias_deltas_create(layer->bdeltas, bderivs[index], height, network->learnrate, network->momentum);
 
     // The width of the next layer is the height of the current layer
     width = layer->amount;
+
+    LAYER_END(update, index, layerTimer);
   }
   return 0; // Success!
 }
@@ -248,73 +378,79 @@ static int weight_bias_deltas_from_derivs_create(Network* network, float*** wder
  * - 0 | Success!
  * - 1 | The inputted arguements are bad
  */
-static int weight_bias_deltas_create(Network* network, const float* inputs, const float* targets)
+static int weight_bias_deltas_create(Trainer* trainer, TrainWorkspace* workspace, Network* network, const float* inputs, const float* targets)
 {
-  if(inputs == NULL || targets == NULL) return 1;
+  if(workspace == NULL || inputs == NULL || targets == NULL) return 1;
 
-  size_t maxSize = network_max_layer_nodes(*network);
+  ThreadWorkspace* space = &workspace->spaces[0];
 
-  float*** wderivs = float_matarr_create(network->amount, maxSize, maxSize); // Weight derivatives
-  float** bderivs  = float_matrix_create(network->amount, maxSize);          // Bias derivatives
+  int status = weight_bias_derivs_create(trainer, space, *network, inputs, targets);
 
-  int status = weight_bias_derivs_create(wderivs, bderivs, *network, inputs, targets);
+  if(status != 0) log_error("weight_bias_derivs_create");
 
-  if(status != 0) error_print("weight_bias_derivs_create");
+  PHASE_BEGIN(PHASE_UPDATE, updateTimer);
 
-  status = weight_bias_deltas_from_derivs_create(network, wderivs, bderivs);
+  status = weight_bias_deltas_from_derivs_create(trainer, network, space->wderivs, space->bderivs, workspace->twdeltas);
 
-  if(status != 0) error_print("weight_bias_deltas_from_derivs_create");
+  if(status != 0) log_error("weight_bias_deltas_from_derivs_create");
 
-  float_matarr_free(&wderivs, network->amount, maxSize, maxSize);
-  float_matrix_free(&bderivs, network->amount, maxSize);
+  PHASE_END(PHASE_UPDATE, updateTimer);
 
   return 0; // Success!
 }
 
-static int weight_bias_mean_deltas_create(Network* network, float** inputs, float** targets, size_t amount)
+static int weight_bias_mean_deltas_create(Trainer* trainer, TrainWorkspace* workspace, Network* network, float** inputs, float** targets, size_t amount)
 {
-  if(inputs == NULL || targets == NULL) return 1;
+  if(workspace == NULL || inputs == NULL || targets == NULL) return 1;
 
-  size_t maxSize = network_max_layer_nodes(*network);
+  int status = weight_bias_mean_derivs_create(trainer, workspace, *network, inputs, targets, amount);
 
-  float*** wderivs = float_matarr_create(network->amount, maxSize, maxSize); // Weight derivatives
-  float** bderivs  = float_matrix_create(network->amount, maxSize);          // Bias derivatives
+  if(status != 0) log_error("weight_bias_mean_derivs_create");
 
-  int status = weight_bias_mean_derivs_create(wderivs, bderivs, *network, inputs, targets, amount);
+  PHASE_BEGIN(PHASE_UPDATE, updateTimer);
 
-  if(status != 0) error_print("weight_bias_mean_derivs_create");
+  ThreadWorkspace* mean = &workspace->spaces[0];
 
-  status = weight_bias_deltas_from_derivs_create(network, wderivs, bderivs);
+  status = weight_bias_deltas_from_derivs_create(trainer, network, mean->wderivs, mean->bderivs, workspace->twdeltas);
 
-  if(status != 0) error_print("weight_bias_deltas_from_derivs_create");
+  if(status != 0) log_error("weight_bias_deltas_from_derivs_create");
 
-  float_matarr_free(&wderivs, network->amount, maxSize, maxSize);
-  float_matrix_free(&bderivs, network->amount, maxSize);
+  PHASE_END(PHASE_UPDATE, updateTimer);
 
   return 0; // Success!
 }
 
-float cost = 0;
-
 /*
  * Train the network stochastically on a single sample
  *
+ * The buffers of the step are in the workspace of the trainer, which is created by the first step,
+ * so the steps after it do not allocate any memory
+ *
  * RETURN (int status)
  * - 0 | Success!
  * - 1 | The inputted arguments are bad
+ * - 2 | Failed to create the workspace
  */
-int network_train_stcast(Network* network, const float* inputs, const float* targets)
+int network_train_stcast(Trainer* trainer, Network* network, const float* inputs, const float* targets)
 {
-  if(inputs == NULL || targets == NULL) return 1;
+  if(trainer == NULL || network == NULL || inputs == NULL || targets == NULL) return 1;
+
+  TrainWorkspace* workspace = train_workspace_fit(trainer, *network, 1);
 
-  int status = weight_bias_deltas_create(network, inputs, targets);
+  if(workspace == NULL) return 2;
+
+  int status = weight_bias_deltas_create(trainer, workspace, network, inputs, targets);
   
-  if(status != 0) error_print("weight_bias_deltas_create");
+  if(status != 0) log_error("weight_bias_deltas_create");
+
+  PHASE_BEGIN(PHASE_UPDATE, updateTimer);
 
   size_t width = network->inputs;
 
   for(size_t index = 0; index < network->amount; index++)
   {
+    LAYER_BEGIN(update, index, layerTimer);
+
     NetworkLayer* layer = &network->layers[index];
 
     size_t height = layer->amount;
@@ -324,13 +460,24 @@ int network_train_stcast(Network* network, const float* inputs, const float* tar
     float_vector_elem_addit(layer->biases, layer->biases, layer->bdeltas, height);
 
     width = layer->amount;
+
+    LAYER_END(update, index, layerTimer);
   }
+  PHASE_END(PHASE_UPDATE, updateTimer);
+
+  PHASE_BEGIN(PHASE_COST, costTimer);
+
+  size_t outputAmount = network->layers[network->amount - 1].amount;
 
-  float outputs[1];
+  float outputs[outputAmount];
 
   network_forward(outputs, *network, inputs);
 
-  cost += cross_entropy_cost(outputs, targets, 1);
+  trainer->cost += cross_entropy_cost(outputs, targets, outputAmount);
+
+  PHASE_END(PHASE_COST, costTimer);
+
+  STATS_STEP_ADD(1);
 
   return 0;
 }
@@ -339,6 +486,7 @@ int network_train_stcast(Network* network, const float* inputs, const float* tar
  * Train the network stochastically on an epoch
  *
  * PARAMS
+ * - Trainer* trainer | The trainer of the training
  * - Network* network | The neural network
  * Size: epochs x inputs
  * - float** inputs   | An array of inputs 
@@ -349,22 +497,42 @@ int network_train_stcast(Network* network, const float* inputs, const float* tar
  * RETURN (int status)
  * - 0 | Success!
  * - 1 | Something else went wrong
+ * - 2 | An observer stopped the training
  */
-static int network_train_stcast_epoch(Network* network, float** inputs, float** targets, size_t amount)
+static int network_train_stcast_epoch(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t epoch)
 {
   // No need to check input paramters,
   // because this function is not going to be called by a user
 
   size_t randomIndexes[amount];
-  index_array_shuffled_fill(randomIndexes, amount);
+  index_array_shuffled_seed_fill(randomIndexes, amount, &trainer->random);
+
+  // The steps are only timed if an observer wants them
+  bool stepping = train_observers_stepping(trainer);
 
   for(size_t index = 0; index < amount; index++)
   {
     size_t randomIndex = randomIndexes[index];
 
-    int status = network_train_stcast(network, inputs[randomIndex], targets[randomIndex]);
+    uint64_t stepStart = stepping ? timer_nanos() : 0;
+
+    float epochCost = trainer->cost;
+
+    trainer->cost = 0;
+
+    TRACE_REGION_BEGIN("train", "step", "step", index + 1);
+
+    int status = network_train_stcast(trainer, network, inputs[randomIndex], targets[randomIndex]);
+
+    TRACE_REGION_END("train", "step");
+
+    float stepCost = trainer->cost;
+
+    trainer->cost = epochCost + stepCost;
 
     if(status != 0) return 1;
+
+    if(stepping && train_observers_step(trainer, network, epoch, index + 1, 1, stepCost, timer_nanos() - stepStart)) return 2;
   }
   return 0; // Success!
 }
@@ -373,6 +541,7 @@ static int network_train_stcast_epoch(Network* network, float** inputs, float**
  * Train the network stochastically multiple epochs
  *
  * PARAMS
+ * - Trainer* trainer | The trainer of the training
  * - Network* network | The neural network
  * Size: epochs x inputs
  * - float** inputs   | An array of inputs 
@@ -385,47 +554,73 @@ static int network_train_stcast_epoch(Network* network, float** inputs, float**
  * - 0 | Success!
  * - 1 | The inputted arguments are bad
  * - 2 | Something else went wrong
+ * - 3 | An observer stopped the training
  */
-int network_train_stcast_epochs(Network* network, float** inputs, float** targets, size_t amount, size_t epochs)
+int network_train_stcast_epochs(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t epochs)
 {
-  if(network == NULL || inputs == NULL || targets == NULL) return 1;
+  if(trainer == NULL || network == NULL || inputs == NULL || targets == NULL) return 1;
 
-  info_print("Training stochastically %d epochs", epochs);
+  log_info("Training stochastically %ld epochs", epochs);
 
   for(size_t index = 0; index < epochs; index++)
   {
-    info_print("Training epoch #%d with %d samples", index + 1, amount);
+    log_info("Training epoch #%ld with %ld samples", index + 1, amount);
+
+    train_stats_epoch_begin(trainer, index + 1, network->amount, 0);
 
-    int status = network_train_stcast_epoch(network, inputs, targets, amount);
+    int status = network_train_stcast_epoch(trainer, network, inputs, targets, amount, index + 1);
 
-    if(status != 0) return 2;
+    if(status == 1) return 2;
 
-    printf("Mean Cost #%02ld: %f\n", index + 1, cost / amount);
+    train_stats_epoch_end(trainer);
 
-    cost = 0;
+    bool stopped = train_observers_epoch(trainer, network, index + 1, amount, amount, trainer->cost);
+
+    trainer->cost = 0;
+
+    if(stopped || status == 2) return 3;
   }
   return 0;
 }
 
 /*
+ * Train the network on a mini batch, with the mean derivatives of the samples
+ *
+ * The buffers of the step are in the workspace of the trainer, which is created by the first step,
+ * so the steps after it do not allocate any memory (unless a batch is larger than every batch before)
+ *
  * PARAMS
+ * - Trainer* trainer | The trainer of the training
  * - Network* network | The neural network
  * - float** inputs   |
  * - float** targets  |
  * - size_t amount    | The size of the mini batch (the amount of inputs and targets)
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to create the workspace
  */
-int network_train_mini_batch(Network* network, float** inputs, float** targets, size_t amount)
+int network_train_mini_batch(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount)
 {
-  if(inputs == NULL || targets == NULL) return 1;
+  if(trainer == NULL || network == NULL || inputs == NULL || targets == NULL || amount == 0) return 1;
 
-  int status = weight_bias_mean_deltas_create(network, inputs, targets, amount);
+  TrainWorkspace* workspace = train_workspace_fit(trainer, *network, amount);
+
+  if(workspace == NULL) return 2;
+
+  int status = weight_bias_mean_deltas_create(trainer, workspace, network, inputs, targets, amount);
   
-  if(status != 0) error_print("weight_bias_deltas_create");
+  if(status != 0) log_error("weight_bias_deltas_create");
+
+  PHASE_BEGIN(PHASE_UPDATE, updateTimer);
 
   size_t width = network->inputs;
 
   for(size_t index = 0; index < network->amount; index++)
   {
+    LAYER_BEGIN(update, index, layerTimer);
+
     NetworkLayer* layer = &network->layers[index];
 
     size_t height = layer->amount;
@@ -435,39 +630,70 @@ int network_train_mini_batch(Network* network, float** inputs, float** targets,
     float_vector_elem_addit(layer->biases, layer->biases, layer->bdeltas, height);
 
     width = layer->amount;
+
+    LAYER_END(update, index, layerTimer);
   }
+  PHASE_END(PHASE_UPDATE, updateTimer);
+
+  PHASE_BEGIN(PHASE_COST, costTimer);
+
+  size_t outputAmount = network->layers[network->amount - 1].amount;
+
+  float** outputs = workspace->outputs;
+
+  network_forward_batch(outputs, *network, inputs, amount, trainer->options.pool);
 
   for(size_t index = 0; index < amount; index++)
   {
-    float outputs[1];
+    trainer->cost += cross_entropy_cost(outputs[index], targets[index], outputAmount);
+  }
 
-    network_forward(outputs, *network, inputs[index]);
+  PHASE_END(PHASE_COST, costTimer);
 
-    cost += cross_entropy_cost(outputs, targets[index], 1);
-  }
+  STATS_STEP_ADD(amount);
 
   return 0;
 }
 
-static int network_train_mini_batch_epoch(Network* network, float** inputs, float** targets, size_t amount, size_t bsize)
+static int network_train_mini_batch_epoch(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t bsize, size_t epoch)
 {
+  // The steps are only timed if an observer wants them
+  bool stepping = train_observers_stepping(trainer);
+
   for(size_t start = 0; start < amount; start += bsize)
   {
     size_t stop = (start + bsize);
     // The current size is bsize (the batch size), apart from at the end
     size_t csize = (stop <= amount) ? bsize : (amount - start); 
 
+    uint64_t stepStart = stepping ? timer_nanos() : 0;
+
+    float epochCost = trainer->cost;
+
+    trainer->cost = 0;
+
     // By adding (start) to the inputs pointer, I shift the passed argument
     // array to start (start) amount of elements later
-    int status = network_train_mini_batch(network, inputs + start, targets + start, csize);
+    TRACE_REGION_BEGIN("train", "batch", "batch", (start / bsize) + 1);
+
+    int status = network_train_mini_batch(trainer, network, inputs + start, targets + start, csize);
+
+    TRACE_REGION_END("train", "batch");
+
+    float stepCost = trainer->cost;
+
+    trainer->cost = epochCost + stepCost;
 
     if(status != 0) return 1;
+
+    if(stepping && train_observers_step(trainer, network, epoch, (start / bsize) + 1, csize, stepCost, timer_nanos() - stepStart)) return 2;
   }
   return 0;
 }
 
 /*
  * PARAMS
+ * - Trainer* trainer |
  * - Network* network |
  * - float** inputs   |
  * - float** targets  |
@@ -478,26 +704,34 @@ static int network_train_mini_batch_epoch(Network* network, float** inputs, floa
  * RETURN (int status)
  * - 0 | Success!
  * - 1 | The inputted arguments are bad
+ * - 2 | Something else went wrong
+ * - 3 | An observer stopped the training
  */
-int network_train_mini_batch_epochs(Network* network, float** inputs, float** targets, size_t amount, size_t bsize, size_t epochs)
+int network_train_mini_batch_epochs(Trainer* trainer, Network* network, float** inputs, float** targets, size_t amount, size_t bsize, size_t epochs)
 {
-  if(network == NULL || inputs == NULL || targets == NULL) return 1;
+  if(trainer == NULL || network == NULL || inputs == NULL || targets == NULL) return 1;
 
-  info_print("Training (epochs: %ld bsize: %ld amount: %ld)", epochs, bsize, amount);
+  log_info("Training (epochs: %ld bsize: %ld amount: %ld)", epochs, bsize, amount);
 
   for(size_t index = 0; index < epochs; index++)
   {
     int procent = 100 * ((float) (index + 1) / (float) epochs);
 
-    info_print("Training (epoch: #%ld progress: %d%%)", index + 1, procent);
+    log_info("Training (epoch: #%ld progress: %d%%)", index + 1, procent);
+
+    train_stats_epoch_begin(trainer, index + 1, network->amount, bsize);
+
+    int status = network_train_mini_batch_epoch(trainer, network, inputs, targets, amount, bsize, index + 1);
+
+    if(status == 1) return 2;
 
-    int status = network_train_mini_batch_epoch(network, inputs, targets, amount, bsize);
+    train_stats_epoch_end(trainer);
 
-    if(status != 0) return 2;
+    bool stopped = train_observers_epoch(trainer, network, index + 1, (amount + bsize - 1) / bsize, amount, trainer->cost);
 
-    printf("Mean Cost #%02ld: %f\n", index + 1, cost / amount);
+    trainer->cost = 0;
 
-    cost = 0;
+    if(stopped || status == 2) return 3;
   }
   return 0;
 }
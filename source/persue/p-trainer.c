@@ -0,0 +1,48 @@
+#include "../persue.h"
+
+#include "p-workspace-intern.h"
+
+/*
+ * Initialize a trainer, that holds the state of one training
+ *
+ * Every training that runs at the same time needs its own trainer,
+ * a trainer should not be used by two trainings at the same time
+ *
+ * PARAMS
+ * - Trainer* trainer           | The trainer to initialize
+ * - const TrainOptions* options | The options of the training, or NULL for no pool and a seed from rand
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int trainer_init(Trainer* trainer, const TrainOptions* options)
+{
+  if(trainer == NULL) return 1;
+
+  memset(trainer, 0, sizeof(Trainer));
+
+  if(options != NULL)
+  {
+    trainer->options = *options;
+  }
+  else trainer->options.seed = rand();
+
+  trainer->random = trainer->options.seed;
+
+  return 0; // Success!
+}
+
+/*
+ * Free the memory of a trainer, which is the workspace of the steps
+ *
+ * The pool of the options and the observers are not freed, they are owned by the caller
+ */
+void trainer_free(Trainer* trainer)
+{
+  if(trainer == NULL) return;
+
+  train_workspace_free(&trainer->workspace);
+
+  memset(trainer, 0, sizeof(Trainer));
+}
@@ -0,0 +1,157 @@
+#include "../persue.h"
+#include "../review.h"
+
+#include "p-stats-intern.h"
+
+#include <unistd.h>
+
+// The largest batch size that is tried
+#define TUNE_BSIZE_MAX 256
+
+/*
+ * Train a clone of the network for a trial with a batch size and an amount of threads
+ *
+ * The batches are taken one after another from the samples, and wrap around at the end
+ *
+ * RETURN (double samplesPerSecond)
+ * - The amount of samples trained per second, or 0 if the trial failed
+ */
+static double network_tune_trial(Network network, float** inputs, float** targets, size_t amount, size_t bsize, size_t threads, uint64_t trialNanos)
+{
+  Network clone;
+
+  if(network_clone(&clone, network) != 0) return 0;
+
+  ThreadPool pool;
+
+  if(threads > 1 && pool_init(&pool, threads, false) != 0)
+  {
+    network_free(&clone);
+
+    return 0;
+  }
+  // The trial has its own trainer, so it does not change the cost or the stats of another training
+  TrainOptions options = { .pool = (threads > 1) ? &pool : NULL, .seed = 0 };
+
+  Trainer trainer;
+
+  trainer_init(&trainer, &options);
+
+  TRACE_REGION_BEGIN("tune", "trial", "bsize", bsize);
+
+  // The first batch warms up the caches and the threads, and is not counted
+  network_train_mini_batch(&trainer, &clone, inputs, targets, bsize);
+
+  size_t samples = 0;
+  size_t start = 0;
+
+  uint64_t trialStart = timer_nanos();
+  uint64_t nanos = 0;
+
+  while(nanos < trialNanos)
+  {
+    if((start + bsize) > amount) start = 0;
+
+    if(network_train_mini_batch(&trainer, &clone, inputs + start, targets + start, bsize) != 0) break;
+
+    start += bsize;
+    samples += bsize;
+
+    nanos = timer_nanos() - trialStart;
+  }
+  TRACE_REGION_END("tune", "trial");
+
+  trainer_free(&trainer);
+
+  if(threads > 1) pool_free(&pool);
+
+  network_free(&clone);
+
+  return (nanos > 0) ? (1e9 * samples / nanos) : 0;
+}
+
+/*
+ * Get the next amount of threads to try, the max amount is tried as well even if it is not a power of two
+ */
+static size_t tune_threads_next(size_t threads, size_t maxThreads)
+{
+  return ((threads * 2) > maxThreads && threads < maxThreads) ? maxThreads : (threads * 2);
+}
+
+/*
+ * Find the batch size and the amount of threads that train the network on the samples the fastest
+ *
+ * Every power of two batch size up to the amount of samples (at most 256) is tried
+ * with 1, 2, 4 ... up to the max amount of threads, in short timed trials on a clone of the network.
+ * No more threads than samples in a batch are tried, because the samples are spread over the threads
+ *
+ * Note: Only the throughput is measured, a larger batch size also takes fewer steps per epoch,
+ * which can need another learning rate to converge as well
+ *
+ * PARAMS
+ * - TuneResult* result  | The tried configurations and the best one
+ * - Network network     | The neural network, which is not changed
+ * - float** inputs      | The inputs of the samples
+ * - float** targets     | The targets of the samples
+ * - size_t amount       | The amount of samples
+ * - size_t maxThreads   | The most threads to try, or 0 for one per online processor
+ * - uint64_t trialNanos | The time of every trial
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | No trial succeeded
+ */
+int network_tune(TuneResult* result, Network network, float** inputs, float** targets, size_t amount, size_t maxThreads, uint64_t trialNanos)
+{
+  if(result == NULL || inputs == NULL || targets == NULL || amount == 0) return 1;
+
+  if(maxThreads == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    maxThreads = (processors > 0) ? processors : 1;
+  }
+
+  if(maxThreads > POOL_THREADS) maxThreads = POOL_THREADS;
+
+  memset(result, 0, sizeof(TuneResult));
+
+  for(size_t bsize = 1; bsize <= amount && bsize <= TUNE_BSIZE_MAX; bsize *= 2)
+  {
+    for(size_t threads = 1; threads <= maxThreads && threads <= bsize; threads = tune_threads_next(threads, maxThreads))
+    {
+      if(result->trialAmount >= TUNE_TRIALS) break;
+
+      double samplesPerSecond = network_tune_trial(network, inputs, targets, amount, bsize, threads, trialNanos);
+
+      log_debug("Tune trial (bsize: %ld threads: %ld): %.1f samples/s", bsize, threads, samplesPerSecond);
+
+      TuneTrial* trial = &result->trials[result->trialAmount++];
+
+      *trial = (TuneTrial) { .bsize = bsize, .threads = threads, .samplesPerSecond = samplesPerSecond };
+
+      if(samplesPerSecond > result->best.samplesPerSecond) result->best = *trial;
+    }
+  }
+  return (result->best.samplesPerSecond > 0) ? 0 : 2;
+}
+
+/*
+ * Print every tried configuration of the tuner, and mark the best one
+ */
+void network_tune_print(const TuneResult* result)
+{
+  if(result == NULL) return;
+
+  printf("Tune trials:\n");
+
+  for(size_t index = 0; index < result->trialAmount; index++)
+  {
+    const TuneTrial* trial = &result->trials[index];
+
+    bool best = (trial->bsize == result->best.bsize && trial->threads == result->best.threads);
+
+    printf("  bsize %4ld threads %3ld : %12.1f samples/s%s\n", trial->bsize, trial->threads, trial->samplesPerSecond, best ? " (best)" : "");
+  }
+}
@@ -0,0 +1,8 @@
+#ifndef P_WORKSPACE_INTERN_H
+#define P_WORKSPACE_INTERN_H
+
+extern TrainWorkspace* train_workspace_fit(Trainer* trainer, Network network, size_t bsize);
+
+extern void train_workspace_free(TrainWorkspace* workspace);
+
+#endif // P_WORKSPACE_INTERN_H
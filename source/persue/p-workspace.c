@@ -0,0 +1,230 @@
+#define _GNU_SOURCE
+
+#include "../persue.h"
+
+#include "p-network-intern.h"
+#include "p-workspace-intern.h"
+
+#include <sched.h>
+
+/*
+ * Create the buffers of one thread
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to allocate the buffers (the created buffers are kept, to be freed)
+ */
+static int thread_workspace_create(ThreadWorkspace* space, size_t layers, size_t maxSize)
+{
+  if((space->values = float_matrix_create(layers + 1, maxSize)) == NULL) return 1;
+
+  if((space->derivs = float_matrix_create(layers, maxSize)) == NULL) return 1;
+
+  if((space->transp = float_matrix_create(maxSize, maxSize)) == NULL) return 1;
+
+  if((space->wderivs = float_matarr_create(layers, maxSize, maxSize)) == NULL) return 1;
+
+  if((space->bderivs = float_matrix_create(layers, maxSize)) == NULL) return 1;
+
+  if((space->swderivs = float_matarr_create(layers, maxSize, maxSize)) == NULL) return 1;
+
+  if((space->sbderivs = float_matrix_create(layers, maxSize)) == NULL) return 1;
+
+  return 0; // Success!
+}
+
+static void thread_workspace_free(ThreadWorkspace* space, size_t layers, size_t maxSize)
+{
+  float_matrix_free(&space->values, layers + 1, maxSize);
+  float_matrix_free(&space->derivs, layers, maxSize);
+  float_matrix_free(&space->transp, maxSize, maxSize);
+
+  float_matarr_free(&space->wderivs, layers, maxSize, maxSize);
+  float_matrix_free(&space->bderivs, layers, maxSize);
+
+  float_matarr_free(&space->swderivs, layers, maxSize, maxSize);
+  float_matrix_free(&space->sbderivs, layers, maxSize);
+}
+
+/*
+ * Free the buffers of a workspace, the workspace can be created again after this
+ */
+void train_workspace_free(TrainWorkspace* workspace)
+{
+  if(workspace == NULL) return;
+
+  if(workspace->spaces != NULL)
+  {
+    for(size_t thread = 0; thread < workspace->threads; thread++)
+    {
+      thread_workspace_free(&workspace->spaces[thread], workspace->layers, workspace->maxSize);
+    }
+    free(workspace->spaces);
+  }
+  float_matrix_free(&workspace->twdeltas, workspace->maxSize, workspace->maxSize);
+
+  float_matrix_free(&workspace->outputs, workspace->bsize, workspace->outputAmount);
+
+  memset(workspace, 0, sizeof(TrainWorkspace));
+}
+
+/*
+ * Create the buffers of a workspace for a network, the threads of a pool and a batch size
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to allocate the buffers
+ */
+static int train_workspace_create(TrainWorkspace* workspace, Network network, size_t threads, size_t bsize)
+{
+  memset(workspace, 0, sizeof(TrainWorkspace));
+
+  workspace->layers = network.amount;
+  workspace->maxSize = network_max_layer_nodes(network);
+  workspace->outputAmount = network.layers[network.amount - 1].amount;
+  workspace->threads = threads;
+  workspace->bsize = bsize;
+
+  workspace->spaces = malloc(sizeof(ThreadWorkspace) * threads);
+
+  if(workspace->spaces == NULL)
+  {
+    memset(workspace, 0, sizeof(TrainWorkspace));
+
+    return 1;
+  }
+
+  // The buffers that are not created are NULL, so a partial workspace can be freed
+  memset(workspace->spaces, 0, sizeof(ThreadWorkspace) * threads);
+
+  for(size_t thread = 0; thread < threads; thread++)
+  {
+    if(thread_workspace_create(&workspace->spaces[thread], workspace->layers, workspace->maxSize) != 0)
+    {
+      train_workspace_free(workspace);
+
+      return 1;
+    }
+  }
+  workspace->twdeltas = float_matrix_create(workspace->maxSize, workspace->maxSize);
+
+  workspace->outputs = float_matrix_create(bsize, workspace->outputAmount);
+
+  if(workspace->twdeltas == NULL || workspace->outputs == NULL)
+  {
+    train_workspace_free(workspace);
+
+    return 1;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Get the workspace of a trainer, that fits the network and a batch size
+ *
+ * The workspace is created by the first step, and is only created again if the network
+ * has another shape, or if the batch is larger than any batch before
+ *
+ * RETURN (TrainWorkspace* workspace)
+ * - SUCCESS | The workspace of the trainer
+ * - ERROR   | NULL
+ */
+TrainWorkspace* train_workspace_fit(Trainer* trainer, Network network, size_t bsize)
+{
+  if(network.amount == 0) return NULL;
+
+  TrainWorkspace* workspace = &trainer->workspace;
+
+  size_t threads = pool_threads(trainer->options.pool);
+
+  bool fits = workspace->layers == network.amount && workspace->maxSize == network_max_layer_nodes(network) &&
+    workspace->outputAmount == network.layers[network.amount - 1].amount && workspace->threads == threads && workspace->bsize >= bsize;
+
+  if(fits) return workspace;
+
+  // The outputs keep room for the largest batch so far, so a smaller last batch does not create them again
+  if(workspace->bsize > bsize) bsize = workspace->bsize;
+
+  train_workspace_free(workspace);
+
+  return (train_workspace_create(workspace, network, threads, bsize) == 0) ? workspace : NULL;
+}
+
+/*
+ * Get the bytes of a matrix, as it is allocated by float_matrix_create
+ */
+static size_t matrix_bytes(size_t height, size_t width)
+{
+  return (sizeof(float*) * height) + (sizeof(float) * height * width);
+}
+
+/*
+ * Calculate the memory that the training state of a trainer uses, besides the network
+ *
+ * The workspace is created by the first step, so call this after a step to get its size
+ *
+ * Note: The overhead of malloc is not counted, but every row of a matrix is its own allocation
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int train_memory_usage(TrainMemory* memory, const Trainer* trainer)
+{
+  if(memory == NULL || trainer == NULL) return 1;
+
+  memset(memory, 0, sizeof(TrainMemory));
+
+  const TrainWorkspace* workspace = &trainer->workspace;
+
+  if(workspace->spaces != NULL)
+  {
+    size_t layers = workspace->layers;
+    size_t maxSize = workspace->maxSize;
+
+    // The weight derivatives and their sums are arrays of matrices
+    size_t matarrBytes = (sizeof(float**) * layers) + (layers * matrix_bytes(maxSize, maxSize));
+
+    size_t spaceBytes = matrix_bytes(layers + 1, maxSize) + matrix_bytes(layers, maxSize) + matrix_bytes(maxSize, maxSize) +
+      (2 * matarrBytes) + (2 * matrix_bytes(layers, maxSize));
+
+    memory->threadSpaces = (sizeof(ThreadWorkspace) + spaceBytes) * workspace->threads;
+
+    memory->shared = matrix_bytes(maxSize, maxSize) + matrix_bytes(workspace->bsize, workspace->outputAmount);
+  }
+
+  const ThreadPool* pool = trainer->options.pool;
+
+  // A freed pool has no threads
+  if(pool != NULL && pool->threads > 0)
+  {
+    memory->pool = sizeof(ThreadPool) + ((pool->oldAffinity != NULL) ? sizeof(cpu_set_t) : 0);
+
+    pthread_attr_t attributes;
+
+    size_t stackSize = 0;
+
+    // The workers are created with the default attributes, so they get the default stack size
+    if(pthread_attr_init(&attributes) == 0)
+    {
+      pthread_attr_getstacksize(&attributes, &stackSize);
+
+      pthread_attr_destroy(&attributes);
+    }
+    memory->stacks = stackSize * (pool->threads - 1);
+  }
+  memory->total = memory->threadSpaces + memory->shared + memory->pool + memory->stacks;
+
+  return 0; // Success!
+}
+
+/*
+ * Print the memory that the training state of a trainer uses
+ */
+void train_memory_print(const TrainMemory* memory)
+{
+  if(memory == NULL) return;
+
+  printf("Train memory: %ld bytes (thread workspaces %ld | shared %ld | pool %ld | stacks %ld)\n",
+    memory->total, memory->threadSpaces, memory->shared, memory->pool, memory->stacks);
+}
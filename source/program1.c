@@ -58,7 +58,17 @@ int main(int argc, char* argv[])
   printf("===== BIAS BEFORE END ========\n");
   printf("Cost: %.2f\n", cross_entropy_cost(toutputs, targets[0], outputAmount));
 
-  network_train_stcast_epochs(&network, inputs, targets, 1, 10);
+  Trainer trainer;
+
+  trainer_init(&trainer, NULL);
+
+  train_observer_add(&trainer, &trainPrintObserver);
+
+  network_train_stcast_epochs(&trainer, &network, inputs, targets, 1, 10);
+
+  train_observer_remove(&trainer, &trainPrintObserver);
+
+  trainer_free(&trainer);
 
   network_forward(toutputs, network, inputs[0]);
   printf("===== WEIGHTS AFTER =====\n");
@@ -7,6 +7,81 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+// This are identifiers for the hardware counters of a region
+typedef enum { PERF_CYCLES, PERF_INSTRUCTIONS, PERF_CACHE_MISSES, PERF_BRANCH_MISSES, PERF_AMOUNT } perf_counter_t;
+
+// This is the maximum amount of regions that can be counted
+#define PERF_REGIONS 128
+
+typedef struct
+{
+  char name[32];                // The name of the region
+  uint64_t calls;               // The amount of times the region has been entered
+  uint64_t counts[PERF_AMOUNT]; // The summed counts of every counter
+} PerfRegion;
+
+// This are the log levels, from the least to the most verbose
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+// The events above this level are compiled out, so they cost nothing
+// (the disabled macros are never evaluated, they only keep the arguments checked and used)
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define log_error(...) log_event_record(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define log_error(...) ((void) sizeof(log_event_record(LOG_LEVEL_ERROR, __VA_ARGS__)))
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define log_warn(...) log_event_record(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define log_warn(...) ((void) sizeof(log_event_record(LOG_LEVEL_WARN, __VA_ARGS__)))
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define log_info(...) log_event_record(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define log_info(...) ((void) sizeof(log_event_record(LOG_LEVEL_INFO, __VA_ARGS__)))
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define log_debug(...) log_event_record(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define log_debug(...) ((void) sizeof(log_event_record(LOG_LEVEL_DEBUG, __VA_ARGS__)))
+#endif
+
+// The amount of sub buckets of every power of two is 2^HISTO_SUB_BITS,
+// which makes the relative error of a recorded value at most 1 / 2^HISTO_SUB_BITS
+#define HISTO_SUB_BITS 5
+
+#define HISTO_BUCKETS ((65 - HISTO_SUB_BITS) << HISTO_SUB_BITS)
+
+typedef struct
+{
+  uint64_t counts[HISTO_BUCKETS]; // The amount of values in every log bucket
+  uint64_t total;                 // The amount of recorded values
+  uint64_t sum;                   // The sum of the recorded values
+  uint64_t min;                   // The lowest recorded value
+  uint64_t max;                   // The highest recorded value
+} Histogram;
+
+// This is the maximum amount of gauges that the stats server can serve
+#define STATS_GAUGES 64
+
+// Time a statement and record its nanoseconds in a histogram
+#define HISTO_TIMED(histo, statement) \
+  do { uint64_t histoStart = timer_nanos(); statement; histo_record((histo), timer_nanos() - histoStart); } while(0)
 
 extern int debug_print(FILE* stream, const char* title, const char* format, ...);
 
@@ -16,4 +91,70 @@ extern int info_print(const char* format, ...);
 
 extern int format_string(char* buffer, const char* format, ...);
 
+extern int log_event_record(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+extern void log_level_set(int level);
+
+extern int logger_start(void);
+
+extern void logger_stop(void);
+
+extern uint64_t timer_nanos(void);
+
+extern double timer_seconds(void);
+
+extern void histo_init(Histogram* histo);
+
+extern void histo_record(Histogram* histo, uint64_t value);
+
+extern void histo_merge(Histogram* destin, const Histogram* source);
+
+extern uint64_t histo_percentile(const Histogram* histo, double percentile);
+
+extern void histo_print(FILE* stream, const Histogram* histo, const char* name);
+
+extern void histo_dump(FILE* stream, const Histogram* histo);
+
+extern int stats_gauge_set(const char* name, const char* help, double value);
+
+extern void stats_gauges_write(FILE* stream);
+
+extern int stats_server_start(const char* path);
+
+extern void stats_server_stop(void);
+
+extern int trace_start(const char* path);
+
+extern int trace_stop(void);
+
+extern void trace_begin(const char* category, const char* name, const char* argName, int64_t arg);
+
+extern void trace_end(const char* category, const char* name);
+
+extern void trace_detail_begin(const char* category, const char* name, const char* argName, int64_t arg);
+
+extern void trace_detail_end(const char* category, const char* name);
+
+extern void trace_detail_set(bool detail);
+
+extern void trace_thread_name(const char* name);
+
+extern int profile_start(const char* path, int hertz);
+
+extern int profile_stop(void);
+
+extern int perf_open(void);
+
+extern void perf_close(void);
+
+extern int perf_region_create(const char* name);
+
+extern void perf_region_begin(int region);
+
+extern void perf_region_end(int region);
+
+extern int perf_region_get(PerfRegion* result, int region);
+
+extern void perf_regions_print(FILE* stream);
+
 #endif // REVIEW_H
@@ -0,0 +1,190 @@
+#include "../review.h"
+
+// The values below HISTO_SUBS have their own buckets, the larger values
+// share a bucket with the values that have the same HISTO_SUB_BITS + 1 highest bits
+#define HISTO_SUBS (1 << HISTO_SUB_BITS)
+
+/*
+ * Get the bucket of a value
+ */
+static size_t histo_bucket(uint64_t value)
+{
+  if(value < HISTO_SUBS) return value;
+
+  size_t shift = (63 - __builtin_clzll(value)) - HISTO_SUB_BITS;
+
+  // The highest bits of the value, from HISTO_SUBS to 2 * HISTO_SUBS - 1
+  size_t mantissa = (value >> shift);
+
+  return ((shift + 1) * HISTO_SUBS) + (mantissa - HISTO_SUBS);
+}
+
+/*
+ * Get the highest value of a bucket
+ */
+static uint64_t histo_bucket_high(size_t bucket)
+{
+  if(bucket < HISTO_SUBS) return bucket;
+
+  size_t shift = (bucket / HISTO_SUBS) - 1;
+
+  uint64_t mantissa = (bucket % HISTO_SUBS) + HISTO_SUBS;
+
+  return ((mantissa + 1) << shift) - 1;
+}
+
+/*
+ * Get the lowest value of a bucket
+ */
+static uint64_t histo_bucket_low(size_t bucket)
+{
+  if(bucket < HISTO_SUBS) return bucket;
+
+  size_t shift = (bucket / HISTO_SUBS) - 1;
+
+  uint64_t mantissa = (bucket % HISTO_SUBS) + HISTO_SUBS;
+
+  return (mantissa << shift);
+}
+
+/*
+ * Initialize an empty histogram
+ */
+void histo_init(Histogram* histo)
+{
+  memset(histo, 0, sizeof(Histogram));
+
+  histo->min = UINT64_MAX;
+}
+
+/*
+ * Record a value in a histogram
+ *
+ * Every field is updated with atomics, so many threads can record to the same histogram.
+ * The relative error of a recorded value is at most 1 / 2^HISTO_SUB_BITS
+ */
+void histo_record(Histogram* histo, uint64_t value)
+{
+  __atomic_fetch_add(&histo->counts[histo_bucket(value)], 1, __ATOMIC_RELAXED);
+
+  __atomic_fetch_add(&histo->total, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&histo->sum, value, __ATOMIC_RELAXED);
+
+  uint64_t min = __atomic_load_n(&histo->min, __ATOMIC_RELAXED);
+
+  while(value < min && !__atomic_compare_exchange_n(&histo->min, &min, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  uint64_t max = __atomic_load_n(&histo->max, __ATOMIC_RELAXED);
+
+  while(value > max && !__atomic_compare_exchange_n(&histo->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/*
+ * Add the recorded values of the source histogram to the destination histogram
+ *
+ * Note: The source should not be recorded to while it is merged,
+ * but the destination can be recorded to by other threads
+ */
+void histo_merge(Histogram* destin, const Histogram* source)
+{
+  for(size_t bucket = 0; bucket < HISTO_BUCKETS; bucket++)
+  {
+    if(source->counts[bucket] > 0) __atomic_fetch_add(&destin->counts[bucket], source->counts[bucket], __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&destin->total, source->total, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&destin->sum, source->sum, __ATOMIC_RELAXED);
+
+  uint64_t min = __atomic_load_n(&destin->min, __ATOMIC_RELAXED);
+
+  while(source->min < min && !__atomic_compare_exchange_n(&destin->min, &min, source->min, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  uint64_t max = __atomic_load_n(&destin->max, __ATOMIC_RELAXED);
+
+  while(source->max > max && !__atomic_compare_exchange_n(&destin->max, &max, source->max, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/*
+ * Get the value at a percentile of a histogram
+ *
+ * The highest value of the bucket is returned, so the percentile is never underestimated
+ *
+ * PARAMS
+ * - const Histogram* histo | The histogram
+ * - double percentile      | The percentile, from 0 to 100
+ *
+ * RETURN (uint64_t value)
+ * - The value at the percentile, or 0 if no value has been recorded
+ */
+uint64_t histo_percentile(const Histogram* histo, double percentile)
+{
+  uint64_t total = __atomic_load_n(&histo->total, __ATOMIC_RELAXED);
+
+  if(total == 0) return 0;
+
+  if(percentile > 100) percentile = 100;
+
+  // The amount of values that are at or below the percentile (at least one)
+  double exact = (percentile / 100) * total;
+
+  uint64_t rank = (uint64_t) exact;
+
+  if(rank < exact || rank < 1) rank++;
+
+  uint64_t count = 0;
+
+  for(size_t bucket = 0; bucket < HISTO_BUCKETS; bucket++)
+  {
+    count += __atomic_load_n(&histo->counts[bucket], __ATOMIC_RELAXED);
+
+    if(count >= rank)
+    {
+      uint64_t high = histo_bucket_high(bucket);
+
+      // The bucket can not hold a value higher than the highest recorded value
+      uint64_t max = __atomic_load_n(&histo->max, __ATOMIC_RELAXED);
+
+      return (high < max) ? high : max;
+    }
+  }
+  return __atomic_load_n(&histo->max, __ATOMIC_RELAXED);
+}
+
+/*
+ * Print the count, mean and the percentiles of a histogram of nanoseconds, in microseconds
+ */
+void histo_print(FILE* stream, const Histogram* histo, const char* name)
+{
+  uint64_t total = __atomic_load_n(&histo->total, __ATOMIC_RELAXED);
+
+  if(total == 0)
+  {
+    fprintf(stream, "%s: no values\n", name);
+
+    return;
+  }
+
+  double mean = (double) __atomic_load_n(&histo->sum, __ATOMIC_RELAXED) / total;
+
+  fprintf(stream, "%s: %lu calls | min %.3f us | mean %.3f us | p50 %.3f us | p99 %.3f us | p999 %.3f us | max %.3f us\n", name, (unsigned long) total,
+    (double) histo->min / 1e3, mean / 1e3,
+    (double) histo_percentile(histo, 50) / 1e3,
+    (double) histo_percentile(histo, 99) / 1e3,
+    (double) histo_percentile(histo, 99.9) / 1e3,
+    (double) histo->max / 1e3);
+}
+
+/*
+ * Dump every bucket that has values, as "low high count" lines,
+ * so that the histogram can be plotted or compared with an earlier dump
+ */
+void histo_dump(FILE* stream, const Histogram* histo)
+{
+  for(size_t bucket = 0; bucket < HISTO_BUCKETS; bucket++)
+  {
+    uint64_t count = __atomic_load_n(&histo->counts[bucket], __ATOMIC_RELAXED);
+
+    if(count == 0) continue;
+
+    fprintf(stream, "%lu %lu %lu\n", (unsigned long) histo_bucket_low(bucket), (unsigned long) histo_bucket_high(bucket), (unsigned long) count);
+  }
+}
@@ -0,0 +1,433 @@
+#include "../review.h"
+
+#include <unistd.h>
+
+// The amount of events in the ring buffer, must be a power of two
+#define LOG_CAPACITY 1024
+
+// The maximum amount of arguments of an event
+#define LOG_ARGS 8
+
+// The size of the buffer for the string arguments of an event
+#define LOG_STRINGS 96
+
+typedef struct
+{
+  size_t sequence;          // The sequence number that says if the cell is free or filled
+  uint64_t nanos;           // The realtime of the event in nanoseconds
+  int level;                // The level of the event
+  const char* format;       // The format string, which has to be a string literal
+  size_t amount;            // The amount of arguments
+  union
+  {
+    int64_t signedValue;
+    uint64_t unsignedValue;
+    double doubleValue;
+    size_t stringOffset;    // The offset of the string in the strings buffer
+  } args[LOG_ARGS];         // The raw arguments
+  char strings[LOG_STRINGS]; // The copied string arguments
+} LogEvent;
+
+static LogEvent events[LOG_CAPACITY];
+
+// The positions of the producers and the consumer
+static size_t enqueuePos = 0;
+static size_t dequeuePos = 0;
+
+// The amount of events that were dropped because the ring buffer was full
+static size_t droppedAmount = 0;
+
+// The most verbose level that is recorded, which can be lowered at runtime
+static int logLevel = LOG_LEVEL;
+
+static pthread_t loggerThread;
+static bool loggerRunning = false;
+static bool loggerStopping = false;
+
+static const char* levelTitles[] = {"", "\e[1;31mERROR\e[0m", "\e[1;33mWARN \e[0m", "\e[1;37mINFO \e[0m", "\e[1;34mDEBUG\e[0m"};
+
+/*
+ * Parse a format specifier, from after the % to after the conversion character
+ *
+ * RETURN (const char* end)
+ * - The position after the conversion character
+ */
+static const char* format_specifier_parse(const char* specifier, char* conversion, int* longs, bool* sized)
+{
+  *longs = 0;
+  *sized = false;
+
+  // Flags, width and precision
+  while(*specifier != '\0' && strchr("-+ #0123456789.", *specifier)) specifier++;
+
+  // Length modifiers
+  for(; *specifier != '\0' && strchr("hlzjtL", *specifier); specifier++)
+  {
+    if(*specifier == 'l') (*longs)++;
+
+    if(*specifier == 'z' || *specifier == 'j' || *specifier == 't') *sized = true;
+  }
+  *conversion = *specifier;
+
+  return (*specifier != '\0') ? (specifier + 1) : specifier;
+}
+
+/*
+ * Widen an integer specifier to long long, by inserting "ll" before the conversion character
+ */
+static void format_specifier_widen(char* specifier, size_t length)
+{
+  specifier[length + 1] = specifier[length - 1];
+  specifier[length + 2] = '\0';
+
+  specifier[length - 1] = 'l';
+  specifier[length] = 'l';
+}
+
+/*
+ * Capture the arguments of a format string into an event, without formatting them
+ */
+static void log_event_args_capture(LogEvent* event, const char* format, va_list args)
+{
+  size_t stringsLength = 0;
+
+  event->amount = 0;
+
+  for(const char* current = strchr(format, '%'); current != NULL && event->amount < LOG_ARGS; current = strchr(current, '%'))
+  {
+    char conversion;
+    int longs;
+    bool sized;
+
+    current = format_specifier_parse(current + 1, &conversion, &longs, &sized);
+
+    if(conversion == '%' || conversion == '\0') continue;
+
+    size_t index = event->amount++;
+
+    if(strchr("di", conversion))
+    {
+      if(sized || longs == 1) event->args[index].signedValue = va_arg(args, long);
+
+      else if(longs >= 2) event->args[index].signedValue = va_arg(args, long long);
+
+      else event->args[index].signedValue = va_arg(args, int);
+    }
+    else if(strchr("uxXoc", conversion))
+    {
+      if(sized || longs == 1) event->args[index].unsignedValue = va_arg(args, unsigned long);
+
+      else if(longs >= 2) event->args[index].unsignedValue = va_arg(args, unsigned long long);
+
+      else event->args[index].unsignedValue = va_arg(args, unsigned int);
+    }
+    else if(strchr("fFeEgGaA", conversion))
+    {
+      // ‘float’ is promoted to ‘double’ when passed through ‘...’
+      event->args[index].doubleValue = va_arg(args, double);
+    }
+    else if(conversion == 's')
+    {
+      const char* string = va_arg(args, const char*);
+
+      if(string == NULL) string = "(null)";
+
+      // The buffer is full, so the string points at the terminator of the last string, which is empty
+      if(stringsLength >= LOG_STRINGS)
+      {
+        event->args[index].stringOffset = (LOG_STRINGS - 1);
+
+        continue;
+      }
+      size_t length = strlen(string);
+
+      // Strings that don't fit are cut off
+      if(stringsLength + length + 1 > LOG_STRINGS) length = (LOG_STRINGS - stringsLength - 1);
+
+      event->args[index].stringOffset = stringsLength;
+
+      memcpy(event->strings + stringsLength, string, length);
+
+      stringsLength += length;
+
+      event->strings[stringsLength++] = '\0';
+    }
+    else event->args[index].unsignedValue = (uintptr_t) va_arg(args, void*);
+  }
+}
+
+/*
+ * Format and print an event to its stream
+ */
+static void log_event_print(const LogEvent* event)
+{
+  char buffer[1024];
+  size_t length = 0;
+
+  size_t argIndex = 0;
+
+  const char* current = event->format;
+
+  while(*current != '\0' && length < sizeof(buffer) - 1)
+  {
+    if(*current != '%')
+    {
+      buffer[length++] = *current++;
+
+      continue;
+    }
+
+    char conversion;
+    int longs;
+    bool sized;
+
+    const char* end = format_specifier_parse(current + 1, &conversion, &longs, &sized);
+
+    // The specifier is copied without its length modifiers, because the arguments are widened
+    char specifier[32];
+    size_t specLength = 0;
+
+    for(const char* part = current; part < end && specLength < sizeof(specifier) - 3; part++)
+    {
+      if(!strchr("hlzjtL", *part)) specifier[specLength++] = *part;
+    }
+    specifier[specLength] = '\0';
+
+    size_t space = sizeof(buffer) - length;
+
+    int written = 0;
+
+    if(conversion == '%') written = snprintf(buffer + length, space, "%%");
+
+    else if(argIndex >= event->amount) written = snprintf(buffer + length, space, "%s", "?");
+
+    else if(strchr("di", conversion))
+    {
+      format_specifier_widen(specifier, specLength);
+
+      written = snprintf(buffer + length, space, specifier, (long long) event->args[argIndex++].signedValue);
+    }
+    else if(strchr("uxXo", conversion))
+    {
+      format_specifier_widen(specifier, specLength);
+
+      written = snprintf(buffer + length, space, specifier, (unsigned long long) event->args[argIndex++].unsignedValue);
+    }
+    else if(conversion == 'c') written = snprintf(buffer + length, space, specifier, (int) event->args[argIndex++].unsignedValue);
+
+    else if(strchr("fFeEgGaA", conversion)) written = snprintf(buffer + length, space, specifier, event->args[argIndex++].doubleValue);
+
+    else if(conversion == 's') written = snprintf(buffer + length, space, specifier, event->strings + event->args[argIndex++].stringOffset);
+
+    else written = snprintf(buffer + length, space, specifier, (void*) (uintptr_t) event->args[argIndex++].unsignedValue);
+
+    if(written > 0) length += ((size_t) written < space) ? (size_t) written : (space - 1);
+
+    current = end;
+  }
+  buffer[length] = '\0';
+
+  time_t seconds = (event->nanos / 1000000000);
+
+  struct tm timeInfo;
+  localtime_r(&seconds, &timeInfo);
+
+  char timeString[16];
+  strftime(timeString, sizeof(timeString), "%H:%M:%S", &timeInfo);
+
+  FILE* stream = (event->level <= LOG_LEVEL_WARN) ? stderr : stdout;
+
+  fprintf(stream, "[%s.%03ld] [ %s ]: %s\n", timeString, (long) ((event->nanos / 1000000) % 1000), levelTitles[event->level], buffer);
+}
+
+/*
+ * Take the oldest event out of the ring buffer and print it
+ *
+ * RETURN (bool printed)
+ * - true  | An event was printed
+ * - false | The ring buffer was empty
+ */
+static bool log_event_dequeue(void)
+{
+  LogEvent* event = &events[dequeuePos & (LOG_CAPACITY - 1)];
+
+  size_t sequence = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+
+  // The cell is not filled yet
+  if(sequence != dequeuePos + 1) return false;
+
+  log_event_print(event);
+
+  // The cell is free to be filled again, one lap later
+  __atomic_store_n(&event->sequence, dequeuePos + LOG_CAPACITY, __ATOMIC_RELEASE);
+
+  dequeuePos++;
+
+  return true;
+}
+
+/*
+ * The routine of the background thread that formats and prints the events
+ */
+static void* logger_routine(void* data)
+{
+  while(true)
+  {
+    bool printed = false;
+
+    while(log_event_dequeue()) printed = true;
+
+    if(printed)
+    {
+      fflush(stdout);
+      fflush(stderr);
+    }
+
+    // Every event has been printed, so the thread can stop
+    if(__atomic_load_n(&loggerStopping, __ATOMIC_ACQUIRE) && !printed) break;
+
+    if(!printed) usleep(1000);
+  }
+  return NULL;
+}
+
+/*
+ * Set the most verbose level that is recorded, the events above it are ignored
+ *
+ * Note: The levels above LOG_LEVEL are compiled out, so they can not be turned on
+ */
+void log_level_set(int level)
+{
+  __atomic_store_n(&logLevel, level, __ATOMIC_RELAXED);
+}
+
+/*
+ * Record an event into the ring buffer, or print it directly if the logger is not started
+ *
+ * Note: Use the log_error, log_warn, log_info and log_debug macros,
+ * so that the events below LOG_LEVEL are compiled out
+ *
+ * Note: The format string has to be a string literal (or live for the rest of the program),
+ * because only the pointer to it is recorded. Strings arguments are copied.
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The ring buffer was full and the event was dropped
+ */
+int log_event_record(int level, const char* format, ...)
+{
+  if(level > __atomic_load_n(&logLevel, __ATOMIC_RELAXED)) return 0;
+
+  struct timespec timespec;
+  clock_gettime(CLOCK_REALTIME, &timespec);
+
+  uint64_t nanos = ((uint64_t) timespec.tv_sec * 1000000000) + timespec.tv_nsec;
+
+  va_list args;
+
+  if(!__atomic_load_n(&loggerRunning, __ATOMIC_ACQUIRE))
+  {
+    LogEvent event = { .nanos = nanos, .level = level, .format = format };
+
+    va_start(args, format);
+
+    log_event_args_capture(&event, format, args);
+
+    va_end(args);
+
+    log_event_print(&event);
+
+    return 0; // Success!
+  }
+
+  size_t position = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+
+  LogEvent* event;
+
+  // Claim a free cell, by moving the enqueue position past it
+  while(true)
+  {
+    event = &events[position & (LOG_CAPACITY - 1)];
+
+    size_t sequence = __atomic_load_n(&event->sequence, __ATOMIC_ACQUIRE);
+
+    intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+
+    if(difference == 0)
+    {
+      if(__atomic_compare_exchange_n(&enqueuePos, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    // The ring buffer is full, so the event is dropped instead of waiting
+    else if(difference < 0)
+    {
+      __atomic_fetch_add(&droppedAmount, 1, __ATOMIC_RELAXED);
+
+      return 1;
+    }
+    else position = __atomic_load_n(&enqueuePos, __ATOMIC_RELAXED);
+  }
+
+  event->nanos = nanos;
+  event->level = level;
+  event->format = format;
+
+  va_start(args, format);
+
+  log_event_args_capture(event, format, args);
+
+  va_end(args);
+
+  // The cell is filled, so the consumer can take it
+  __atomic_store_n(&event->sequence, position + 1, __ATOMIC_RELEASE);
+
+  return 0; // Success!
+}
+
+/*
+ * Start the background thread that prints the recorded events
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to start the thread
+ */
+int logger_start(void)
+{
+  if(loggerRunning) return 0; // Success!
+
+  for(size_t index = 0; index < LOG_CAPACITY; index++)
+  {
+    events[index].sequence = (enqueuePos + index);
+  }
+  dequeuePos = enqueuePos;
+
+  loggerStopping = false;
+
+  if(pthread_create(&loggerThread, NULL, logger_routine, NULL) != 0) return 1;
+
+  __atomic_store_n(&loggerRunning, true, __ATOMIC_RELEASE);
+
+  return 0; // Success!
+}
+
+/*
+ * Print every recorded event and stop the background thread
+ *
+ * Note: Events should not be recorded by other threads while the logger is stopping
+ */
+void logger_stop(void)
+{
+  if(!loggerRunning) return;
+
+  __atomic_store_n(&loggerStopping, true, __ATOMIC_RELEASE);
+
+  pthread_join(loggerThread, NULL);
+
+  __atomic_store_n(&loggerRunning, false, __ATOMIC_RELEASE);
+
+  // Events that were claimed just before the logger stopped
+  while(log_event_dequeue());
+
+  size_t dropped = __atomic_exchange_n(&droppedAmount, 0, __ATOMIC_RELAXED);
+
+  if(dropped > 0) error_print("The logger dropped %ld events", dropped);
+}
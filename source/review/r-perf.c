@@ -0,0 +1,234 @@
+#include "../review.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const uint64_t counterConfigs[PERF_AMOUNT] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+// The counters count the thread that opened them, so every thread has its own group
+static __thread int groupFd = -1;
+
+// The counter values when every region was entered, by the current thread
+static __thread uint64_t regionBegins[PERF_REGIONS][PERF_AMOUNT];
+
+static PerfRegion regions[PERF_REGIONS];
+
+static size_t regionAmount = 0;
+
+static pthread_mutex_t regionMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Open one hardware counter, as a part of the group of the leader
+ */
+static int perf_counter_open(uint64_t config, int leaderFd)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.disabled = (leaderFd == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+
+  return syscall(SYS_perf_event_open, &attr, 0, -1, leaderFd, 0);
+}
+
+/*
+ * Read every counter of the group at once
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to read the counters
+ */
+static int perf_counters_read(uint64_t* counts)
+{
+  // The group format is the amount of counters followed by their values
+  uint64_t buffer[1 + PERF_AMOUNT];
+
+  if(read(groupFd, buffer, sizeof(buffer)) != sizeof(buffer)) return 1;
+
+  memcpy(counts, buffer + 1, sizeof(uint64_t) * PERF_AMOUNT);
+
+  return 0; // Success!
+}
+
+/*
+ * Open the hardware counters for the calling thread
+ *
+ * Note: Every thread that should be counted has to call this function,
+ * regions entered by threads without counters are not counted
+ *
+ * Note: Virtual machines often don't have hardware counters, so a failure is not printed,
+ * and the regions are simply not counted
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The counters are not supported or not allowed (see /proc/sys/kernel/perf_event_paranoid)
+ */
+int perf_open(void)
+{
+  if(groupFd != -1) return 0; // Success!
+
+  int fds[PERF_AMOUNT];
+
+  for(size_t counter = 0; counter < PERF_AMOUNT; counter++)
+  {
+    fds[counter] = perf_counter_open(counterConfigs[counter], (counter > 0) ? fds[0] : -1);
+
+    if(fds[counter] == -1)
+    {
+      for(size_t index = 0; index < counter; index++) close(fds[index]);
+
+      return 1;
+    }
+  }
+  // The followers are closed with the leader, so only the leader is kept
+  groupFd = fds[0];
+
+  ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+  return 0; // Success!
+}
+
+/*
+ * Close the hardware counters of the calling thread
+ */
+void perf_close(void)
+{
+  if(groupFd == -1) return;
+
+  close(groupFd);
+
+  groupFd = -1;
+}
+
+/*
+ * Create a named region to count, or get the region that already has the name
+ *
+ * RETURN (int region)
+ * - SUCCESS | The identifier of the region
+ * - ERROR   | -1, if there are already PERF_REGIONS regions
+ */
+int perf_region_create(const char* name)
+{
+  pthread_mutex_lock(&regionMutex);
+
+  for(size_t index = 0; index < regionAmount; index++)
+  {
+    if(!strcmp(regions[index].name, name))
+    {
+      pthread_mutex_unlock(&regionMutex);
+
+      return index;
+    }
+  }
+
+  int region = -1;
+
+  if(regionAmount < PERF_REGIONS)
+  {
+    region = regionAmount;
+
+    memset(&regions[region], 0, sizeof(PerfRegion));
+
+    snprintf(regions[region].name, sizeof(regions[region].name), "%s", name);
+
+    // The region is complete before it is published
+    __atomic_store_n(&regionAmount, regionAmount + 1, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&regionMutex);
+
+  return region;
+}
+
+/*
+ * Enter a region, if the calling thread has opened its counters
+ */
+void perf_region_begin(int region)
+{
+  if(groupFd == -1 || region < 0 || region >= PERF_REGIONS) return;
+
+  perf_counters_read(regionBegins[region]);
+}
+
+/*
+ * Leave a region, and add the counts since it was entered to the region
+ */
+void perf_region_end(int region)
+{
+  if(groupFd == -1 || region < 0 || region >= PERF_REGIONS) return;
+
+  uint64_t counts[PERF_AMOUNT];
+
+  if(perf_counters_read(counts) != 0) return;
+
+  for(size_t counter = 0; counter < PERF_AMOUNT; counter++)
+  {
+    __atomic_fetch_add(&regions[region].counts[counter], counts[counter] - regionBegins[region][counter], __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&regions[region].calls, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Get the counts of a region
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int perf_region_get(PerfRegion* result, int region)
+{
+  if(result == NULL || region < 0 || (size_t) region >= __atomic_load_n(&regionAmount, __ATOMIC_ACQUIRE)) return 1;
+
+  memcpy(result->name, regions[region].name, sizeof(result->name));
+
+  result->calls = __atomic_load_n(&regions[region].calls, __ATOMIC_RELAXED);
+
+  for(size_t counter = 0; counter < PERF_AMOUNT; counter++)
+  {
+    result->counts[counter] = __atomic_load_n(&regions[region].counts[counter], __ATOMIC_RELAXED);
+  }
+  return 0; // Success!
+}
+
+/*
+ * Print the counts, IPC and miss rates of every region that has been entered
+ */
+void perf_regions_print(FILE* stream)
+{
+  size_t amount = __atomic_load_n(&regionAmount, __ATOMIC_ACQUIRE);
+
+  fprintf(stream, "%-20s %10s %14s %14s %6s %12s %12s\n", "region", "calls", "cycles", "instructions", "IPC", "cache-miss", "branch-miss");
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    PerfRegion region;
+
+    perf_region_get(&region, index);
+
+    if(region.calls == 0) continue;
+
+    uint64_t cycles = region.counts[PERF_CYCLES];
+    uint64_t instructions = region.counts[PERF_INSTRUCTIONS];
+
+    double ipc = (cycles > 0) ? ((double) instructions / cycles) : 0;
+
+    // The misses are per thousand instructions (MPKI)
+    double cacheMpki = (instructions > 0) ? (1000.0 * region.counts[PERF_CACHE_MISSES] / instructions) : 0;
+    double branchMpki = (instructions > 0) ? (1000.0 * region.counts[PERF_BRANCH_MISSES] / instructions) : 0;
+
+    fprintf(stream, "%-20s %10lu %14lu %14lu %6.2f %7.2f MPKI %7.2f MPKI\n", region.name,
+      (unsigned long) region.calls, (unsigned long) cycles, (unsigned long) instructions, ipc, cacheMpki, branchMpki);
+  }
+}
@@ -0,0 +1,456 @@
+#define _GNU_SOURCE
+
+#include "../review.h"
+
+#include <stdlib.h>
+#include <signal.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <elf.h>
+#include <sys/time.h>
+#include <sched.h>
+
+// The maximum amount of frames of a sampled stack
+#define PROFILE_DEPTH 64
+
+// The maximum amount of different stacks, must be a power of two
+#define PROFILE_STACKS 8192
+
+// The frames of the signal handler and of the signal trampoline, which are not sampled
+#define PROFILE_SKIP 2
+
+typedef struct
+{
+  uint64_t hash;               // The hash of the frames (0 if the slot is unused)
+  bool ready;                  // If the frames have been written
+  size_t depth;                // The amount of frames
+  uint64_t count;              // The amount of samples of the stack
+  void* frames[PROFILE_DEPTH]; // The return addresses, the innermost first
+} ProfileStack;
+
+typedef struct
+{
+  uint64_t value; // The address of the function, relative to the load address
+  uint64_t size;  // The size of the function
+  char* name;     // The name of the function, in the string table
+} ProfileSymbol;
+
+static ProfileStack* profileStacks = NULL;
+
+static bool profileRunning = false;
+
+static char profilePath[256];
+
+// The samples that did not fit, or that hit a stack that another thread was writing
+static uint64_t lostAmount = 0;
+
+static uint64_t sampleAmount = 0;
+
+// The amount of signal handlers that are sampling right now, so the stacks are not freed under them
+static int handlerAmount = 0;
+
+static bool sampling = false;
+
+static struct sigaction oldAction;
+
+/*
+ * Hash the frames of a stack (FNV-1a over the addresses)
+ */
+static uint64_t profile_frames_hash(void* const* frames, size_t depth)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for(size_t index = 0; index < depth; index++)
+  {
+    hash = (hash ^ (uintptr_t) frames[index]) * 1099511628211ULL;
+  }
+  // The hash 0 marks an unused slot
+  return (hash != 0) ? hash : 1;
+}
+
+/*
+ * Count a sampled stack, in the slot of the stack or in a new slot
+ *
+ * This is called from the signal handler, so it only uses atomics and never waits
+ */
+static void profile_stack_count(void* const* frames, size_t depth)
+{
+  uint64_t hash = profile_frames_hash(frames, depth);
+
+  for(size_t probe = 0; probe < PROFILE_STACKS; probe++)
+  {
+    ProfileStack* stack = &profileStacks[(hash + probe) & (PROFILE_STACKS - 1)];
+
+    uint64_t current = __atomic_load_n(&stack->hash, __ATOMIC_ACQUIRE);
+
+    if(current == 0 && __atomic_compare_exchange_n(&stack->hash, &current, hash, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      memcpy(stack->frames, frames, sizeof(void*) * depth);
+
+      stack->depth = depth;
+      stack->count = 1;
+
+      __atomic_store_n(&stack->ready, true, __ATOMIC_RELEASE);
+
+      return;
+    }
+
+    if(current != hash) continue;
+
+    // Another thread is writing the frames of the slot, and the handler can not wait for it
+    if(!__atomic_load_n(&stack->ready, __ATOMIC_ACQUIRE)) break;
+
+    if(stack->depth == depth && !memcmp(stack->frames, frames, sizeof(void*) * depth))
+    {
+      __atomic_fetch_add(&stack->count, 1, __ATOMIC_RELAXED);
+
+      return;
+    }
+  }
+  __atomic_fetch_add(&lostAmount, 1, __ATOMIC_RELAXED);
+}
+
+static void profile_signal_handler(int number)
+{
+  int error = errno;
+
+  // The handler and profile_stop both store and then load, which is only ordered by seq_cst:
+  // either the handler sees that sampling stopped, or profile_stop sees the handler
+  __atomic_fetch_add(&handlerAmount, 1, __ATOMIC_SEQ_CST);
+
+  if(__atomic_load_n(&sampling, __ATOMIC_SEQ_CST))
+  {
+    void* frames[PROFILE_DEPTH + PROFILE_SKIP];
+
+    int depth = backtrace(frames, PROFILE_DEPTH + PROFILE_SKIP);
+
+    if(depth > PROFILE_SKIP) profile_stack_count(frames + PROFILE_SKIP, depth - PROFILE_SKIP);
+
+    __atomic_fetch_add(&sampleAmount, 1, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_sub(&handlerAmount, 1, __ATOMIC_RELEASE);
+
+  errno = error;
+}
+
+/*
+ * Compare the symbols by their addresses
+ */
+static int profile_symbol_compare(const void* symbol1, const void* symbol2)
+{
+  uint64_t value1 = ((const ProfileSymbol*) symbol1)->value;
+  uint64_t value2 = ((const ProfileSymbol*) symbol2)->value;
+
+  return (value1 > value2) - (value1 < value2);
+}
+
+/*
+ * Read the function symbols of the .symtab of the executable,
+ * which also has the static functions, that the dynamic symbols (dladdr) do not have
+ *
+ * PARAMS
+ * - ProfileSymbol** symbols | The read symbols, sorted by their addresses
+ * - char** strings          | The string table that the names point into
+ * - bool* relative          | If the addresses are relative to the load address (position independent)
+ *
+ * RETURN (size_t amount)
+ * - The amount of read symbols, 0 if the executable has no .symtab (it is stripped)
+ */
+static size_t profile_symbols_read(ProfileSymbol** symbols, char** strings, bool* relative)
+{
+  *symbols = NULL;
+  *strings = NULL;
+
+  FILE* file = fopen("/proc/self/exe", "rb");
+
+  if(file == NULL) return 0;
+
+  Elf64_Ehdr header;
+
+  size_t amount = 0;
+
+  Elf64_Shdr* sections = NULL;
+  Elf64_Sym* elfSymbols = NULL;
+
+  if(fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.e_ident, ELFMAG, SELFMAG) ||
+     header.e_ident[EI_CLASS] != ELFCLASS64 || header.e_shentsize != sizeof(Elf64_Shdr)) goto close;
+
+  *relative = (header.e_type == ET_DYN);
+
+  sections = malloc(sizeof(Elf64_Shdr) * header.e_shnum);
+
+  if(sections == NULL || fseek(file, header.e_shoff, SEEK_SET) != 0 ||
+     fread(sections, sizeof(Elf64_Shdr), header.e_shnum, file) != header.e_shnum) goto close;
+
+  for(size_t index = 0; index < header.e_shnum; index++)
+  {
+    if(sections[index].sh_type != SHT_SYMTAB || sections[index].sh_link >= header.e_shnum) continue;
+
+    Elf64_Shdr symtab = sections[index];
+    Elf64_Shdr strtab = sections[symtab.sh_link];
+
+    size_t symbolAmount = symtab.sh_size / sizeof(Elf64_Sym);
+
+    elfSymbols = malloc(symtab.sh_size);
+    *strings = malloc(strtab.sh_size + 1);
+    *symbols = malloc(sizeof(ProfileSymbol) * symbolAmount);
+
+    if(elfSymbols == NULL || *strings == NULL || *symbols == NULL) break;
+
+    if(fseek(file, symtab.sh_offset, SEEK_SET) != 0 || fread(elfSymbols, sizeof(Elf64_Sym), symbolAmount, file) != symbolAmount) break;
+
+    if(fseek(file, strtab.sh_offset, SEEK_SET) != 0 || fread(*strings, 1, strtab.sh_size, file) != strtab.sh_size) break;
+
+    (*strings)[strtab.sh_size] = '\0';
+
+    for(size_t symbol = 0; symbol < symbolAmount; symbol++)
+    {
+      Elf64_Sym current = elfSymbols[symbol];
+
+      if(ELF64_ST_TYPE(current.st_info) != STT_FUNC || current.st_value == 0 || current.st_name >= strtab.sh_size) continue;
+
+      (*symbols)[amount++] = (ProfileSymbol) { .value = current.st_value, .size = current.st_size, .name = *strings + current.st_name };
+    }
+    qsort(*symbols, amount, sizeof(ProfileSymbol), profile_symbol_compare);
+
+    break;
+  }
+
+  close:
+
+  free(sections);
+  free(elfSymbols);
+
+  fclose(file);
+
+  return amount;
+}
+
+/*
+ * Search the function that an address is in
+ *
+ * RETURN
+ * - SUCCESS | The symbol of the function
+ * - ERROR   | NULL
+ */
+static const ProfileSymbol* profile_symbol_search(const ProfileSymbol* symbols, size_t amount, uint64_t value)
+{
+  size_t low = 0;
+  size_t high = amount;
+
+  // Search the last symbol that starts at or before the address
+  while(low < high)
+  {
+    size_t middle = (low + high) / 2;
+
+    if(symbols[middle].value <= value) low = middle + 1;
+
+    else high = middle;
+  }
+  if(low == 0) return NULL;
+
+  const ProfileSymbol* symbol = &symbols[low - 1];
+
+  return (value < symbol->value + symbol->size || symbol->size == 0) ? symbol : NULL;
+}
+
+/*
+ * Write the name of the function of a return address
+ *
+ * The executable is searched in its .symtab, the shared libraries with dladdr,
+ * and else the object file and the offset are written
+ */
+static void profile_frame_write(FILE* file, void* frame, const ProfileSymbol* symbols, size_t symbolAmount, bool relative, const void* exeBase)
+{
+  // The return address is after the call, so the call itself is looked up
+  uintptr_t address = (uintptr_t) frame - 1;
+
+  Dl_info info;
+
+  bool found = (dladdr((void*) address, &info) != 0);
+
+  if(found && info.dli_fbase == exeBase)
+  {
+    uint64_t value = relative ? (address - (uintptr_t) exeBase) : address;
+
+    const ProfileSymbol* symbol = profile_symbol_search(symbols, symbolAmount, value);
+
+    if(symbol != NULL)
+    {
+      fprintf(file, "%s", symbol->name);
+
+      return;
+    }
+  }
+
+  if(found && info.dli_sname != NULL) fprintf(file, "%s", info.dli_sname);
+
+  else if(found && info.dli_fname != NULL)
+  {
+    const char* name = strrchr(info.dli_fname, '/');
+
+    fprintf(file, "%s+%#lx", (name != NULL) ? (name + 1) : info.dli_fname, (unsigned long) (address - (uintptr_t) info.dli_fbase));
+  }
+  else fprintf(file, "%#lx", (unsigned long) address);
+}
+
+/*
+ * Write every sampled stack as a line of folded stacks: "outer;inner count"
+ */
+static void profile_stacks_write(FILE* file)
+{
+  ProfileSymbol* symbols;
+  char* strings;
+
+  bool relative = false;
+
+  size_t symbolAmount = profile_symbols_read(&symbols, &strings, &relative);
+
+  // The load address of the executable, to know which frames are in the executable
+  Dl_info info;
+
+  const void* exeBase = (dladdr((void*) profile_start, &info) != 0) ? info.dli_fbase : NULL;
+
+  for(size_t index = 0; index < PROFILE_STACKS; index++)
+  {
+    const ProfileStack* stack = &profileStacks[index];
+
+    if(!__atomic_load_n(&stack->ready, __ATOMIC_ACQUIRE)) continue;
+
+    // The outermost frame is written first
+    for(size_t frame = stack->depth; frame-- > 0;)
+    {
+      profile_frame_write(file, stack->frames[frame], symbols, symbolAmount, relative, exeBase);
+
+      if(frame > 0) fputc(';', file);
+    }
+    fprintf(file, " %lu\n", (unsigned long) stack->count);
+  }
+  free(symbols);
+  free(strings);
+}
+
+/*
+ * Start sampling the stacks of the process, with SIGPROF on the CPU time of every thread
+ *
+ * The stacks are written as folded stacks when profile_stop is called,
+ * which flamegraph.pl or speedscope turns into a flame graph
+ *
+ * Note: Only the threads that use CPU time are sampled, so sleeping and waiting is not seen
+ *
+ * PARAMS
+ * - const char* path | The path of the file that the stacks are written to
+ * - int hertz        | The amount of samples per second of CPU time (for example 100)
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to allocate the stacks
+ * - 3 | Failed to start the timer
+ */
+int profile_start(const char* path, int hertz)
+{
+  if(path == NULL || strlen(path) >= sizeof(profilePath) || hertz <= 0 || hertz > 1000000) return 1;
+
+  if(profileRunning) return 0; // Success!
+
+  profileStacks = calloc(PROFILE_STACKS, sizeof(ProfileStack));
+
+  if(profileStacks == NULL) return 2;
+
+  snprintf(profilePath, sizeof(profilePath), "%s", path);
+
+  // The first call of backtrace loads libgcc, which must not happen in the signal handler
+  void* frames[1];
+
+  backtrace(frames, 1);
+
+  struct sigaction action = { .sa_handler = profile_signal_handler, .sa_flags = SA_RESTART };
+
+  sigemptyset(&action.sa_mask);
+
+  __atomic_store_n(&sampling, true, __ATOMIC_RELEASE);
+
+  sigaction(SIGPROF, &action, &oldAction);
+
+  long micros = 1000000 / hertz;
+
+  struct itimerval timer = {
+    .it_interval = { .tv_sec = micros / 1000000, .tv_usec = micros % 1000000 },
+    .it_value    = { .tv_sec = micros / 1000000, .tv_usec = micros % 1000000 }
+  };
+
+  if(setitimer(ITIMER_PROF, &timer, NULL) == -1)
+  {
+    error_print("setitimer: %s", strerror(errno));
+
+    __atomic_store_n(&sampling, false, __ATOMIC_SEQ_CST);
+
+    while(__atomic_load_n(&handlerAmount, __ATOMIC_SEQ_CST) > 0) sched_yield();
+
+    sigaction(SIGPROF, &oldAction, NULL);
+
+    free(profileStacks);
+
+    profileStacks = NULL;
+
+    return 3;
+  }
+  profileRunning = true;
+
+  return 0; // Success!
+}
+
+/*
+ * Stop sampling, and write the sampled stacks to the file
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The profiler is not running
+ * - 2 | Failed to write the file
+ */
+int profile_stop(void)
+{
+  if(!profileRunning) return 1;
+
+  struct itimerval timer = { 0 };
+
+  setitimer(ITIMER_PROF, &timer, NULL);
+
+  __atomic_store_n(&sampling, false, __ATOMIC_SEQ_CST);
+
+  // The handlers of other threads might still be counting a stack (seq_cst, like in the handler)
+  while(__atomic_load_n(&handlerAmount, __ATOMIC_SEQ_CST) > 0) sched_yield();
+
+  profileRunning = false;
+
+  int status = 0;
+
+  FILE* file = fopen(profilePath, "w");
+
+  if(file != NULL)
+  {
+    profile_stacks_write(file);
+
+    fclose(file);
+  }
+  else
+  {
+    error_print("fopen: %s: %s", profilePath, strerror(errno));
+
+    status = 2;
+  }
+
+  // A signal that is still pending is handled by the handler, which does nothing when not sampling
+  sigaction(SIGPROF, &oldAction, NULL);
+
+  uint64_t lost = __atomic_load_n(&lostAmount, __ATOMIC_RELAXED);
+
+  if(lost > 0) error_print("Lost %lu of %lu profile samples", (unsigned long) lost, (unsigned long) sampleAmount);
+
+  free(profileStacks);
+
+  profileStacks = NULL;
+
+  return status;
+}
@@ -0,0 +1,379 @@
+#include "../review.h"
+
+#include <stdlib.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct
+{
+  char name[64];  // The name of the gauge, optionally with labels: name{label="value"}
+  char help[96];  // The description of the gauge
+  double value;   // The current value of the gauge
+} StatsGauge;
+
+static StatsGauge gauges[STATS_GAUGES];
+
+static size_t gaugeAmount = 0;
+
+static pthread_mutex_t gaugeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t serverThread;
+static bool serverRunning = false;
+
+static int serverFd = -1;
+
+static char serverPath[108];
+
+// The signal handler writes to this pipe, because the handler can not do the dump itself
+static int signalPipe[2] = {-1, -1};
+
+static struct sigaction oldAction;
+
+/*
+ * Set the value of a gauge, and create the gauge if it does not exist
+ *
+ * PARAMS
+ * - const char* name | The name of the gauge, with optional labels, for example: train_phase_seconds{phase="values"}
+ * - const char* help | The description of the gauge, used when the gauge is created
+ * - double value     | The new value
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | There are already STATS_GAUGES gauges
+ */
+int stats_gauge_set(const char* name, const char* help, double value)
+{
+  if(name == NULL) return 1;
+
+  pthread_mutex_lock(&gaugeMutex);
+
+  for(size_t index = 0; index < gaugeAmount; index++)
+  {
+    if(strcmp(gauges[index].name, name)) continue;
+
+    gauges[index].value = value;
+
+    pthread_mutex_unlock(&gaugeMutex);
+
+    return 0; // Success!
+  }
+
+  if(gaugeAmount >= STATS_GAUGES)
+  {
+    pthread_mutex_unlock(&gaugeMutex);
+
+    return 2;
+  }
+
+  StatsGauge* gauge = &gauges[gaugeAmount++];
+
+  snprintf(gauge->name, sizeof(gauge->name), "%s", name);
+  snprintf(gauge->help, sizeof(gauge->help), "%s", (help != NULL) ? help : "");
+
+  gauge->value = value;
+
+  pthread_mutex_unlock(&gaugeMutex);
+
+  return 0; // Success!
+}
+
+/*
+ * Get the length of the name of a gauge, without the labels
+ */
+static size_t gauge_base_length(const char* name)
+{
+  const char* labels = strchr(name, '{');
+
+  return (labels != NULL) ? (size_t) (labels - name) : strlen(name);
+}
+
+/*
+ * Write the memory usage of the process, from /proc/self/statm
+ */
+static void process_memory_write(FILE* stream)
+{
+  FILE* file = fopen("/proc/self/statm", "r");
+
+  if(file == NULL) return;
+
+  unsigned long size, resident;
+
+  if(fscanf(file, "%lu %lu", &size, &resident) == 2)
+  {
+    long pageSize = sysconf(_SC_PAGESIZE);
+
+    fprintf(stream, "# HELP process_virtual_memory_bytes The virtual memory size of the process\n");
+    fprintf(stream, "# TYPE process_virtual_memory_bytes gauge\n");
+    fprintf(stream, "process_virtual_memory_bytes %lu\n", size * pageSize);
+
+    fprintf(stream, "# HELP process_resident_memory_bytes The resident memory size of the process\n");
+    fprintf(stream, "# TYPE process_resident_memory_bytes gauge\n");
+    fprintf(stream, "process_resident_memory_bytes %lu\n", resident * pageSize);
+  }
+  fclose(file);
+}
+
+/*
+ * Write every gauge and the memory usage of the process in the Prometheus text format
+ *
+ * The gauges with the same name (but different labels) share the HELP and TYPE lines,
+ * if they have been created after each other
+ */
+void stats_gauges_write(FILE* stream)
+{
+  pthread_mutex_lock(&gaugeMutex);
+
+  for(size_t index = 0; index < gaugeAmount; index++)
+  {
+    const StatsGauge* gauge = &gauges[index];
+
+    size_t baseLength = gauge_base_length(gauge->name);
+
+    bool newBase = (index == 0) || (gauge_base_length(gauges[index - 1].name) != baseLength) ||
+      strncmp(gauges[index - 1].name, gauge->name, baseLength);
+
+    if(newBase)
+    {
+      fprintf(stream, "# HELP %.*s %s\n", (int) baseLength, gauge->name, gauge->help);
+      fprintf(stream, "# TYPE %.*s gauge\n", (int) baseLength, gauge->name);
+    }
+    fprintf(stream, "%s %.9g\n", gauge->name, gauge->value);
+  }
+  pthread_mutex_unlock(&gaugeMutex);
+
+  process_memory_write(stream);
+}
+
+/*
+ * Write a buffer to a client or to a dump file descriptor
+ *
+ * A client can close the socket before the reply, so the reply is sent with MSG_NOSIGNAL,
+ * else the process would be killed by SIGPIPE
+ */
+static ssize_t stats_fd_write(int fd, const char* buffer, size_t length, bool client)
+{
+  return client ? send(fd, buffer, length, MSG_NOSIGNAL) : write(fd, buffer, length);
+}
+
+/*
+ * Write the gauges to a file descriptor, for a client or for a dump
+ */
+static void stats_gauges_fd_write(int fd, bool client, bool http)
+{
+  char* buffer = NULL;
+  size_t length = 0;
+
+  FILE* stream = open_memstream(&buffer, &length);
+
+  if(stream == NULL) return;
+
+  stats_gauges_write(stream);
+
+  fclose(stream);
+
+  if(http)
+  {
+    char header[128];
+
+    int headerLength = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %ld\r\n\r\n", length);
+
+    if(stats_fd_write(fd, header, headerLength, client) != headerLength) length = 0;
+  }
+
+  for(size_t written = 0; written < length;)
+  {
+    ssize_t amount = stats_fd_write(fd, buffer + written, length - written, client);
+
+    if(amount <= 0) break;
+
+    written += amount;
+  }
+  free(buffer);
+}
+
+/*
+ * Answer a client, with a HTTP response if the client sent a HTTP request,
+ * so the socket works both with netcat and with HTTP clients (curl --unix-socket)
+ */
+static void stats_client_serve(int clientFd)
+{
+  char request[1024];
+
+  ssize_t length = 0;
+
+  struct pollfd pollFd = { .fd = clientFd, .events = POLLIN };
+
+  // A plain client might not send anything, so only wait a short moment for a request
+  if(poll(&pollFd, 1, 100) == 1) length = read(clientFd, request, sizeof(request) - 1);
+
+  bool http = (length >= 4 && !strncmp(request, "GET ", 4));
+
+  stats_gauges_fd_write(clientFd, true, http);
+}
+
+static void stats_signal_handler(int number)
+{
+  int error = errno;
+
+  char byte = 'd';
+
+  // The handler only writes to the pipe, which is async-signal-safe
+  if(write(signalPipe[1], &byte, 1) != 1) {}
+
+  errno = error;
+}
+
+/*
+ * The routine of the background thread that serves the clients and the dumps
+ */
+static void* stats_server_routine(void* data)
+{
+  struct pollfd pollFds[2] = {
+    { .fd = serverFd,      .events = POLLIN },
+    { .fd = signalPipe[0], .events = POLLIN }
+  };
+
+  while(true)
+  {
+    if(poll(pollFds, 2, -1) == -1)
+    {
+      if(errno == EINTR) continue;
+
+      break;
+    }
+
+    if(pollFds[1].revents & POLLIN)
+    {
+      char byte;
+
+      if(read(signalPipe[0], &byte, 1) != 1) continue;
+
+      // The server is stopped by writing 'q' to the pipe
+      if(byte == 'q') break;
+
+      stats_gauges_fd_write(STDERR_FILENO, false, false);
+    }
+
+    if(pollFds[0].revents & POLLIN)
+    {
+      int clientFd = accept(serverFd, NULL, NULL);
+
+      if(clientFd == -1) continue;
+
+      stats_client_serve(clientFd);
+
+      close(clientFd);
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Start a background thread that serves the gauges over a Unix domain socket,
+ * and dumps the gauges to stderr when the process receives SIGUSR1
+ *
+ * Every connection gets the gauges in the Prometheus text format, for example:
+ * - nc -U <path>
+ * - curl --unix-socket <path> http://localhost/metrics
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to create the socket
+ * - 3 | Failed to start the thread
+ */
+int stats_server_start(const char* path)
+{
+  if(path == NULL || strlen(path) >= sizeof(serverPath)) return 1;
+
+  if(serverRunning) return 0; // Success!
+
+  struct sockaddr_un address = { .sun_family = AF_UNIX };
+
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+  serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if(serverFd == -1)
+  {
+    error_print("socket: %s", strerror(errno));
+
+    return 2;
+  }
+
+  // A socket file left by an earlier run would make bind fail
+  unlink(path);
+
+  if(bind(serverFd, (struct sockaddr*) &address, sizeof(address)) == -1 || listen(serverFd, 8) == -1)
+  {
+    error_print("bind: %s: %s", path, strerror(errno));
+
+    close(serverFd);
+
+    return 2;
+  }
+
+  if(pipe(signalPipe) == -1)
+  {
+    close(serverFd);
+
+    unlink(path);
+
+    return 2;
+  }
+
+  snprintf(serverPath, sizeof(serverPath), "%s", path);
+
+  struct sigaction action = { .sa_handler = stats_signal_handler, .sa_flags = SA_RESTART };
+
+  sigemptyset(&action.sa_mask);
+
+  sigaction(SIGUSR1, &action, &oldAction);
+
+  if(pthread_create(&serverThread, NULL, stats_server_routine, NULL) != 0)
+  {
+    sigaction(SIGUSR1, &oldAction, NULL);
+
+    close(signalPipe[0]);
+    close(signalPipe[1]);
+
+    close(serverFd);
+
+    unlink(path);
+
+    return 3;
+  }
+  serverRunning = true;
+
+  return 0; // Success!
+}
+
+/*
+ * Stop the background stats thread and remove the socket
+ */
+void stats_server_stop(void)
+{
+  if(!serverRunning) return;
+
+  sigaction(SIGUSR1, &oldAction, NULL);
+
+  char byte = 'q';
+
+  // The thread is blocked in poll, which is a cancellation point
+  if(write(signalPipe[1], &byte, 1) != 1) pthread_cancel(serverThread);
+
+  pthread_join(serverThread, NULL);
+
+  close(signalPipe[0]);
+  close(signalPipe[1]);
+
+  close(serverFd);
+
+  unlink(serverPath);
+
+  serverRunning = false;
+}
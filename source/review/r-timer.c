@@ -0,0 +1,27 @@
+#include "../review.h"
+
+/*
+ * Get the time of the monotonic clock in nanoseconds
+ *
+ * Note: The time is only meaningful compared to another time from this function
+ *
+ * RETURN (uint64_t nanos)
+ * - SUCCESS | The time in nanoseconds
+ * - ERROR   | 0
+ */
+uint64_t timer_nanos(void)
+{
+  struct timespec timespec;
+
+  if(clock_gettime(CLOCK_MONOTONIC, &timespec) == -1) return 0;
+
+  return ((uint64_t) timespec.tv_sec * 1000000000) + timespec.tv_nsec;
+}
+
+/*
+ * Get the time of the monotonic clock in seconds
+ */
+double timer_seconds(void)
+{
+  return (double) timer_nanos() / 1e9;
+}
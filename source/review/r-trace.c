@@ -0,0 +1,374 @@
+#include "../review.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+// The amount of events in every chunk of a thread buffer
+#define TRACE_CHUNK_EVENTS 4096
+
+// The maximum amount of events of all threads, the later events are dropped
+#define TRACE_EVENTS_MAX (1 << 20)
+
+typedef struct
+{
+  const char* category; // The category of the event, which has to be a string literal
+  const char* name;     // The name of the event, which has to be a string literal
+  const char* argName;  // The name of the argument, or NULL if the event has no argument
+  int64_t arg;          // The value of the argument
+  uint64_t nanos;       // The monotonic time of the event in nanoseconds
+  char phase;           // 'B' for begin and 'E' for end
+} TraceEvent;
+
+typedef struct TraceChunk
+{
+  struct TraceChunk* next;                // The next chunk, or NULL
+  size_t amount;                          // The amount of recorded events
+  TraceEvent events[TRACE_CHUNK_EVENTS];  // The recorded events
+} TraceChunk;
+
+typedef struct TraceBuffer
+{
+  struct TraceBuffer* next; // The buffer of the thread that started tracing before this one
+  int tid;                  // The thread id of the kernel
+  char name[32];            // The name of the thread
+  TraceChunk* first;        // The first chunk, which is read when the trace is written
+  TraceChunk* last;         // The chunk that the thread records to
+} TraceBuffer;
+
+static bool traceEnabled = false;
+
+static bool traceStarted = false;
+
+// If the detail events are recorded, which are left out by default because there is one for every sample
+static bool traceDetail = false;
+
+static char tracePath[256];
+
+static uint64_t traceStart = 0;
+
+// The buffers of every thread that has recorded an event, as a lock-free stack
+static TraceBuffer* traceBuffers = NULL;
+
+static size_t eventAmount = 0;
+static size_t droppedAmount = 0;
+
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Every thread records to its own buffer, so the events are recorded without locks
+static __thread TraceBuffer* threadBuffer = NULL;
+
+static __thread char threadName[32];
+
+/*
+ * Create a chunk of events
+ */
+static TraceChunk* trace_chunk_create(void)
+{
+  TraceChunk* chunk = malloc(sizeof(TraceChunk));
+
+  if(chunk == NULL) return NULL;
+
+  chunk->next = NULL;
+  chunk->amount = 0;
+
+  return chunk;
+}
+
+/*
+ * Create the buffer of the current thread, and push it to the buffers of every thread
+ */
+static TraceBuffer* trace_buffer_create(void)
+{
+  TraceBuffer* buffer = malloc(sizeof(TraceBuffer));
+
+  if(buffer == NULL) return NULL;
+
+  buffer->first = trace_chunk_create();
+
+  if(buffer->first == NULL)
+  {
+    free(buffer);
+
+    return NULL;
+  }
+  buffer->last = buffer->first;
+
+  buffer->tid = (int) syscall(SYS_gettid);
+
+  snprintf(buffer->name, sizeof(buffer->name), "%s", threadName);
+
+  buffer->next = __atomic_load_n(&traceBuffers, __ATOMIC_RELAXED);
+
+  while(!__atomic_compare_exchange_n(&traceBuffers, &buffer->next, buffer, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+  return buffer;
+}
+
+/*
+ * Record an event to the buffer of the current thread
+ */
+static void trace_event_record(char phase, const char* category, const char* name, const char* argName, int64_t arg)
+{
+  if(!__atomic_load_n(&traceEnabled, __ATOMIC_RELAXED)) return;
+
+  size_t amount = __atomic_fetch_add(&eventAmount, 1, __ATOMIC_RELAXED);
+
+  if(amount >= TRACE_EVENTS_MAX)
+  {
+    // Only the thread that records the first dropped event logs it
+    if(amount == TRACE_EVENTS_MAX) error_print("The trace is full (%d events), the later events are dropped", TRACE_EVENTS_MAX);
+
+    __atomic_fetch_add(&droppedAmount, 1, __ATOMIC_RELAXED);
+
+    return;
+  }
+
+  if(threadBuffer == NULL && (threadBuffer = trace_buffer_create()) == NULL) return;
+
+  TraceChunk* chunk = threadBuffer->last;
+
+  if(chunk->amount >= TRACE_CHUNK_EVENTS)
+  {
+    TraceChunk* next = trace_chunk_create();
+
+    if(next == NULL)
+    {
+      __atomic_fetch_add(&droppedAmount, 1, __ATOMIC_RELAXED);
+
+      return;
+    }
+
+    // The chunk is published after it is initialized, so the writer can follow the link
+    __atomic_store_n(&chunk->next, next, __ATOMIC_RELEASE);
+
+    threadBuffer->last = chunk = next;
+  }
+  chunk->events[chunk->amount] = (TraceEvent) {
+    .category = category,
+    .name = name,
+    .argName = argName,
+    .arg = arg,
+    .nanos = timer_nanos(),
+    .phase = phase
+  };
+
+  // The event is published after it is written, so the writer only reads complete events
+  __atomic_store_n(&chunk->amount, chunk->amount + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Record the beginning of a region in the trace of the current thread
+ *
+ * PARAMS
+ * - const char* category | The category of the region, for example "train" (a string literal)
+ * - const char* name     | The name of the region, for example "epoch" (a string literal)
+ * - const char* argName  | The name of the argument, for example "layer", or NULL for no argument
+ * - int64_t arg          | The value of the argument
+ */
+void trace_begin(const char* category, const char* name, const char* argName, int64_t arg)
+{
+  trace_event_record('B', category, name, argName, arg);
+}
+
+/*
+ * Record the end of the last begun region in the trace of the current thread
+ */
+void trace_end(const char* category, const char* name)
+{
+  trace_event_record('E', category, name, NULL, 0);
+}
+
+/*
+ * Record the beginning of a detail region, if the detail events are recorded (trace_detail_set)
+ *
+ * The detail regions are the ones that happen for every sample,
+ * which would fill the trace in seconds if they were always recorded
+ *
+ * PARAMS
+ * - const char* category | The category of the region, for example "layer" (a string literal)
+ * - const char* name     | The name of the region, for example "forward" (a string literal)
+ * - const char* argName  | The name of the argument, for example "layer", or NULL for no argument
+ * - int64_t arg          | The value of the argument
+ */
+void trace_detail_begin(const char* category, const char* name, const char* argName, int64_t arg)
+{
+  if(!__atomic_load_n(&traceDetail, __ATOMIC_RELAXED)) return;
+
+  trace_event_record('B', category, name, argName, arg);
+}
+
+/*
+ * Record the end of the last begun detail region, if the detail events are recorded
+ */
+void trace_detail_end(const char* category, const char* name)
+{
+  if(!__atomic_load_n(&traceDetail, __ATOMIC_RELAXED)) return;
+
+  trace_event_record('E', category, name, NULL, 0);
+}
+
+/*
+ * Set if the detail events are recorded, which they are not by default
+ *
+ * Note: The detail has to be set before the tracing is started or while no detail region is running,
+ * else a region can be begun without being ended
+ */
+void trace_detail_set(bool detail)
+{
+  __atomic_store_n(&traceDetail, detail, __ATOMIC_RELAXED);
+}
+
+/*
+ * Name the current thread in the trace, the name can be set before the tracing is started
+ */
+void trace_thread_name(const char* name)
+{
+  snprintf(threadName, sizeof(threadName), "%s", (name != NULL) ? name : "");
+
+  if(threadBuffer != NULL)
+  {
+    pthread_mutex_lock(&traceMutex);
+
+    snprintf(threadBuffer->name, sizeof(threadBuffer->name), "%s", threadName);
+
+    pthread_mutex_unlock(&traceMutex);
+  }
+}
+
+/*
+ * Write a string as a JSON string, without the characters that would need escaping
+ */
+static void trace_string_write(FILE* file, const char* string)
+{
+  fputc('"', file);
+
+  for(; *string != '\0'; string++)
+  {
+    if(*string != '"' && *string != '\\' && (unsigned char) *string >= ' ') fputc(*string, file);
+  }
+  fputc('"', file);
+}
+
+/*
+ * Write the events of every thread in the Chrome trace event format
+ */
+static void trace_events_write(FILE* file)
+{
+  int pid = (int) getpid();
+
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+  bool first = true;
+
+  TraceBuffer* buffer = __atomic_load_n(&traceBuffers, __ATOMIC_ACQUIRE);
+
+  for(; buffer != NULL; buffer = buffer->next)
+  {
+    pthread_mutex_lock(&traceMutex);
+
+    if(buffer->name[0] != '\0')
+    {
+      fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", pid, buffer->tid);
+
+      trace_string_write(file, buffer->name);
+
+      fprintf(file, "}}");
+
+      first = false;
+    }
+    pthread_mutex_unlock(&traceMutex);
+
+    for(TraceChunk* chunk = buffer->first; chunk != NULL; chunk = __atomic_load_n(&chunk->next, __ATOMIC_ACQUIRE))
+    {
+      size_t amount = __atomic_load_n(&chunk->amount, __ATOMIC_ACQUIRE);
+
+      for(size_t index = 0; index < amount; index++)
+      {
+        const TraceEvent* event = &chunk->events[index];
+
+        // The events from before the trace was started are not written
+        double micros = (event->nanos > traceStart) ? ((double) (event->nanos - traceStart) / 1e3) : 0;
+
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d", first ? "" : ",\n",
+          event->name, event->category, event->phase, micros, pid, buffer->tid);
+
+        if(event->argName != NULL) fprintf(file, ",\"args\":{\"%s\":%ld}", event->argName, (long) event->arg);
+
+        fprintf(file, "}");
+
+        first = false;
+      }
+    }
+  }
+  fprintf(file, "\n]}\n");
+}
+
+/*
+ * Stop the tracing at exit, if it has not been stopped already
+ */
+static void trace_exit(void)
+{
+  trace_stop();
+}
+
+/*
+ * Start recording the trace events of every thread,
+ * which are written to a file when trace_stop is called or when the process exits
+ *
+ * The file can be opened in chrome://tracing or in https://ui.perfetto.dev
+ *
+ * Note: The tracing can only be started once, the buffers are kept until the process exits
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | The tracing has already been started
+ */
+int trace_start(const char* path)
+{
+  if(path == NULL || strlen(path) >= sizeof(tracePath)) return 1;
+
+  if(__atomic_exchange_n(&traceStarted, true, __ATOMIC_RELAXED)) return 2;
+
+  snprintf(tracePath, sizeof(tracePath), "%s", path);
+
+  atexit(trace_exit);
+
+  traceStart = timer_nanos();
+
+  __atomic_store_n(&traceEnabled, true, __ATOMIC_RELEASE);
+
+  return 0; // Success!
+}
+
+/*
+ * Stop recording trace events, and write the recorded events to the file
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The tracing is not running
+ * - 2 | Failed to write the file
+ */
+int trace_stop(void)
+{
+  if(!__atomic_exchange_n(&traceEnabled, false, __ATOMIC_ACQ_REL)) return 1;
+
+  FILE* file = fopen(tracePath, "w");
+
+  if(file == NULL)
+  {
+    error_print("fopen: %s: %s", tracePath, strerror(errno));
+
+    return 2;
+  }
+  trace_events_write(file);
+
+  fclose(file);
+
+  size_t dropped = __atomic_load_n(&droppedAmount, __ATOMIC_RELAXED);
+
+  if(dropped > 0) error_print("Dropped %ld trace events", dropped);
+
+  return 0; // Success!
+}
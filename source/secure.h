@@ -23,6 +23,8 @@ extern int      float_vector_minmax(float* min, float* max, const float* vector,
 
 extern float    float_random_create(float min, float max);
 
+extern float    float_random_seed_create(float min, float max, unsigned int* seed);
+
 extern float*   float_vector_random_create(size_t length, float min, float max);
 
 extern float*   float_vector_scale_multi(float* result, const float* vector, size_t length, float scalor);
@@ -35,6 +37,12 @@ extern void     float_vector_print(const float* vector, size_t length);
 
 // Float matrix
 
+typedef struct
+{
+  size_t rows;  // The amount of rows that are calculated together (1, 2 or 4)
+  size_t block; // The amount of columns in a block, or 0 for whole rows
+} MatrixBlocking;
+
 extern float**  float_matrix_create(size_t height, size_t width);
 
 extern void     float_matrix_free(float*** matrix, size_t height, size_t width);
@@ -55,6 +63,22 @@ extern int      float_matrix_vector_dotprod(float* result, float** matrix, size_
 
 extern void     float_matrix_print(float** matrix, size_t height, size_t width);
 
+// Matrix blocking
+
+extern void     secure_blocking_set(const MatrixBlocking* blocking);
+
+extern void     secure_blocking_get(MatrixBlocking* blocking);
+
+extern int      secure_cpu_model(char* model, size_t size);
+
+extern int      secure_blocking_tune(MatrixBlocking* blocking, uint64_t trialNanos);
+
+extern int      secure_blocking_load(MatrixBlocking* blocking, const char* path);
+
+extern int      secure_blocking_save(const MatrixBlocking* blocking, const char* path);
+
+extern int      secure_blocking_init(const char* path);
+
 // Float matrix array
 
 extern float*** float_matarr_create(size_t amount, size_t height, size_t width);
@@ -71,4 +95,40 @@ extern void     float_matarr_print(float*** matarr, size_t amount, size_t height
 
 extern size_t* index_array_shuffled_fill(size_t* array, size_t amount);
 
+extern size_t* index_array_shuffled_seed_fill(size_t* array, size_t amount, unsigned int* seed);
+
+// Allocation tracking
+
+// This is the maximum amount of call sites that the allocations are counted for
+#define ALLOC_SITES 64
+
+typedef struct
+{
+  const void* site;     // The return address of the create call (NULL if the slot is unused)
+  uint64_t allocations; // The amount of mallocs made by the creates from the site
+  uint64_t bytes;       // The amount of bytes allocated by the creates from the site
+} AllocSite;
+
+typedef struct
+{
+  int64_t liveBytes;              // The bytes that are allocated right now (negative if earlier allocations were freed)
+  int64_t peakBytes;              // The highest amount of live bytes
+  uint64_t allocations;           // The amount of mallocs
+  uint64_t frees;                 // The amount of frees
+  uint64_t totalBytes;            // The amount of bytes that have been allocated
+  uint64_t lostSites;             // The allocations of the sites that did not fit in the table
+  size_t siteAmount;              // The amount of used sites
+  AllocSite sites[ALLOC_SITES];   // The allocations of every call site
+} AllocStats;
+
+extern void     secure_alloc_tracking(bool enabled);
+
+extern uint64_t secure_alloc_count(void);
+
+extern void     secure_alloc_stats_get(AllocStats* stats);
+
+extern void     secure_alloc_stats_reset(void);
+
+extern void     secure_alloc_print(FILE* stream, const AllocStats* stats);
+
 #endif // SECURE_H
@@ -0,0 +1,17 @@
+#ifndef S_ALLOC_INTERN_H
+#define S_ALLOC_INTERN_H
+
+// The return address of the public create function, that the allocations are counted for
+#define ALLOC_SITE (__builtin_return_address(0))
+
+extern void*   secure_malloc(size_t size, const void* site);
+
+extern void    secure_free(void* pointer, size_t size);
+
+extern float*  float_vector_site_create(size_t length, const void* site);
+
+extern float*  float_vector_random_site_create(size_t length, float min, float max, const void* site);
+
+extern float** float_matrix_site_create(size_t height, size_t width, const void* site);
+
+#endif // S_ALLOC_INTERN_H
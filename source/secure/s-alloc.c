@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+
+#include "../secure.h"
+
+#include "s-alloc-intern.h"
+
+#include <dlfcn.h>
+
+// The tracking is off by default, then the creates only pay for one relaxed load
+static bool tracking = false;
+
+static int64_t liveBytes = 0;
+static int64_t peakBytes = 0;
+
+static uint64_t allocations = 0;
+static uint64_t frees = 0;
+static uint64_t totalBytes = 0;
+static uint64_t lostSites = 0;
+
+// The sites are an open addressing hash table, so a site is claimed with one compare and swap
+static AllocSite sites[ALLOC_SITES];
+
+/*
+ * Turn the tracking of the allocations of secure on or off
+ *
+ * Note: The bytes that are freed are subtracted even if they were allocated before the tracking
+ * was turned on, so turn it on before the allocations that should be measured
+ */
+void secure_alloc_tracking(bool enabled)
+{
+  __atomic_store_n(&tracking, enabled, __ATOMIC_RELAXED);
+}
+
+/*
+ * Get the slot of a call site, and claim a free slot if the site is new
+ *
+ * RETURN
+ * - SUCCESS | The slot of the site
+ * - ERROR   | NULL, if the table is full
+ */
+static AllocSite* alloc_site_get(const void* site)
+{
+  size_t start = ((uintptr_t) site >> 2) % ALLOC_SITES;
+
+  for(size_t offset = 0; offset < ALLOC_SITES; offset++)
+  {
+    AllocSite* slot = &sites[(start + offset) % ALLOC_SITES];
+
+    const void* current = __atomic_load_n(&slot->site, __ATOMIC_RELAXED);
+
+    if(current == NULL && __atomic_compare_exchange_n(&slot->site, &current, site, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+      return slot;
+    }
+
+    // Another thread might have claimed the slot for the same site
+    if(current == site) return slot;
+  }
+  return NULL;
+}
+
+/*
+ * Allocate memory with malloc, and count it if the tracking is on
+ *
+ * PARAMS
+ * - size_t size      | The amount of bytes
+ * - const void* site | The call site that the allocation is counted for
+ */
+void* secure_malloc(size_t size, const void* site)
+{
+  void* pointer = malloc(size);
+
+  if(pointer == NULL || !__atomic_load_n(&tracking, __ATOMIC_RELAXED)) return pointer;
+
+  __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&totalBytes, size, __ATOMIC_RELAXED);
+
+  int64_t live = __atomic_add_fetch(&liveBytes, (int64_t) size, __ATOMIC_RELAXED);
+
+  int64_t peak = __atomic_load_n(&peakBytes, __ATOMIC_RELAXED);
+
+  while(live > peak && !__atomic_compare_exchange_n(&peakBytes, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  AllocSite* slot = alloc_site_get(site);
+
+  if(slot != NULL)
+  {
+    __atomic_fetch_add(&slot->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&slot->bytes, size, __ATOMIC_RELAXED);
+  }
+  else __atomic_fetch_add(&lostSites, 1, __ATOMIC_RELAXED);
+
+  return pointer;
+}
+
+/*
+ * Free memory from secure_malloc, and count it if the tracking is on
+ *
+ * PARAMS
+ * - size_t size | The amount of bytes that were allocated
+ */
+void secure_free(void* pointer, size_t size)
+{
+  if(pointer == NULL) return;
+
+  free(pointer);
+
+  if(!__atomic_load_n(&tracking, __ATOMIC_RELAXED)) return;
+
+  __atomic_fetch_add(&frees, 1, __ATOMIC_RELAXED);
+
+  __atomic_sub_fetch(&liveBytes, (int64_t) size, __ATOMIC_RELAXED);
+}
+
+/*
+ * Get the amount of allocations, which is cheap enough to call around every epoch
+ */
+uint64_t secure_alloc_count(void)
+{
+  return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+/*
+ * Get a snapshot of the counters and of every used call site
+ *
+ * Note: The counters are read one by one, so allocations made by other threads
+ * while the snapshot is taken can be counted by some of the fields but not by others
+ */
+void secure_alloc_stats_get(AllocStats* stats)
+{
+  if(stats == NULL) return;
+
+  memset(stats, 0, sizeof(AllocStats));
+
+  stats->liveBytes = __atomic_load_n(&liveBytes, __ATOMIC_RELAXED);
+  stats->peakBytes = __atomic_load_n(&peakBytes, __ATOMIC_RELAXED);
+  stats->allocations = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+  stats->frees = __atomic_load_n(&frees, __ATOMIC_RELAXED);
+  stats->totalBytes = __atomic_load_n(&totalBytes, __ATOMIC_RELAXED);
+  stats->lostSites = __atomic_load_n(&lostSites, __ATOMIC_RELAXED);
+
+  for(size_t index = 0; index < ALLOC_SITES; index++)
+  {
+    const void* site = __atomic_load_n(&sites[index].site, __ATOMIC_RELAXED);
+
+    if(site == NULL) continue;
+
+    AllocSite* copy = &stats->sites[stats->siteAmount++];
+
+    copy->site = site;
+    copy->allocations = __atomic_load_n(&sites[index].allocations, __ATOMIC_RELAXED);
+    copy->bytes = __atomic_load_n(&sites[index].bytes, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * Reset the counters, except the live bytes, and start the peak at the live bytes
+ *
+ * Note: This should not be called while other threads are allocating
+ */
+void secure_alloc_stats_reset(void)
+{
+  __atomic_store_n(&peakBytes, __atomic_load_n(&liveBytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+
+  __atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&frees, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&totalBytes, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&lostSites, 0, __ATOMIC_RELAXED);
+
+  memset(sites, 0, sizeof(sites));
+}
+
+/*
+ * Compare the sites by their bytes, the most bytes first
+ */
+static int alloc_site_compare(const void* site1, const void* site2)
+{
+  uint64_t bytes1 = ((const AllocSite*) site1)->bytes;
+  uint64_t bytes2 = ((const AllocSite*) site2)->bytes;
+
+  return (bytes1 < bytes2) - (bytes1 > bytes2);
+}
+
+/*
+ * Print the counters and the call sites, the sites with the most bytes first
+ *
+ * Every site is printed as the object file and the offset into it, which works with
+ * addr2line -f -e <object> <offset>, and with the symbol if the dynamic linker knows it
+ */
+void secure_alloc_print(FILE* stream, const AllocStats* stats)
+{
+  if(stats == NULL) return;
+
+  fprintf(stream, "Allocations: %lu mallocs | %lu frees | %lu bytes total | live %ld bytes | peak %ld bytes\n",
+    (unsigned long) stats->allocations, (unsigned long) stats->frees, (unsigned long) stats->totalBytes,
+    (long) stats->liveBytes, (long) stats->peakBytes);
+
+  AllocSite sorted[ALLOC_SITES];
+
+  memcpy(sorted, stats->sites, sizeof(AllocSite) * stats->siteAmount);
+
+  qsort(sorted, stats->siteAmount, sizeof(AllocSite), alloc_site_compare);
+
+  for(size_t index = 0; index < stats->siteAmount; index++)
+  {
+    const AllocSite* site = &sorted[index];
+
+    Dl_info info;
+
+    if(dladdr(site->site, &info) != 0 && info.dli_fname != NULL)
+    {
+      fprintf(stream, "  %10lu mallocs | %12lu bytes | %s+%#lx", (unsigned long) site->allocations, (unsigned long) site->bytes,
+        info.dli_fname, (unsigned long) ((uintptr_t) site->site - (uintptr_t) info.dli_fbase));
+
+      if(info.dli_sname != NULL) fprintf(stream, " (%s)", info.dli_sname);
+
+      fprintf(stream, "\n");
+    }
+    else fprintf(stream, "  %10lu mallocs | %12lu bytes | %p\n", (unsigned long) site->allocations, (unsigned long) site->bytes, site->site);
+  }
+
+  if(stats->lostSites > 0) fprintf(stream, "  %10lu mallocs from sites that did not fit\n", (unsigned long) stats->lostSites);
+}
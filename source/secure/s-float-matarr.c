@@ -1,5 +1,7 @@
 #include "../secure.h"
 
+#include "s-alloc-intern.h"
+
 /*
  * Create a float matrix array allocated on the HEAP using malloc
  *
@@ -11,13 +13,15 @@ float*** float_matarr_create(size_t amount, size_t height, size_t width)
 {
   if(amount <= 0 || height <= 0 || width <= 0) return NULL;
  
-  float*** matarr = malloc(sizeof(float**) * amount);
+  const void* site = ALLOC_SITE;
+
+  float*** matarr = secure_malloc(sizeof(float**) * amount, site);
 
   if(matarr == NULL) return NULL;
 
   for(size_t index = 0; index < amount; index++)
   {
-    matarr[index] = float_matrix_create(height, width);
+    matarr[index] = float_matrix_site_create(height, width, site);
   }
   return matarr;
 }
@@ -34,7 +38,7 @@ void float_matarr_free(float**** matarr, size_t amount, size_t height, size_t wi
   {
     float_matrix_free((*matarr) + index, height, width);
   }
-  free(*matarr);
+  secure_free(*matarr, sizeof(float**) * amount);
 
   *matarr = NULL;
 }
@@ -1,5 +1,7 @@
 #include "../secure.h"
 
+#include "s-alloc-intern.h"
+
 /*
  * RETURN
  * - SUCCESS | The filtered matrix result
@@ -24,27 +26,45 @@ float** float_matrix_filter_index(float** result, float** matrix, size_t height,
 }
 
 /*
- * Create a float matrix allocated on the HEAP using malloc
- *
- * RETURN
- * - SUCCESS | The created float matrix
- * - ERROR   | NULL
+ * Create a float matrix and count every allocation for a call site
  */
-float** float_matrix_create(size_t height, size_t width)
+float** float_matrix_site_create(size_t height, size_t width, const void* site)
 {
   if(height <= 0 || width <= 0) return NULL;
 
-  float** matrix = malloc(sizeof(float*) * height);
+  float** matrix = secure_malloc(sizeof(float*) * height, site);
 
   if(matrix == NULL) return NULL;
 
   for(size_t index = 0; index < height; index++)
   {
-    matrix[index] = float_vector_create(width);
+    matrix[index] = float_vector_site_create(width, site);
+
+    // If a row failed to be allocated, the rows before it are freed
+    if(matrix[index] == NULL)
+    {
+      for(size_t row = 0; row < index; row++) float_vector_free(&matrix[row], width);
+
+      secure_free(matrix, sizeof(float*) * height);
+
+      return NULL;
+    }
   }
   return matrix;
 }
 
+/*
+ * Create a float matrix allocated on the HEAP using malloc
+ *
+ * RETURN
+ * - SUCCESS | The created float matrix
+ * - ERROR   | NULL
+ */
+float** float_matrix_create(size_t height, size_t width)
+{
+  return float_matrix_site_create(height, width, ALLOC_SITE);
+}
+
 /*
  * Free a float matrix from the HEAP using free
  * Also assigns NULL to pointer
@@ -57,7 +77,7 @@ void float_matrix_free(float*** matrix, size_t height, size_t width)
   {
     float_vector_free((*matrix) + index, width);
   }
-  free(*matrix);
+  secure_free(*matrix, sizeof(float*) * height);
 
   *matrix = NULL;
 }
@@ -73,13 +93,15 @@ float** float_matrix_random_create(size_t height, size_t width, float min, float
 {
   if(height <= 0 || width <= 0) return NULL;
 
-  float** matrix = malloc(sizeof(float*) * height);
+  const void* site = ALLOC_SITE;
+
+  float** matrix = secure_malloc(sizeof(float*) * height, site);
 
   if(matrix == NULL) return NULL;
 
   for(size_t index = 0; index < height; index++)
   {
-    matrix[index] = float_vector_random_create(width, min, max);
+    matrix[index] = float_vector_random_site_create(width, min, max, site);
   }
   return matrix;
 }
@@ -147,10 +169,105 @@ float** float_matrix_elem_addit(float** result, float** matrix1, float** matrix2
   return result;
 }
 
+// The blocking of the matrix vector product, the rows and the columns of the original loop by default
+static MatrixBlocking matrixBlocking = { .rows = 1, .block = 0 };
+
+/*
+ * Set the blocking of the matrix vector product, for example a tuned blocking (secure_blocking_tune)
+ *
+ * Note: The blocking should be set before the kernels are called from other threads
+ */
+void secure_blocking_set(const MatrixBlocking* blocking)
+{
+  if(blocking == NULL) return;
+
+  // Only the unrolled amounts of rows are supported
+  size_t rows = (blocking->rows >= 4) ? 4 : (blocking->rows >= 2) ? 2 : 1;
+
+  matrixBlocking = (MatrixBlocking) { .rows = rows, .block = blocking->block };
+}
+
+/*
+ * Get the current blocking of the matrix vector product
+ */
+void secure_blocking_get(MatrixBlocking* blocking)
+{
+  if(blocking != NULL) *blocking = matrixBlocking;
+}
+
+/*
+ * Add the dot products of four rows and the columns from start to stop to the sums
+ */
+static void matrix_rows4_dotprod(float* sums, float** matrix, size_t row, size_t start, size_t stop, const float* vector)
+{
+  const float* row0 = matrix[row];
+  const float* row1 = matrix[row + 1];
+  const float* row2 = matrix[row + 2];
+  const float* row3 = matrix[row + 3];
+
+  float sum0 = 0.0f, sum1 = 0.0f, sum2 = 0.0f, sum3 = 0.0f;
+
+  // Every value of the vector is loaded once for the four rows
+  for(size_t wIndex = start; wIndex < stop; wIndex++)
+  {
+    float value = vector[wIndex];
+
+    sum0 += row0[wIndex] * value;
+    sum1 += row1[wIndex] * value;
+    sum2 += row2[wIndex] * value;
+    sum3 += row3[wIndex] * value;
+  }
+  sums[row] += sum0;
+  sums[row + 1] += sum1;
+  sums[row + 2] += sum2;
+  sums[row + 3] += sum3;
+}
+
+/*
+ * Add the dot products of two rows and the columns from start to stop to the sums
+ */
+static void matrix_rows2_dotprod(float* sums, float** matrix, size_t row, size_t start, size_t stop, const float* vector)
+{
+  const float* row0 = matrix[row];
+  const float* row1 = matrix[row + 1];
+
+  float sum0 = 0.0f, sum1 = 0.0f;
+
+  for(size_t wIndex = start; wIndex < stop; wIndex++)
+  {
+    float value = vector[wIndex];
+
+    sum0 += row0[wIndex] * value;
+    sum1 += row1[wIndex] * value;
+  }
+  sums[row] += sum0;
+  sums[row + 1] += sum1;
+}
+
+/*
+ * Add the dot product of one row and the columns from start to stop to the sums
+ */
+static void matrix_row_dotprod(float* sums, float** matrix, size_t row, size_t start, size_t stop, const float* vector)
+{
+  const float* row0 = matrix[row];
+
+  float sum0 = 0.0f;
+
+  for(size_t wIndex = start; wIndex < stop; wIndex++)
+  {
+    sum0 += row0[wIndex] * vector[wIndex];
+  }
+  sums[row] += sum0;
+}
+
 /*
  * Return the dot product of a matrix and a vector with different lengths
  *
- * Note: Maybe just return either result or NULL
+ * The columns are taken in blocks, so the block of the vector stays in the cache for every row,
+ * and multiple rows are calculated together, so every value of the vector is loaded once for them.
+ * The blocking is set with secure_blocking_set, and is tuned for the machine by secure_blocking_tune
+ *
+ * Note: The result can be the same vector as the input vector
  *
  * RETURN
  * - 0 | Success!
@@ -161,15 +278,31 @@ int float_matrix_vector_dotprod(float* result, float** matrix, size_t height, si
 {
   if(result == NULL || matrix == NULL || vector == NULL) return 1;
 
+  MatrixBlocking blocking = matrixBlocking;
+
+  size_t block = (blocking.block > 0) ? blocking.block : width;
+
   float tresult[height];
   memset(tresult, 0.0f, sizeof(float) * height);
- 
-  for(size_t hIndex = 0; hIndex < height; hIndex++)
+
+  for(size_t start = 0; start < width; start += block)
   {
-    for(size_t wIndex = 0; wIndex < width; wIndex++)
+    size_t stop = ((start + block) < width) ? (start + block) : width;
+
+    size_t hIndex = 0;
+
+    if(blocking.rows >= 4)
     {
-      tresult[hIndex] += (matrix[hIndex][wIndex] * vector[wIndex]);
+      for(; (hIndex + 4) <= height; hIndex += 4) matrix_rows4_dotprod(tresult, matrix, hIndex, start, stop, vector);
     }
+
+    if(blocking.rows >= 2)
+    {
+      for(; (hIndex + 2) <= height; hIndex += 2) matrix_rows2_dotprod(tresult, matrix, hIndex, start, stop, vector);
+    }
+
+    // The rows that are left are calculated one by one
+    for(; hIndex < height; hIndex++) matrix_row_dotprod(tresult, matrix, hIndex, start, stop, vector);
   }
   float_vector_copy(result, tresult, height);
 
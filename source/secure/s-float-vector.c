@@ -1,5 +1,7 @@
 #include "../secure.h"
 
+#include "s-alloc-intern.h"
+
 /*
  * Searches the min and max values of a vector
  *
@@ -38,18 +40,23 @@ float float_random_create(float min, float max)
 }
 
 /*
- * Create a float vector allocated on the HEAP using malloc
- * Also clean the memory using memset
- *
- * RETURN
- * - SUCCESS | The created float vector
- * - ERROR   | NULL
+ * Returns a random float between min and max, from the random generator of a seed (rand_r)
  */
-float* float_vector_create(size_t length)
+float float_random_seed_create(float min, float max, unsigned int* seed)
+{
+  float fraction = ((float) rand_r(seed) / (float) RAND_MAX);
+
+  return (fraction * (max - min) + min);
+}
+
+/*
+ * Create a float vector and count the allocation for a call site
+ */
+float* float_vector_site_create(size_t length, const void* site)
 {
   if(length <= 0) return NULL;
 
-  float* vector = malloc(sizeof(float) * length);
+  float* vector = secure_malloc(sizeof(float) * length, site);
 
   if(vector == NULL) return NULL;
 
@@ -58,25 +65,38 @@ float* float_vector_create(size_t length)
   return vector;
 }
 
+/*
+ * Create a float vector allocated on the HEAP using malloc
+ * Also clean the memory using memset
+ *
+ * RETURN
+ * - SUCCESS | The created float vector
+ * - ERROR   | NULL
+ */
+float* float_vector_create(size_t length)
+{
+  return float_vector_site_create(length, ALLOC_SITE);
+}
+
 /*
  * Free a float vector from the HEAP using free
  * Also assigns NULL to pointer
  */
 void float_vector_free(float** vector, size_t length)
 {
-  free(*vector);
+  secure_free(*vector, sizeof(float) * length);
 
   *vector = NULL;
 }
 
 /*
- *
+ * Create a float vector with random values and count the allocation for a call site
  */
-float* float_vector_random_create(size_t length, float min, float max)
+float* float_vector_random_site_create(size_t length, float min, float max, const void* site)
 {
   if(length <= 0) return NULL;
 
-  float* vector = malloc(sizeof(float) * length);
+  float* vector = secure_malloc(sizeof(float) * length, site);
 
   if(vector == NULL) return NULL;
 
@@ -87,6 +107,18 @@ float* float_vector_random_create(size_t length, float min, float max)
   return vector;
 }
 
+/*
+ * Create a float vector with random values between min and max
+ *
+ * RETURN
+ * - SUCCESS | The created float vector
+ * - ERROR   | NULL
+ */
+float* float_vector_random_create(size_t length, float min, float max)
+{
+  return float_vector_random_site_create(length, min, max, ALLOC_SITE);
+}
+
 /*
  * Scale all the vectors values by a scalor
  *
@@ -1,11 +1,14 @@
 #include "../secure.h"
 
 /*
- * Return random index between min and max
+ * Return random index between min and max,
+ * from the random generator of the seed or from rand if the seed is NULL
  */
-static size_t index_random_create(size_t min, size_t max)
+static size_t index_random_create(size_t min, size_t max, unsigned int* seed)
 {
-  float fraction = ((float) rand() / (float) RAND_MAX);
+  int random = (seed != NULL) ? rand_r(seed) : rand();
+
+  float fraction = ((float) random / (float) RAND_MAX);
 
   return (fraction * (max - min) + min);
 }
@@ -24,14 +27,17 @@ static size_t* index_array_switch_index(size_t* array, size_t index1, size_t ind
 }
 
 /*
- * Fill the inputted array with shuffled indexes
+ * Fill the inputted array with shuffled indexes, from the random generator of a seed
  * Each index only appears once
  *
+ * The seed is the state of the generator (rand_r), so every caller with its own seed
+ * gets the same order whatever other threads do
+ *
  * RETURN (size_t* array)
  * - SUCCESS | size_t* array
  * - ERROR   | NULL
  */
-size_t* index_array_shuffled_fill(size_t* array, size_t amount)
+size_t* index_array_shuffled_seed_fill(size_t* array, size_t amount, unsigned int* seed)
 {
   if(array == NULL) return NULL;
 
@@ -41,9 +47,22 @@ size_t* index_array_shuffled_fill(size_t* array, size_t amount)
   }
   for(size_t index = 0; index < amount; index++)
   {
-    size_t random = index_random_create(0, amount - 1);
+    size_t random = index_random_create(0, amount - 1, seed);
 
     array = index_array_switch_index(array, index, random);
   }
   return array;
 }
+
+/*
+ * Fill the inputted array with shuffled indexes
+ * Each index only appears once
+ *
+ * RETURN (size_t* array)
+ * - SUCCESS | size_t* array
+ * - ERROR   | NULL
+ */
+size_t* index_array_shuffled_fill(size_t* array, size_t amount)
+{
+  return index_array_shuffled_seed_fill(array, amount, NULL);
+}
@@ -0,0 +1,330 @@
+#include "../secure.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+// The amount of CPU models that a cache file keeps
+#define BLOCKING_MODELS 32
+
+// The blockings that are tried by the tuner
+static const size_t tuneRows[] = {1, 2, 4};
+
+static const size_t tuneBlocks[] = {0, 64, 256, 1024};
+
+// The shapes (height, width) that are timed, from the small hidden layers to a wide layer
+static const size_t tuneShapes[][2] = {{16, 16}, {64, 256}, {1024, 784}};
+
+#define TUNE_SHAPES (sizeof(tuneShapes) / sizeof(tuneShapes[0]))
+
+static uint64_t tune_nanos(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/*
+ * Get the model name of the CPU from /proc/cpuinfo
+ *
+ * PARAMS
+ * - char* model | The buffer of the model name, which is "unknown" if there is no model name
+ * - size_t size | The size of the buffer
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | The model name was not found
+ */
+int secure_cpu_model(char* model, size_t size)
+{
+  if(model == NULL || size == 0) return 1;
+
+  snprintf(model, size, "unknown");
+
+  FILE* file = fopen("/proc/cpuinfo", "r");
+
+  if(file == NULL) return 2;
+
+  char line[256];
+
+  int status = 2;
+
+  while(fgets(line, sizeof(line), file) != NULL)
+  {
+    if(strncmp(line, "model name", 10)) continue;
+
+    char* value = strchr(line, ':');
+
+    if(value == NULL) continue;
+
+    // Skip the colon and the spaces, and cut the newline
+    for(value++; *value == ' '; value++);
+
+    value[strcspn(value, "\n")] = '\0';
+
+    snprintf(model, size, "%s", value);
+
+    status = 0;
+
+    break;
+  }
+  fclose(file);
+
+  return status;
+}
+
+/*
+ * Time the matrix vector product of a shape with the current blocking
+ *
+ * RETURN (double nanos)
+ * - The nanoseconds of one product
+ */
+static double blocking_trial(float** matrix, const float* vector, float* result, size_t height, size_t width, uint64_t trialNanos)
+{
+  // One product warms up the caches
+  float_matrix_vector_dotprod(result, matrix, height, width, vector);
+
+  size_t calls = 0;
+
+  uint64_t start = tune_nanos();
+  uint64_t nanos = 0;
+
+  while(nanos < trialNanos)
+  {
+    float_matrix_vector_dotprod(result, matrix, height, width, vector);
+
+    calls++;
+
+    nanos = tune_nanos() - start;
+  }
+  return (double) nanos / calls;
+}
+
+/*
+ * Find the blocking of the matrix vector product that is the fastest on this machine
+ *
+ * Every blocking is timed on shapes from small to wide layers, and the blocking
+ * with the lowest mean time relative to whole rows one by one is the fastest.
+ * The blocking that was set before is set again after the trials
+ *
+ * PARAMS
+ * - MatrixBlocking* blocking | The fastest blocking
+ * - uint64_t trialNanos      | The time of every shape of every blocking
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int secure_blocking_tune(MatrixBlocking* blocking, uint64_t trialNanos)
+{
+  if(blocking == NULL) return 1;
+
+  MatrixBlocking oldBlocking;
+
+  secure_blocking_get(&oldBlocking);
+
+  float** matrices[TUNE_SHAPES];
+  float* vectors[TUNE_SHAPES];
+  float* results[TUNE_SHAPES];
+
+  for(size_t shape = 0; shape < TUNE_SHAPES; shape++)
+  {
+    matrices[shape] = float_matrix_random_create(tuneShapes[shape][0], tuneShapes[shape][1], -1.0f, +1.0f);
+    vectors[shape] = float_vector_random_create(tuneShapes[shape][1], -1.0f, +1.0f);
+    results[shape] = float_vector_create(tuneShapes[shape][0]);
+  }
+
+  // The first blocking is whole rows one by one, that the others are compared with
+  double baseNanos[TUNE_SHAPES];
+
+  double bestScore = INFINITY;
+
+  for(size_t rowsIndex = 0; rowsIndex < sizeof(tuneRows) / sizeof(size_t); rowsIndex++)
+  {
+    for(size_t blockIndex = 0; blockIndex < sizeof(tuneBlocks) / sizeof(size_t); blockIndex++)
+    {
+      MatrixBlocking candidate = { .rows = tuneRows[rowsIndex], .block = tuneBlocks[blockIndex] };
+
+      secure_blocking_set(&candidate);
+
+      double score = 0;
+
+      for(size_t shape = 0; shape < TUNE_SHAPES; shape++)
+      {
+        double nanos = blocking_trial(matrices[shape], vectors[shape], results[shape], tuneShapes[shape][0], tuneShapes[shape][1], trialNanos);
+
+        if(rowsIndex == 0 && blockIndex == 0) baseNanos[shape] = nanos;
+
+        score += nanos / baseNanos[shape];
+      }
+      score /= TUNE_SHAPES;
+
+      if(score < bestScore)
+      {
+        bestScore = score;
+
+        *blocking = candidate;
+      }
+    }
+  }
+
+  for(size_t shape = 0; shape < TUNE_SHAPES; shape++)
+  {
+    float_matrix_free(&matrices[shape], tuneShapes[shape][0], tuneShapes[shape][1]);
+    float_vector_free(&vectors[shape], tuneShapes[shape][1]);
+    float_vector_free(&results[shape], tuneShapes[shape][0]);
+  }
+  secure_blocking_set(&oldBlocking);
+
+  return 0; // Success!
+}
+
+/*
+ * Load the blocking of this CPU model from a cache file
+ *
+ * Every line of the file is the blocking of one CPU model: <rows> <block> <model name>
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to open the file
+ * - 3 | The file has no blocking for this CPU model
+ */
+int secure_blocking_load(MatrixBlocking* blocking, const char* path)
+{
+  if(blocking == NULL || path == NULL) return 1;
+
+  char model[128];
+
+  secure_cpu_model(model, sizeof(model));
+
+  FILE* file = fopen(path, "r");
+
+  if(file == NULL) return 2;
+
+  char line[256];
+
+  int status = 3;
+
+  while(fgets(line, sizeof(line), file) != NULL)
+  {
+    size_t rows, block;
+
+    char lineModel[128];
+
+    if(sscanf(line, "%zu %zu %127[^\n]", &rows, &block, lineModel) != 3) continue;
+
+    if(strcmp(lineModel, model)) continue;
+
+    *blocking = (MatrixBlocking) { .rows = rows, .block = block };
+
+    status = 0;
+
+    break;
+  }
+  fclose(file);
+
+  return status;
+}
+
+/*
+ * Save the blocking of this CPU model to a cache file, and keep the blockings of the other models
+ *
+ * The file is written to a temporary file first, so a reader never sees half a file
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to write the file
+ */
+int secure_blocking_save(const MatrixBlocking* blocking, const char* path)
+{
+  if(blocking == NULL || path == NULL) return 1;
+
+  char model[128];
+
+  secure_cpu_model(model, sizeof(model));
+
+  // The lines of the other CPU models are kept
+  char lines[BLOCKING_MODELS][256];
+
+  size_t amount = 0;
+
+  FILE* file = fopen(path, "r");
+
+  if(file != NULL)
+  {
+    while(amount < (BLOCKING_MODELS - 1) && fgets(lines[amount], sizeof(lines[amount]), file) != NULL)
+    {
+      size_t rows, block;
+
+      char lineModel[128];
+
+      if(sscanf(lines[amount], "%zu %zu %127[^\n]", &rows, &block, lineModel) != 3) continue;
+
+      if(strcmp(lineModel, model)) amount++;
+    }
+    fclose(file);
+  }
+
+  char tempPath[256];
+
+  // Every process writes its own temporary file, so processes that save at the same time don't mix their lines
+  snprintf(tempPath, sizeof(tempPath), "%s.%d.tmp", path, (int) getpid());
+
+  file = fopen(tempPath, "w");
+
+  if(file == NULL)
+  {
+    fprintf(stderr, "fopen: %s: %s\n", tempPath, strerror(errno));
+
+    return 2;
+  }
+
+  for(size_t index = 0; index < amount; index++) fputs(lines[index], file);
+
+  fprintf(file, "%ld %ld %s\n", blocking->rows, blocking->block, model);
+
+  fclose(file);
+
+  if(rename(tempPath, path) != 0)
+  {
+    fprintf(stderr, "rename: %s: %s\n", path, strerror(errno));
+
+    remove(tempPath);
+
+    return 2;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Set the blocking of this CPU model from a cache file,
+ * or tune the blocking and save it to the file if it has no blocking for this CPU model
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | The blocking was tuned, but failed to save it
+ */
+int secure_blocking_init(const char* path)
+{
+  if(path == NULL) return 1;
+
+  MatrixBlocking blocking;
+
+  if(secure_blocking_load(&blocking, path) == 0)
+  {
+    secure_blocking_set(&blocking);
+
+    return 0; // Success!
+  }
+
+  if(secure_blocking_tune(&blocking, 20000000) != 0) return 1;
+
+  secure_blocking_set(&blocking);
+
+  return (secure_blocking_save(&blocking, path) == 0) ? 0 : 2;
+}
@@ -0,0 +1,920 @@
+#include "review.h"
+#include "persue.h"
+#include "wonder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+// This is the maximum amount of candidates of a sweep
+#define SWEEP_CANDIDATES 128
+
+// This is the maximum amount of values of a parameter
+#define SWEEP_VALUES 16
+
+// This is the maximum amount of hidden layers of a candidate
+#define SWEEP_LAYERS 8
+
+// Every n:th sample is kept out of the training, and the candidates are ranked by the loss on them
+#define SWEEP_VALIDATION 5
+
+typedef enum { PARAM_LEARNRATE, PARAM_MOMENTUM, PARAM_HIDDEN, PARAM_ACTIV, PARAM_BSIZE, PARAM_AMOUNT } param_t;
+
+static const char* paramNames[PARAM_AMOUNT] = {"learnrate", "momentum", "hidden", "activ", "bsize"};
+
+// The values of the parameters that are not in the spec, the same as master
+static const char* paramDefaults[PARAM_AMOUNT] = {"0.0009", "0.1", "8-16-16-16-8", "relu-tanh-relu-sigmoid-tanh", "1"};
+
+static const char* activNames[] = {"none", "sigmoid", "relu", "tanh", "softmax"};
+
+typedef struct
+{
+  size_t amount;                 // The amount of values, or 0 if the parameter has a range
+  char values[SWEEP_VALUES][64]; // The values as they were written in the spec
+  double min;                    // The lowest value of the range
+  double max;                    // The highest value of the range
+} SweepParam;
+
+typedef struct
+{
+  float learnrate;              // The learning rate
+  float momentum;               // The momentum
+  size_t hiddenAmount;          // The amount of hidden layers
+  size_t hidden[SWEEP_LAYERS];  // The amount of nodes of every hidden layer
+  activ_t activs[SWEEP_LAYERS]; // The activation function of every hidden layer
+  size_t bsize;                 // The batch size
+  char name[128];               // The hidden layers and activations as they were written in the spec
+  pid_t pid;                    // The worker process, or 0 if it is not started or has been stopped
+  int commandFd;                // The pipe that the total amount of epochs to train is written to
+  int resultFd;                 // The pipe that the worker writes its report to
+  size_t epochs;                // The amount of epochs that the candidate has trained
+  float loss;                   // The validation loss after the epochs (infinite if it failed)
+  double seconds;               // The time that the candidate has trained
+  size_t rounds;                // The amount of rounds that the candidate has been in
+  bool failed;                  // If the worker failed or died, so the candidate is not trained again
+} SweepCandidate;
+
+typedef struct
+{
+  float loss;     // The validation loss after the epochs
+  uint64_t nanos; // The time of the epochs of the round
+} SweepReport;
+
+typedef struct
+{
+  float** inputs;          // The inputs of the training samples
+  float** targets;         // The targets of the training samples
+  size_t amount;           // The amount of training samples
+  float** checkInputs;     // The inputs of the validation samples
+  float** checkTargets;    // The targets of the validation samples
+  size_t checkAmount;      // The amount of validation samples
+} SweepData;
+
+/*
+ * Parse a line of a spec: <param> <value> [value...] or <param> range <min> <max>
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The line is bad
+ */
+static int sweep_param_parse(SweepParam* params, const char* line)
+{
+  char copy[1024];
+
+  snprintf(copy, sizeof(copy), "%s", line);
+
+  char* save = NULL;
+
+  char* name = strtok_r(copy, " \t\n", &save);
+
+  if(name == NULL || name[0] == '#') return 0;
+
+  param_t param;
+
+  for(param = 0; param < PARAM_AMOUNT; param++)
+  {
+    if(!strcmp(name, paramNames[param])) break;
+  }
+
+  if(param == PARAM_AMOUNT)
+  {
+    error_print("Unknown parameter: %s", name);
+
+    return 1;
+  }
+  SweepParam* sweepParam = &params[param];
+
+  memset(sweepParam, 0, sizeof(SweepParam));
+
+  char* value = strtok_r(NULL, " \t\n", &save);
+
+  if(value != NULL && !strcmp(value, "range"))
+  {
+    char* min = strtok_r(NULL, " \t\n", &save);
+    char* max = strtok_r(NULL, " \t\n", &save);
+
+    // Only the learning rate and the momentum have values between the spec values
+    if(min == NULL || max == NULL || (param != PARAM_LEARNRATE && param != PARAM_MOMENTUM))
+    {
+      error_print("Bad range of %s", name);
+
+      return 1;
+    }
+    sweepParam->min = atof(min);
+    sweepParam->max = atof(max);
+
+    return 0; // Success!
+  }
+
+  for(; value != NULL; value = strtok_r(NULL, " \t\n", &save))
+  {
+    if(sweepParam->amount >= SWEEP_VALUES)
+    {
+      error_print("Too many values of %s", name);
+
+      return 1;
+    }
+    snprintf(sweepParam->values[sweepParam->amount++], 64, "%s", value);
+  }
+
+  if(sweepParam->amount == 0)
+  {
+    error_print("No values of %s", name);
+
+    return 1;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Read a spec file, with one parameter on every line
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | A line is bad
+ * - 2 | Failed to open the file
+ */
+static int sweep_spec_read(SweepParam* params, const char* path)
+{
+  FILE* file = fopen(path, "r");
+
+  if(file == NULL)
+  {
+    error_print("fopen: %s: %s", path, strerror(errno));
+
+    return 2;
+  }
+
+  char line[1024];
+
+  int status = 0;
+
+  while(status == 0 && fgets(line, sizeof(line), file) != NULL)
+  {
+    status = sweep_param_parse(params, line);
+  }
+  fclose(file);
+
+  return status;
+}
+
+/*
+ * Parse a list of sizes or activations, separated by dashes
+ *
+ * RETURN (size_t amount)
+ * - The amount of parsed items, or 0 if an item is bad
+ */
+static size_t sweep_layers_parse(size_t* sizes, activ_t* activs, const char* value)
+{
+  char copy[64];
+
+  snprintf(copy, sizeof(copy), "%s", value);
+
+  char* save = NULL;
+
+  size_t amount = 0;
+
+  for(char* item = strtok_r(copy, "-", &save); item != NULL; item = strtok_r(NULL, "-", &save))
+  {
+    if(amount >= SWEEP_LAYERS) return 0;
+
+    if(sizes != NULL)
+    {
+      sizes[amount] = atol(item);
+
+      if(sizes[amount] == 0) return 0;
+    }
+    else
+    {
+      size_t activ;
+
+      for(activ = 0; activ < sizeof(activNames) / sizeof(char*); activ++)
+      {
+        if(!strcmp(item, activNames[activ])) break;
+      }
+
+      if(activ == sizeof(activNames) / sizeof(char*)) return 0;
+
+      activs[amount] = activ;
+    }
+    amount++;
+  }
+  return amount;
+}
+
+/*
+ * Set a candidate from the spec values of its parameters
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | A value is bad, or the amount of activations does not match the hidden layers
+ */
+static int sweep_candidate_set(SweepCandidate* candidate, const char* values[PARAM_AMOUNT])
+{
+  memset(candidate, 0, sizeof(SweepCandidate));
+
+  candidate->learnrate = atof(values[PARAM_LEARNRATE]);
+  candidate->momentum = atof(values[PARAM_MOMENTUM]);
+  candidate->bsize = atol(values[PARAM_BSIZE]);
+
+  candidate->hiddenAmount = sweep_layers_parse(candidate->hidden, NULL, values[PARAM_HIDDEN]);
+
+  size_t activAmount = sweep_layers_parse(NULL, candidate->activs, values[PARAM_ACTIV]);
+
+  // One activation is used for every hidden layer
+  if(activAmount == 1)
+  {
+    for(size_t layer = 1; layer < candidate->hiddenAmount; layer++) candidate->activs[layer] = candidate->activs[0];
+
+    activAmount = candidate->hiddenAmount;
+  }
+
+  if(candidate->hiddenAmount == 0 || activAmount != candidate->hiddenAmount || candidate->bsize == 0) return 1;
+  snprintf(candidate->name, sizeof(candidate->name), "%s %s", values[PARAM_HIDDEN], values[PARAM_ACTIV]);
+
+  candidate->loss = INFINITY;
+
+  return 0; // Success!
+}
+
+/*
+ * Create every combination of the values of the parameters
+ *
+ * RETURN (size_t amount)
+ * - The amount of candidates, or 0 if the grid is too large or has no valid candidate
+ */
+static size_t sweep_grid_create(SweepCandidate* candidates, const SweepParam* params)
+{
+  size_t amount = 1;
+
+  for(param_t param = 0; param < PARAM_AMOUNT; param++)
+  {
+    if(params[param].amount == 0)
+    {
+      error_print("The range of %s can only be searched with --random", paramNames[param]);
+
+      return 0;
+    }
+    amount *= params[param].amount;
+  }
+
+  if(amount > SWEEP_CANDIDATES)
+  {
+    error_print("The grid has %ld candidates, the most is %d", amount, SWEEP_CANDIDATES);
+
+    return 0;
+  }
+
+  size_t candidateAmount = 0;
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    const char* values[PARAM_AMOUNT];
+
+    // The index is a number with a digit for every parameter
+    size_t rest = index;
+
+    for(param_t param = 0; param < PARAM_AMOUNT; param++)
+    {
+      values[param] = params[param].values[rest % params[param].amount];
+
+      rest /= params[param].amount;
+    }
+
+    // The combinations with activations that do not match the hidden layers are skipped
+    if(sweep_candidate_set(&candidates[candidateAmount], values) == 0) candidateAmount++;
+  }
+
+  if(candidateAmount == 0) error_print("No combination of the values is a valid candidate");
+
+  return candidateAmount;
+}
+
+/*
+ * Draw random candidates, the values of a list are equally likely,
+ * and a range is drawn log-uniformly for the learning rate and uniformly for the momentum
+ *
+ * RETURN (size_t amount)
+ * - The amount of candidates, or 0 if no draw is a valid candidate
+ */
+static size_t sweep_random_create(SweepCandidate* candidates, const SweepParam* params, size_t amount)
+{
+  size_t candidateAmount = 0;
+
+  // The draws with activations that do not match the hidden layers are drawn again
+  for(size_t draw = 0; draw < (amount * SWEEP_VALUES) && candidateAmount < amount; draw++)
+  {
+    const char* values[PARAM_AMOUNT];
+
+    char drawn[PARAM_AMOUNT][64];
+
+    for(param_t param = 0; param < PARAM_AMOUNT; param++)
+    {
+      const SweepParam* sweepParam = &params[param];
+
+      if(sweepParam->amount > 0)
+      {
+        values[param] = sweepParam->values[rand() % sweepParam->amount];
+
+        continue;
+      }
+      double fraction = (double) rand() / RAND_MAX;
+
+      double value;
+
+      if(param == PARAM_LEARNRATE && sweepParam->min > 0)
+      {
+        value = exp(log(sweepParam->min) + fraction * (log(sweepParam->max) - log(sweepParam->min)));
+      }
+      else value = sweepParam->min + fraction * (sweepParam->max - sweepParam->min);
+
+      snprintf(drawn[param], sizeof(drawn[param]), "%g", value);
+
+      values[param] = drawn[param];
+    }
+
+    if(sweep_candidate_set(&candidates[candidateAmount], values) == 0) candidateAmount++;
+  }
+
+  if(candidateAmount < amount) error_print("Only %ld of the draws were valid candidates", candidateAmount);
+
+  return candidateAmount;
+}
+
+static void sweep_data_free(SweepData* data)
+{
+  free(data->inputs);
+  free(data->targets);
+
+  free(data->checkInputs);
+  free(data->checkTargets);
+
+  *data = (SweepData) { 0 };
+}
+
+/*
+ * Create the samples of the smiley image, every n:th sample is a validation sample
+ *
+ * The samples are pointers to the rows of the image matrix, which is owned by the caller
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to allocate the samples
+ */
+static int sweep_data_create(SweepData* data, float** inputs, float** targets, size_t amount)
+{
+  if(data == NULL || inputs == NULL || targets == NULL || amount < SWEEP_VALIDATION) return 1;
+
+  data->checkAmount = amount / SWEEP_VALIDATION;
+  data->amount = amount - data->checkAmount;
+
+  data->inputs = malloc(sizeof(float*) * data->amount);
+  data->targets = malloc(sizeof(float*) * data->amount);
+
+  data->checkInputs = malloc(sizeof(float*) * data->checkAmount);
+  data->checkTargets = malloc(sizeof(float*) * data->checkAmount);
+
+  if(data->inputs == NULL || data->targets == NULL || data->checkInputs == NULL || data->checkTargets == NULL)
+  {
+    sweep_data_free(data);
+
+    return 2;
+  }
+
+  size_t trainIndex = 0;
+  size_t checkIndex = 0;
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    if((index % SWEEP_VALIDATION) == (SWEEP_VALIDATION - 1) && checkIndex < data->checkAmount)
+    {
+      data->checkInputs[checkIndex] = inputs[index];
+      data->checkTargets[checkIndex++] = targets[index];
+    }
+    else
+    {
+      data->inputs[trainIndex] = inputs[index];
+      data->targets[trainIndex++] = targets[index];
+    }
+  }
+  return 0; // Success!
+}
+
+/*
+ * Get the mean cost of the network on the validation samples
+ *
+ * RETURN (float loss)
+ * - The mean cost, or infinity if the network is broken
+ */
+static float sweep_loss(Network network, const SweepData* data)
+{
+  float output;
+
+  double cost = 0;
+
+  for(size_t index = 0; index < data->checkAmount; index++)
+  {
+    if(network_forward(&output, network, data->checkInputs[index]) != 0) return INFINITY;
+
+    cost += cross_entropy_cost(&output, data->checkTargets[index], 1);
+  }
+  float loss = cost / data->checkAmount;
+
+  return isfinite(loss) ? loss : INFINITY;
+}
+
+/*
+ * Train a candidate in a worker process, every command is the total amount of epochs to train,
+ * and the report of the epochs is written back. The worker stops when the command pipe is closed
+ */
+static void sweep_worker_run(const SweepCandidate* candidate, const SweepData* data, int commandFd, int resultFd)
+{
+  // The progress of every epoch of every worker would flood the console
+  log_level_set(LOG_LEVEL_WARN);
+
+  size_t amounts[SWEEP_LAYERS + 2];
+  activ_t activs[SWEEP_LAYERS + 1];
+
+  amounts[0] = 2;
+
+  for(size_t layer = 0; layer < candidate->hiddenAmount; layer++)
+  {
+    amounts[layer + 1] = candidate->hidden[layer];
+    activs[layer] = candidate->activs[layer];
+  }
+  amounts[candidate->hiddenAmount + 1] = 1;
+  activs[candidate->hiddenAmount] = ACTIV_SIGMOID;
+
+  // Every candidate starts from the same random state, so only the parameters differ
+  srand(420);
+
+  Network network;
+
+  if(network_init(&network, candidate->hiddenAmount + 2, amounts, activs, candidate->learnrate, candidate->momentum) != 0) return;
+
+  TrainOptions options = { .pool = NULL, .seed = 420 };
+
+  Trainer trainer;
+
+  trainer_init(&trainer, &options);
+
+  size_t epochs = 0;
+  size_t total;
+
+  while(read(commandFd, &total, sizeof(total)) == sizeof(total))
+  {
+    uint64_t start = timer_nanos();
+
+    int status = 0;
+
+    if(total > epochs)
+    {
+      status = network_train_mini_batch_epochs(&trainer, &network, data->inputs, data->targets, data->amount, candidate->bsize, total - epochs);
+    }
+    epochs = total;
+
+    SweepReport report = { .loss = (status == 0) ? sweep_loss(network, data) : INFINITY, .nanos = timer_nanos() - start };
+
+    if(write(resultFd, &report, sizeof(report)) != sizeof(report)) break;
+  }
+  trainer_free(&trainer);
+
+  network_free(&network);
+}
+
+/*
+ * Start the worker process of a candidate
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to create the pipes or the process
+ */
+static int sweep_worker_start(SweepCandidate* candidates, size_t amount, size_t index, const SweepData* data)
+{
+  int commandPipe[2];
+  int resultPipe[2];
+
+  if(pipe(commandPipe) != 0) return 1;
+
+  if(pipe(resultPipe) != 0)
+  {
+    close(commandPipe[0]);
+    close(commandPipe[1]);
+
+    return 1;
+  }
+
+  pid_t pid = fork();
+
+  if(pid == 0)
+  {
+    // The worker closes the pipes of the other workers, so only the parent can keep them open
+    for(size_t other = 0; other < amount; other++)
+    {
+      if(candidates[other].pid <= 0) continue;
+
+      close(candidates[other].commandFd);
+      close(candidates[other].resultFd);
+    }
+    close(commandPipe[1]);
+    close(resultPipe[0]);
+
+    sweep_worker_run(&candidates[index], data, commandPipe[0], resultPipe[1]);
+
+    _exit(0);
+  }
+  close(commandPipe[0]);
+  close(resultPipe[1]);
+
+  if(pid < 0)
+  {
+    error_print("fork: %s", strerror(errno));
+
+    close(commandPipe[1]);
+    close(resultPipe[0]);
+
+    return 1;
+  }
+  candidates[index].pid = pid;
+  candidates[index].commandFd = commandPipe[1];
+  candidates[index].resultFd = resultPipe[0];
+
+  return 0; // Success!
+}
+
+/*
+ * Stop the worker process of a candidate, a worker that lost is killed at once
+ */
+static void sweep_worker_stop(SweepCandidate* candidate, bool lost)
+{
+  if(candidate->pid <= 0) return;
+
+  if(lost) kill(candidate->pid, SIGKILL);
+
+  close(candidate->commandFd);
+  close(candidate->resultFd);
+
+  waitpid(candidate->pid, NULL, 0);
+
+  candidate->pid = 0;
+}
+
+/*
+ * Mark a candidate as failed, and kill its worker
+ */
+static void sweep_candidate_fail(SweepCandidate* candidate, const char* reason)
+{
+  error_print("Candidate %s failed: %s", candidate->name, reason);
+
+  candidate->loss = INFINITY;
+  candidate->failed = true;
+
+  sweep_worker_stop(candidate, true);
+}
+
+/*
+ * Train the candidates that are still in the sweep up to a total amount of epochs,
+ * with at most an amount of workers training at the same time
+ *
+ * The workers of the candidates are started the first time they are trained, and then keep
+ * their networks between the rounds, so a round only trains the epochs after the last round
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to wait for the workers
+ */
+static int sweep_round_run(SweepCandidate* candidates, size_t amount, SweepCandidate** alive, size_t aliveAmount, size_t epochs, size_t workers, const SweepData* data)
+{
+  struct pollfd fds[SWEEP_CANDIDATES];
+
+  SweepCandidate* owners[SWEEP_CANDIDATES];
+
+  size_t running = 0;
+  size_t next = 0;
+
+  while(next < aliveAmount || running > 0)
+  {
+    // Candidates are started until every worker is busy
+    while(next < aliveAmount && running < workers)
+    {
+      SweepCandidate* candidate = alive[next++];
+
+      if(candidate->failed) continue;
+
+      candidate->rounds++;
+
+      if(candidate->pid == 0 && sweep_worker_start(candidates, amount, candidate - candidates, data) != 0)
+      {
+        sweep_candidate_fail(candidate, "the worker could not be started");
+
+        continue;
+      }
+
+      if(write(candidate->commandFd, &epochs, sizeof(epochs)) != sizeof(epochs))
+      {
+        sweep_candidate_fail(candidate, "the worker could not be commanded");
+
+        continue;
+      }
+      fds[running] = (struct pollfd) { .fd = candidate->resultFd, .events = POLLIN };
+
+      owners[running++] = candidate;
+    }
+
+    if(running == 0) break;
+
+    if(poll(fds, running, -1) < 0)
+    {
+      if(errno == EINTR) continue;
+
+      error_print("poll: %s", strerror(errno));
+
+      return 1;
+    }
+
+    for(size_t slot = 0; slot < running;)
+    {
+      if(fds[slot].revents == 0)
+      {
+        slot++;
+
+        continue;
+      }
+      SweepCandidate* candidate = owners[slot];
+
+      SweepReport report;
+
+      if(read(candidate->resultFd, &report, sizeof(report)) == sizeof(report))
+      {
+        candidate->loss = report.loss;
+        candidate->seconds += report.nanos / 1e9;
+        candidate->epochs = epochs;
+      }
+      else sweep_candidate_fail(candidate, "the worker died");
+
+      // The last running worker takes the slot of the done worker
+      running--;
+
+      fds[slot] = fds[running];
+      owners[slot] = owners[running];
+    }
+  }
+  return 0; // Success!
+}
+
+/*
+ * Compare two candidates, the candidate that got further in the sweep is first, then the candidate with the lowest loss
+ */
+static int sweep_candidate_compare(const void* pointer1, const void* pointer2)
+{
+  const SweepCandidate* candidate1 = *(SweepCandidate* const*) pointer1;
+  const SweepCandidate* candidate2 = *(SweepCandidate* const*) pointer2;
+
+  if(candidate1->rounds != candidate2->rounds) return (candidate1->rounds < candidate2->rounds) ? 1 : -1;
+
+  return (candidate1->loss > candidate2->loss) - (candidate1->loss < candidate2->loss);
+}
+
+/*
+ * Print the candidates ranked, from the best to the worst
+ */
+static void sweep_results_print(FILE* stream, SweepCandidate* candidates, size_t amount)
+{
+  SweepCandidate* ranked[SWEEP_CANDIDATES];
+
+  for(size_t index = 0; index < amount; index++) ranked[index] = &candidates[index];
+
+  qsort(ranked, amount, sizeof(SweepCandidate*), sweep_candidate_compare);
+
+  fprintf(stream, "%4s %6s %6s %10s %10s %9s %6s %9s  %s\n", "rank", "rounds", "epochs", "loss", "learnrate", "momentum", "bsize", "seconds", "hidden activ");
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    const SweepCandidate* candidate = ranked[index];
+
+    fprintf(stream, "%4ld %6ld %6ld %10.6f %10.4g %9.4g %6ld %9.2f  %s%s\n", index + 1, candidate->rounds, candidate->epochs,
+      candidate->loss, candidate->learnrate, candidate->momentum, candidate->bsize, candidate->seconds, candidate->name,
+      candidate->failed ? " (failed)" : "");
+  }
+}
+
+/*
+ * Sweep the hyperparameters of the smiley network with successive halving
+ *
+ * ./sweep [--spec PATH] [--param LINE] [--random N] [--workers N] [--epochs N] [--max-epochs N] [--eta N] [--seed N]
+ *
+ * Every line of the spec (and every --param) is a parameter and its values:
+ *   learnrate 0.0003 0.0009 0.003
+ *   momentum range 0 0.5
+ *   hidden 8-16-16-16-8 16-16
+ *   activ relu-tanh-relu-sigmoid-tanh tanh
+ *   bsize 1 8
+ * The parameters that are not in the spec have the values of master. Every combination of the values
+ * is a candidate, or with --random, N candidates are drawn (a range can only be drawn from).
+ *
+ * Every candidate is trained in its own worker process, with at most one worker per online processor
+ * training at the same time. Every round trains the candidates up to a total amount of epochs,
+ * then only the best 1 / eta by the loss on the validation samples are kept and the rest are killed,
+ * and the next round trains eta times as many epochs, until one candidate is left or the max epochs are reached
+ */
+int main(int argc, char* argv[])
+{
+  SweepParam params[PARAM_AMOUNT];
+
+  memset(params, 0, sizeof(params));
+
+  for(param_t param = 0; param < PARAM_AMOUNT; param++)
+  {
+    params[param].amount = 1;
+
+    snprintf(params[param].values[0], 64, "%s", paramDefaults[param]);
+  }
+
+  size_t randomAmount = 0;
+  size_t epochs = 4;
+  size_t maxEpochs = 108;
+  size_t eta = 3;
+
+  unsigned int seed = 420;
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  size_t workers = (processors > 0) ? processors : 1;
+
+  for(int index = 1; index < argc; index++)
+  {
+    const char* value = ((index + 1) < argc) ? argv[index + 1] : NULL;
+
+    if(value == NULL) break;
+
+    if(!strcmp(argv[index], "--spec"))
+    {
+      if(sweep_spec_read(params, value) != 0) return 1;
+    }
+    else if(!strcmp(argv[index], "--param"))
+    {
+      if(sweep_param_parse(params, value) != 0) return 1;
+    }
+    else if(!strcmp(argv[index], "--random")) randomAmount = atol(value);
+
+    else if(!strcmp(argv[index], "--workers")) workers = atol(value);
+
+    else if(!strcmp(argv[index], "--epochs")) epochs = atol(value);
+
+    else if(!strcmp(argv[index], "--max-epochs")) maxEpochs = atol(value);
+
+    else if(!strcmp(argv[index], "--eta")) eta = atol(value);
+
+    else if(!strcmp(argv[index], "--seed")) seed = atol(value);
+
+    else continue;
+
+    index++;
+  }
+
+  if(workers < 1 || epochs < 1 || eta < 2 || randomAmount > SWEEP_CANDIDATES)
+  {
+    error_print("The workers and the epochs have to be at least 1, the eta at least 2 and the random candidates at most %d", SWEEP_CANDIDATES);
+
+    return 1;
+  }
+  srand(seed);
+
+  static SweepCandidate candidates[SWEEP_CANDIDATES];
+
+  size_t amount = (randomAmount > 0) ? sweep_random_create(candidates, params, randomAmount) : sweep_grid_create(candidates, params);
+
+  if(amount == 0) return 1;
+
+  ImageCache image;
+
+  if(image_cache_read(&image, "../assets/smilie.png", 1, IMAGE_LAYOUT_INTERLEAVED, "../assets/.cache") != 0)
+  {
+    error_print("Failed to read image");
+
+    return 1;
+  }
+  // The blocking is set before the workers are forked, so every worker trains with the tuned kernels
+  if(secure_blocking_init("../assets/.cache/blocking.txt") != 0) error_print("secure_blocking_init");
+
+  size_t sampleAmount = image.width * image.height;
+
+  float** matrix = image_values_matrix_create(image.values, image.width, image.height);
+
+  image_cache_free(&image);
+
+  if(matrix == NULL)
+  {
+    error_print("Failed to read image");
+
+    return 1;
+  }
+  float** inputs = float_matrix_create(sampleAmount, 2);
+  float** targets = float_matrix_create(sampleAmount, 1);
+
+  if(inputs == NULL || targets == NULL)
+  {
+    error_print("Failed to create the samples");
+
+    float_matrix_free(&inputs, sampleAmount, 2);
+    float_matrix_free(&targets, sampleAmount, 1);
+
+    float_matrix_free(&matrix, sampleAmount, 3);
+
+    return 1;
+  }
+  float_matrix_filter_index(inputs, matrix, sampleAmount, 3, (int[]) {0, 1}, 2);
+  float_matrix_filter_index(targets, matrix, sampleAmount, 3, (int[]) {2}, 1);
+
+  float_matrix_free(&matrix, sampleAmount, 3);
+
+  SweepData data;
+
+  if(sweep_data_create(&data, inputs, targets, sampleAmount) != 0)
+  {
+    error_print("Failed to create the samples");
+
+    float_matrix_free(&inputs, sampleAmount, 2);
+    float_matrix_free(&targets, sampleAmount, 1);
+
+    return 1;
+  }
+
+  // A worker that died should fail its candidate, not kill the sweep when its pipe is written to
+  signal(SIGPIPE, SIG_IGN);
+
+  SweepCandidate* alive[SWEEP_CANDIDATES];
+
+  for(size_t index = 0; index < amount; index++) alive[index] = &candidates[index];
+
+  size_t aliveAmount = amount;
+
+  fprintf(stderr, "Sweeping %ld candidates with %ld workers (epochs: %ld eta: %ld max epochs: %ld)\n", amount, workers, epochs, eta, maxEpochs);
+
+  int status = 0;
+
+  for(size_t round = 1; status == 0; round++)
+  {
+    uint64_t start = timer_nanos();
+
+    if(sweep_round_run(candidates, amount, alive, aliveAmount, epochs, workers, &data) != 0) status = 1;
+
+    qsort(alive, aliveAmount, sizeof(SweepCandidate*), sweep_candidate_compare);
+
+    fprintf(stderr, "Round %ld: %ld candidates trained to %ld epochs in %.2f s, best loss %.6f (%.4g %.4g %s)\n", round, aliveAmount,
+      epochs, (timer_nanos() - start) / 1e9, alive[0]->loss, alive[0]->learnrate, alive[0]->momentum, alive[0]->name);
+
+    if(aliveAmount <= 1 || (epochs * eta) > maxEpochs) break;
+
+    // The worst candidates are killed, and the rest are trained eta times as many epochs
+    size_t keepAmount = (aliveAmount + eta - 1) / eta;
+
+    for(size_t index = keepAmount; index < aliveAmount; index++) sweep_worker_stop(alive[index], true);
+
+    aliveAmount = keepAmount;
+
+    epochs *= eta;
+  }
+
+  // The workers that are left are stopped by closing their command pipes
+  for(size_t index = 0; index < amount; index++) sweep_worker_stop(&candidates[index], false);
+
+  sweep_results_print(stdout, candidates, amount);
+
+  sweep_data_free(&data);
+
+  float_matrix_free(&inputs, sampleAmount, 2);
+  float_matrix_free(&targets, sampleAmount, 1);
+
+  return status;
+}
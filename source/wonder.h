@@ -3,14 +3,108 @@
 
 #include "secure.h"
 #include "review.h"
+#include "persue.h"
 
 #include <errno.h>
+#include <pthread.h>
 
 #include "stb_image.h"
 #include "stb_image_write.h"
 
+// This are identifiers for how the channels of image values are ordered
+// - Interleaved: RGBRGBRGB...
+// - Planar:      RRR...GGG...BBB...
+typedef enum { IMAGE_LAYOUT_INTERLEAVED, IMAGE_LAYOUT_PLANAR } image_layout_t;
+
+typedef struct
+{
+  Network network;        // The snapshot of the network that is rendered
+  float* values;          // The rendered values of the current frame
+  size_t width;           // The width of the frames
+  size_t height;          // The height of the frames
+  size_t interval;        // The amount of epochs between every frame
+  const char* format;     // The path format of the frames
+  size_t frame;           // The number of the last started frame
+  pthread_t thread;       // The background render thread
+  bool started;           // If the render thread has been started and not joined
+  bool busy;              // If the render thread is still using the snapshot
+  TrainObserver observer; // The observer that starts the frames (train_observer_add)
+} Preview;
+
+typedef struct
+{
+  float* values;         // The values of every image, one image after another
+  size_t length;         // The amount of values
+  size_t amount;         // The amount of images
+  size_t channels;       // The amount of channels of every image
+  image_layout_t layout; // How the channels of every image are ordered
+  char** filepaths;      // The filepath of every image
+  size_t* widths;        // The width of every image
+  size_t* heights;       // The height of every image
+  size_t* offsets;       // The index of the first value of every image
+} ImageDataset;
+
+typedef struct
+{
+  float* values;         // The values of the image
+  size_t width;          // The width of the image
+  size_t height;         // The height of the image
+  size_t channels;       // The amount of channels of the image
+  image_layout_t layout; // How the channels of the image are ordered
+  void* mapping;         // The mapped cache file, or NULL if the values are allocated
+  size_t size;           // The size of the mapped cache file
+} ImageCache;
+
+typedef struct
+{
+  uint8_t* pixels;   // The pixels of every tile, one tile after another
+  size_t width;      // The width of the image
+  size_t height;     // The height of the image
+  size_t channels;   // The amount of channels of every pixel
+  size_t tileSize;   // The width and height of every tile
+  size_t columns;    // The amount of tiles in every row
+  size_t rows;       // The amount of tiles in every column
+  void* mapping;     // The mapped tile file
+  size_t size;       // The size of the mapped tile file
+  unsigned int seed; // The state of the random pixels
+} ImageTiles;
+
 extern int image_values_write(const char* filepath, const float* values, size_t width, size_t height);
 
 extern float** image_values_matrix_read(size_t* width, size_t* height, const char* filepath);
 
+extern float** image_values_matrix_create(const float* values, size_t width, size_t height);
+
+extern float* image_pixels_values_convert(float* values, const uint8_t* pixels, size_t length);
+
+extern uint8_t* image_values_pixels_convert(uint8_t* pixels, const float* values, size_t length);
+
+extern float* image_channels_values_read(size_t* width, size_t* height, size_t channels, image_layout_t layout, const char* filepath);
+
+extern int image_channels_values_write(const char* filepath, const float* values, size_t width, size_t height, size_t channels, image_layout_t layout);
+
+extern int image_dataset_read(ImageDataset* dataset, const char* path, size_t channels, image_layout_t layout, size_t threads);
+
+extern void image_dataset_free(ImageDataset* dataset);
+
+extern int image_cache_read(ImageCache* cache, const char* filepath, size_t channels, image_layout_t layout, const char* cachedir);
+
+extern void image_cache_free(ImageCache* cache);
+
+extern int image_tiles_create(const char* filepath, const char* tilepath, size_t tileSize, size_t channels);
+
+extern int image_tiles_open(ImageTiles* tiles, const char* tilepath, unsigned int seed);
+
+extern int image_tiles_batch_fill(float** inputs, float** targets, ImageTiles* tiles, size_t amount, size_t perTile);
+
+extern void image_tiles_close(ImageTiles* tiles);
+
+extern int image_network_values_render(float* values, Network network, size_t width, size_t height);
+
+extern int preview_init(Preview* preview, Network network, size_t width, size_t height, size_t interval, const char* format);
+
+extern int preview_epoch_observe(const Network* network, const TrainMetrics* metrics, void* data);
+
+extern void preview_free(Preview* preview);
+
 #endif // WONDER_H
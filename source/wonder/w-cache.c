@@ -0,0 +1,259 @@
+#include "../wonder.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// This is the first bytes of every cache file, change the version if the header changes
+#define CACHE_MAGIC "NNCACHE1"
+
+// The values start at a multiple of this, so they are aligned for SIMD loads
+#define CACHE_ALIGN 64
+
+typedef struct
+{
+  char magic[8];       // The CACHE_MAGIC identifier
+  uint64_t mtimeSec;   // The modification time of the image (seconds)
+  uint64_t mtimeNsec;  // The modification time of the image (nanoseconds)
+  uint64_t size;       // The size of the image file
+  uint64_t width;      // The width of the image
+  uint64_t height;     // The height of the image
+  uint64_t channels;   // The amount of channels of the values
+  uint64_t layout;     // The image_layout_t of the values
+  uint64_t pathLength; // The length of the filepath that follows the header
+  uint64_t offset;     // The offset of the values from the start of the file
+} CacheHeader;
+
+/*
+ * Hash a string with 64-bit FNV-1a
+ */
+static uint64_t string_hash(const char* string)
+{
+  uint64_t hash = 0xcbf29ce484222325;
+
+  for(size_t index = 0; string[index] != '\0'; index++)
+  {
+    hash ^= (uint8_t) string[index];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+/*
+ * Create the header that a valid cache of an image must have
+ */
+static void cache_header_create(CacheHeader* header, const struct stat* status, size_t channels, image_layout_t layout, const char* realpath)
+{
+  memset(header, 0, sizeof(CacheHeader));
+
+  memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+
+  header->mtimeSec = status->st_mtim.tv_sec;
+  header->mtimeNsec = status->st_mtim.tv_nsec;
+  header->size = status->st_size;
+
+  header->channels = channels;
+  header->layout = layout;
+  header->pathLength = strlen(realpath);
+
+  size_t unaligned = sizeof(CacheHeader) + header->pathLength;
+
+  header->offset = ((unaligned + CACHE_ALIGN - 1) / CACHE_ALIGN) * CACHE_ALIGN;
+}
+
+/*
+ * Map a cache file, if it is a valid cache of the image
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The cache file does not exist
+ * - 2 | The cache file is not valid (stale or of another image)
+ */
+static int image_cache_map(ImageCache* cache, const char* cachepath, const CacheHeader* expected, const char* realpath)
+{
+  int file = open(cachepath, O_RDONLY);
+
+  if(file == -1) return 1;
+
+  struct stat status;
+
+  CacheHeader header;
+
+  if(fstat(file, &status) == -1 || pread(file, &header, sizeof(header), 0) != sizeof(header))
+  {
+    close(file);
+
+    return 2;
+  }
+
+  bool valid = !memcmp(header.magic, expected->magic, sizeof(header.magic)) &&
+    header.mtimeSec == expected->mtimeSec && header.mtimeNsec == expected->mtimeNsec &&
+    header.size == expected->size && header.channels == expected->channels &&
+    header.layout == expected->layout && header.pathLength == expected->pathLength &&
+    header.offset == expected->offset &&
+    (uint64_t) status.st_size == header.offset + (header.width * header.height * header.channels * sizeof(float));
+
+  if(!valid)
+  {
+    close(file);
+
+    return 2;
+  }
+
+  void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+  close(file);
+
+  if(mapping == MAP_FAILED) return 2;
+
+  // The filepath is compared as well, in case two filepaths have the same hash
+  if(memcmp((char*) mapping + sizeof(CacheHeader), realpath, header.pathLength))
+  {
+    munmap(mapping, status.st_size);
+
+    return 2;
+  }
+
+  cache->mapping = mapping;
+  cache->size = status.st_size;
+
+  cache->values = (float*) ((char*) mapping + header.offset);
+
+  cache->width = header.width;
+  cache->height = header.height;
+  cache->channels = header.channels;
+  cache->layout = header.layout;
+
+  return 0; // Success!
+}
+
+/*
+ * Write a cache file atomically, by writing a temporary file and renaming it
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to write the cache file
+ */
+static int image_cache_write(const char* cachepath, const CacheHeader* header, const char* realpath, const float* values)
+{
+  char temppath[PATH_MAX];
+
+  snprintf(temppath, sizeof(temppath), "%s.%d.tmp", cachepath, (int) getpid());
+
+  FILE* file = fopen(temppath, "wb");
+
+  if(file == NULL) return 1;
+
+  char padding[CACHE_ALIGN] = {0};
+
+  size_t length = (header->width * header->height * header->channels);
+
+  size_t paddingSize = header->offset - sizeof(CacheHeader) - header->pathLength;
+
+  bool written = fwrite(header, sizeof(CacheHeader), 1, file) == 1 &&
+    fwrite(realpath, 1, header->pathLength, file) == header->pathLength &&
+    fwrite(padding, 1, paddingSize, file) == paddingSize &&
+    fwrite(values, sizeof(float), length, file) == length;
+
+  if(fclose(file) != 0) written = false;
+
+  if(!written || rename(temppath, cachepath) == -1)
+  {
+    unlink(temppath);
+
+    return 1;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Read the values of an image from a cache, and decode and cache the image if the cache is stale
+ *
+ * The cache is keyed by the real filepath, modification time and size of the image,
+ * and a valid cache is mapped into memory with mmap, instead of being read
+ *
+ * PARAMS
+ * - ImageCache* cache     | The pointer to the ImageCache struct
+ * - const char* filepath  | The filepath of the image
+ * - size_t channels       | The amount of channels (1 grey, 2 grey alpha, 3 RGB, 4 RGBA)
+ * - image_layout_t layout | How the channels of the values should be ordered
+ * - const char* cachedir  | The directory of the cache files, which is created if it does not exist
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to find the image
+ * - 3 | Failed to read the image
+ */
+int image_cache_read(ImageCache* cache, const char* filepath, size_t channels, image_layout_t layout, const char* cachedir)
+{
+  if(cache == NULL || filepath == NULL || channels < 1 || channels > 4 || cachedir == NULL) return 1;
+
+  memset(cache, 0, sizeof(ImageCache));
+
+  char imagepath[PATH_MAX];
+
+  struct stat status;
+
+  if(realpath(filepath, imagepath) == NULL || stat(imagepath, &status) == -1)
+  {
+    error_print("Failed to find image %s: %s", filepath, strerror(errno));
+
+    return 2;
+  }
+
+  CacheHeader header;
+
+  cache_header_create(&header, &status, channels, layout, imagepath);
+
+  char cachepath[PATH_MAX];
+
+  snprintf(cachepath, sizeof(cachepath), "%s/%016lx-%ld%c.cache", cachedir, (unsigned long) string_hash(imagepath), channels, (layout == IMAGE_LAYOUT_PLANAR) ? 'p' : 'i');
+
+  if(image_cache_map(cache, cachepath, &header, imagepath) == 0) return 0; // Success!
+
+  size_t width, height;
+
+  float* values = image_channels_values_read(&width, &height, channels, layout, filepath);
+
+  if(values == NULL) return 3;
+
+  header.width = width;
+  header.height = height;
+
+  mkdir(cachedir, 0755);
+
+  // If the cache could not be written or mapped, the decoded values are used as they are
+  if(image_cache_write(cachepath, &header, imagepath, values) == 0 &&
+     image_cache_map(cache, cachepath, &header, imagepath) == 0)
+  {
+    float_vector_free(&values, width * height * channels);
+
+    return 0; // Success!
+  }
+
+  error_print("Failed to write image cache %s", cachepath);
+
+  cache->values = values;
+
+  cache->width = width;
+  cache->height = height;
+  cache->channels = channels;
+  cache->layout = layout;
+
+  return 0; // Success!
+}
+
+/*
+ * Unmap (or free) the values in the inputted ImageCache struct
+ */
+void image_cache_free(ImageCache* cache)
+{
+  if(cache->mapping != NULL) munmap(cache->mapping, cache->size);
+
+  else float_vector_free(&cache->values, cache->width * cache->height * cache->channels);
+
+  memset(cache, 0, sizeof(ImageCache));
+}
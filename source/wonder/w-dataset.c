@@ -0,0 +1,406 @@
+#include "../wonder.h"
+#include "w-image-intern.h"
+
+#include <dirent.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// This is the signature of the work that is done for every image
+typedef int (*dataset_work_t)(ImageDataset* dataset, size_t index);
+
+typedef struct
+{
+  ImageDataset* dataset; // The dataset that is being read
+  dataset_work_t work;   // The work to do for every image
+  size_t next;           // The index of the next image to claim
+  size_t failed;         // The amount of images that failed
+} DatasetWorkers;
+
+/*
+ * Check if a filename has an extension of an image that can be decoded
+ */
+static bool image_filename_is(const char* filename)
+{
+  const char* extension = strrchr(filename, '.');
+
+  if(extension == NULL) return false;
+
+  const char* extensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif", ".pgm", ".ppm"};
+
+  for(size_t index = 0; index < sizeof(extensions) / sizeof(*extensions); index++)
+  {
+    if(!strcasecmp(extension, extensions[index])) return true;
+  }
+  return false;
+}
+
+/*
+ * Append a copy of a filepath to a growing array of filepaths
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to allocate memory
+ */
+static int dataset_filepath_append(ImageDataset* dataset, size_t* capacity, const char* dirpath, const char* filename)
+{
+  if(dataset->amount >= *capacity)
+  {
+    size_t newCapacity = (*capacity > 0) ? (*capacity * 2) : 64;
+
+    char** filepaths = realloc(dataset->filepaths, sizeof(char*) * newCapacity);
+
+    if(filepaths == NULL) return 1;
+
+    dataset->filepaths = filepaths;
+
+    *capacity = newCapacity;
+  }
+
+  size_t length = strlen(dirpath) + 1 + strlen(filename) + 1;
+
+  char* filepath = malloc(sizeof(char) * length);
+
+  if(filepath == NULL) return 1;
+
+  // Absolute paths and paths without a directory are kept as they are
+  if(filename[0] == '/' || dirpath[0] == '\0') strcpy(filepath, filename);
+
+  else snprintf(filepath, length, "%s/%s", dirpath, filename);
+
+  dataset->filepaths[dataset->amount++] = filepath;
+
+  return 0; // Success!
+}
+
+static int filepath_compare(const void* filepath1, const void* filepath2)
+{
+  return strcmp(*(char* const*) filepath1, *(char* const*) filepath2);
+}
+
+/*
+ * Collect the images in a directory, sorted by name
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to open the directory
+ * - 2 | Failed to allocate memory
+ */
+static int dataset_directory_filepaths_read(ImageDataset* dataset, const char* dirpath)
+{
+  DIR* directory = opendir(dirpath);
+
+  if(directory == NULL)
+  {
+    error_print("opendir: %s", strerror(errno));
+
+    return 1;
+  }
+
+  size_t capacity = 0;
+
+  struct dirent* entry;
+
+  while((entry = readdir(directory)) != NULL)
+  {
+    if(!image_filename_is(entry->d_name)) continue;
+
+    if(dataset_filepath_append(dataset, &capacity, dirpath, entry->d_name) != 0)
+    {
+      closedir(directory);
+
+      return 2;
+    }
+  }
+  closedir(directory);
+
+  // The order of readdir is not defined, so the images are sorted to be reproducible
+  qsort(dataset->filepaths, dataset->amount, sizeof(char*), filepath_compare);
+
+  return 0; // Success!
+}
+
+/*
+ * Collect the images listed in a manifest, one filepath per line
+ *
+ * Relative filepaths are relative to the directory of the manifest,
+ * and empty lines and lines starting with # are skipped
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to open the manifest
+ * - 2 | Failed to allocate memory
+ */
+static int dataset_manifest_filepaths_read(ImageDataset* dataset, const char* manifest)
+{
+  FILE* file = fopen(manifest, "r");
+
+  if(file == NULL)
+  {
+    error_print("fopen: %s", strerror(errno));
+
+    return 1;
+  }
+
+  char dirpath[strlen(manifest) + 1];
+  strcpy(dirpath, manifest);
+
+  char* slash = strrchr(dirpath, '/');
+
+  if(slash != NULL) *slash = '\0';
+
+  else dirpath[0] = '\0';
+
+  size_t capacity = 0;
+
+  char line[4096];
+
+  while(fgets(line, sizeof(line), file) != NULL)
+  {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if(line[0] == '\0' || line[0] == '#') continue;
+
+    if(dataset_filepath_append(dataset, &capacity, dirpath, line) != 0)
+    {
+      fclose(file);
+
+      return 2;
+    }
+  }
+  fclose(file);
+
+  return 0; // Success!
+}
+
+/*
+ * Read the size of an image from its header, without decoding it
+ */
+static int dataset_image_info(ImageDataset* dataset, size_t index)
+{
+  int width, height, comp;
+
+  if(!stbi_info(dataset->filepaths[index], &width, &height, &comp))
+  {
+    error_print("stbi_info: %s: %s", dataset->filepaths[index], stbi_failure_reason());
+
+    return 1;
+  }
+  dataset->widths[index] = width;
+  dataset->heights[index] = height;
+
+  return 0; // Success!
+}
+
+/*
+ * Decode an image straight into its place in the values of the dataset
+ */
+static int dataset_image_decode(ImageDataset* dataset, size_t index)
+{
+  int width, height, comp;
+
+  uint8_t* pixels = stbi_load(dataset->filepaths[index], &width, &height, &comp, dataset->channels);
+
+  if(pixels == NULL)
+  {
+    error_print("stbi_load: %s: %s", dataset->filepaths[index], stbi_failure_reason());
+
+    return 1;
+  }
+
+  int status = 0;
+
+  // If the image changed since its header was read, it no longer fits in its place
+  if((size_t) width != dataset->widths[index] || (size_t) height != dataset->heights[index])
+  {
+    error_print("Image changed while reading: %s", dataset->filepaths[index]);
+
+    status = 2;
+  }
+  else image_pixels_layout_values_convert(dataset->values + dataset->offsets[index], pixels, width, height, dataset->channels, dataset->layout);
+
+  stbi_image_free(pixels);
+
+  return status;
+}
+
+/*
+ * The routine of a worker thread, that claims images until there are no more
+ */
+static void* dataset_worker_routine(void* data)
+{
+  DatasetWorkers* workers = data;
+
+  size_t index;
+
+  while((index = __atomic_fetch_add(&workers->next, 1, __ATOMIC_RELAXED)) < workers->dataset->amount)
+  {
+    trace_begin("loader", "image", "index", index);
+
+    if(workers->work(workers->dataset, index) != 0)
+    {
+      __atomic_fetch_add(&workers->failed, 1, __ATOMIC_RELAXED);
+    }
+    trace_end("loader", "image");
+  }
+  return NULL;
+}
+
+/*
+ * The routine of a started worker thread, which is named in the trace
+ */
+static void* dataset_loader_routine(void* data)
+{
+  trace_thread_name("loader");
+
+  return dataset_worker_routine(data);
+}
+
+/*
+ * Do some work for every image in the dataset on multiple threads
+ *
+ * The calling thread is one of the workers
+ *
+ * RETURN (size_t failed)
+ * - The amount of images that the work failed for
+ */
+static size_t dataset_workers_run(ImageDataset* dataset, dataset_work_t work, size_t threads)
+{
+  DatasetWorkers workers = { .dataset = dataset, .work = work, .next = 0, .failed = 0 };
+
+  if(threads > dataset->amount) threads = dataset->amount;
+
+  pthread_t handles[threads];
+  size_t started = 0;
+
+  for(; (started + 1) < threads; started++)
+  {
+    if(pthread_create(&handles[started], NULL, dataset_loader_routine, &workers) != 0) break;
+  }
+  dataset_worker_routine(&workers);
+
+  for(size_t index = 0; index < started; index++)
+  {
+    pthread_join(handles[index], NULL);
+  }
+  return workers.failed;
+}
+
+/*
+ * Read every image of a dataset into one contiguous buffer, decoding them on multiple threads
+ *
+ * First the headers of the images are read, to know where every image is placed,
+ * and then the images are decoded and converted straight into their place
+ *
+ * PARAMS
+ * - ImageDataset* dataset | The pointer to the ImageDataset struct
+ * - const char* path      | A directory of images, or a manifest with one image filepath per line
+ * - size_t channels       | The amount of channels to convert every image to (1 - 4)
+ * - image_layout_t layout | How the channels of every image should be ordered
+ * - size_t threads        | The amount of threads to decode with, or 0 for one per online processor
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to collect the images
+ * - 3 | Failed to allocate memory
+ * - 4 | Failed to read an image
+ */
+int image_dataset_read(ImageDataset* dataset, const char* path, size_t channels, image_layout_t layout, size_t threads)
+{
+  if(dataset == NULL || path == NULL || channels < 1 || channels > 4) return 1;
+
+  memset(dataset, 0, sizeof(ImageDataset));
+
+  dataset->channels = channels;
+  dataset->layout = layout;
+
+  struct stat status;
+
+  if(stat(path, &status) == -1)
+  {
+    error_print("stat: %s", strerror(errno));
+
+    return 2;
+  }
+
+  int collectStatus = S_ISDIR(status.st_mode) ? dataset_directory_filepaths_read(dataset, path) : dataset_manifest_filepaths_read(dataset, path);
+
+  if(collectStatus != 0)
+  {
+    image_dataset_free(dataset);
+
+    return 2;
+  }
+
+  if(dataset->amount == 0) return 0; // Success!
+
+  if(threads == 0)
+  {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    threads = (processors > 0) ? processors : 1;
+  }
+
+  dataset->widths = malloc(sizeof(size_t) * dataset->amount);
+  dataset->heights = malloc(sizeof(size_t) * dataset->amount);
+  dataset->offsets = malloc(sizeof(size_t) * dataset->amount);
+
+  if(dataset->widths == NULL || dataset->heights == NULL || dataset->offsets == NULL)
+  {
+    image_dataset_free(dataset);
+
+    return 3;
+  }
+
+  if(dataset_workers_run(dataset, dataset_image_info, threads) != 0)
+  {
+    image_dataset_free(dataset);
+
+    return 4;
+  }
+
+  for(size_t index = 0; index < dataset->amount; index++)
+  {
+    dataset->offsets[index] = dataset->length;
+
+    dataset->length += (dataset->widths[index] * dataset->heights[index] * channels);
+  }
+
+  dataset->values = malloc(sizeof(float) * dataset->length);
+
+  if(dataset->values == NULL)
+  {
+    image_dataset_free(dataset);
+
+    return 3;
+  }
+
+  if(dataset_workers_run(dataset, dataset_image_decode, threads) != 0)
+  {
+    image_dataset_free(dataset);
+
+    return 4;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Free the allocated memory in the inputted ImageDataset struct
+ */
+void image_dataset_free(ImageDataset* dataset)
+{
+  for(size_t index = 0; index < dataset->amount; index++)
+  {
+    free(dataset->filepaths[index]);
+  }
+  free(dataset->filepaths);
+
+  free(dataset->widths);
+  free(dataset->heights);
+  free(dataset->offsets);
+
+  free(dataset->values);
+
+  memset(dataset, 0, sizeof(ImageDataset));
+}
@@ -0,0 +1,6 @@
+#ifndef W_IMAGE_INTERN_H
+#define W_IMAGE_INTERN_H
+
+extern float* image_pixels_layout_values_convert(float* values, const uint8_t* pixels, size_t width, size_t height, size_t channels, image_layout_t layout);
+
+#endif // W_IMAGE_INTERN_H
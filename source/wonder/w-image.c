@@ -1,11 +1,150 @@
 #include "../wonder.h"
+#include "w-image-intern.h"
 
-static int image_pixels_write(const char* filepath, const uint8_t* pixels, size_t width, size_t height)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * Convert 8-bit pixels to float values between 0 and 1
+ *
+ * Note: The values are divided by 255, the same way as the scalar conversion,
+ * so the SSE2 and the scalar parts give exactly the same values
+ *
+ * RETURN (float* values)
+ * - SUCCESS | float* values
+ * - ERROR   | NULL
+ */
+float* image_pixels_values_convert(float* values, const uint8_t* pixels, size_t length)
 {
-  if(!stbi_write_png(filepath, width, height, 1, pixels, width * sizeof(uint8_t)))
+  if(values == NULL || pixels == NULL) return NULL;
+
+  size_t index = 0;
+
+#ifdef __SSE2__
+  const __m128 divisor = _mm_set1_ps(255.0f);
+  const __m128i zero = _mm_setzero_si128();
+
+  // 16 pixels are widened from 8 bits to 16 bits to 32 bits every iteration
+  for(; (index + 16) <= length; index += 16)
+  {
+    __m128i bytes = _mm_loadu_si128((const __m128i*) (pixels + index));
+
+    __m128i lowShorts = _mm_unpacklo_epi8(bytes, zero);
+    __m128i highShorts = _mm_unpackhi_epi8(bytes, zero);
+
+    __m128 value0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lowShorts, zero));
+    __m128 value1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lowShorts, zero));
+    __m128 value2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(highShorts, zero));
+    __m128 value3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(highShorts, zero));
+
+    _mm_storeu_ps(values + index + 0, _mm_div_ps(value0, divisor));
+    _mm_storeu_ps(values + index + 4, _mm_div_ps(value1, divisor));
+    _mm_storeu_ps(values + index + 8, _mm_div_ps(value2, divisor));
+    _mm_storeu_ps(values + index + 12, _mm_div_ps(value3, divisor));
+  }
+#endif
+
+  for(; index < length; index++)
+  {
+    values[index] = (float) pixels[index] / 255.0f;
+  }
+  return values;
+}
+
+/*
+ * Convert float values between 0 and 1 to 8-bit pixels
+ *
+ * Note: The values are truncated and values outside of 0 and 1 are clamped
+ *
+ * RETURN (uint8_t* pixels)
+ * - SUCCESS | uint8_t* pixels
+ * - ERROR   | NULL
+ */
+uint8_t* image_values_pixels_convert(uint8_t* pixels, const float* values, size_t length)
+{
+  if(pixels == NULL || values == NULL) return NULL;
+
+  size_t index = 0;
+
+#ifdef __SSE2__
+  const __m128 scalor = _mm_set1_ps(255.0f);
+  const __m128 zeros = _mm_setzero_ps();
+
+  // The values are clamped before the conversion, because it turns +Inf and huge values into INT_MIN,
+  // max returns its second operand for NaN, so NaN becomes 0 like in the scalar part
+#define VALUES_CLAMPED_LOAD(offset) _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(values + index + (offset)), scalor), zeros), scalor)
+
+  // 16 values are narrowed from 32 bits to 16 bits to 8 bits (with saturation) every iteration
+  for(; (index + 16) <= length; index += 16)
+  {
+    __m128i int0 = _mm_cvttps_epi32(VALUES_CLAMPED_LOAD(0));
+    __m128i int1 = _mm_cvttps_epi32(VALUES_CLAMPED_LOAD(4));
+    __m128i int2 = _mm_cvttps_epi32(VALUES_CLAMPED_LOAD(8));
+    __m128i int3 = _mm_cvttps_epi32(VALUES_CLAMPED_LOAD(12));
+
+    __m128i lowShorts = _mm_packs_epi32(int0, int1);
+    __m128i highShorts = _mm_packs_epi32(int2, int3);
+
+    _mm_storeu_si128((__m128i*) (pixels + index), _mm_packus_epi16(lowShorts, highShorts));
+  }
+#undef VALUES_CLAMPED_LOAD
+#endif
+
+  for(; index < length; index++)
+  {
+    float value = values[index] * 255.0f;
+
+    // The negated comparison also turns NaN into 0, like the SSE2 part
+    if(!(value > 0.0f)) pixels[index] = 0;
+
+    else if(value >= 255.0f) pixels[index] = 255;
+
+    else pixels[index] = (uint8_t) value;
+  }
+  return pixels;
+}
+
+/*
+ * Convert interleaved 8-bit pixels with multiple channels to float values in a layout
+ *
+ * RETURN (float* values)
+ * - SUCCESS | float* values
+ * - ERROR   | NULL
+ */
+float* image_pixels_layout_values_convert(float* values, const uint8_t* pixels, size_t width, size_t height, size_t channels, image_layout_t layout)
+{
+  if(values == NULL || pixels == NULL) return NULL;
+
+  if(layout != IMAGE_LAYOUT_PLANAR) return image_pixels_values_convert(values, pixels, width * height * channels);
+
+  size_t length = (width * height);
+
+  uint8_t rowPixels[width];
+
+  // Every row of every plane is gathered and then converted at once
+  for(size_t yValue = 0; yValue < height; yValue++)
+  {
+    for(size_t channel = 0; channel < channels; channel++)
+    {
+      const uint8_t* rowStart = pixels + (yValue * width * channels) + channel;
+
+      for(size_t xValue = 0; xValue < width; xValue++)
+      {
+        rowPixels[xValue] = rowStart[xValue * channels];
+      }
+      image_pixels_values_convert(values + (channel * length) + (yValue * width), rowPixels, width);
+    }
+  }
+  return values;
+}
+
+static int image_pixels_write(const char* filepath, const uint8_t* pixels, size_t width, size_t height, size_t channels)
+{
+  if(!stbi_write_png(filepath, width, height, channels, pixels, width * channels * sizeof(uint8_t)))
   {
     error_print("stbi_write_png\n");
-  
+
     return 1;
   }
   return 0; // Success!
@@ -15,21 +154,83 @@ int image_values_write(const char* filepath, const float* values, size_t width,
 {
   uint8_t pixels[width * height];
 
-  for(size_t index = 0; index < (width * height); index++)
+  image_values_pixels_convert(pixels, values, width * height);
+
+  int status = image_pixels_write(filepath, pixels, width, height, 1);
+
+  return (status == 0) ? 0 : 1;
+}
+
+/*
+ * Write float values with multiple channels to a PNG image
+ *
+ * PARAMS
+ * - const char* filepath  | The path of the image
+ * - const float* values   | The values between 0 and 1
+ *   Size: width x height x channels
+ * - size_t channels       | The amount of channels (1 grey, 2 grey alpha, 3 RGB, 4 RGBA)
+ * - image_layout_t layout | How the channels of the values are ordered
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to allocate the pixels
+ * - 3 | Failed to write the image
+ */
+int image_channels_values_write(const char* filepath, const float* values, size_t width, size_t height, size_t channels, image_layout_t layout)
+{
+  if(filepath == NULL || values == NULL || channels < 1 || channels > 4) return 1;
+
+  size_t length = (width * height);
+
+  uint8_t* pixels = malloc(sizeof(uint8_t) * length * channels);
+
+  if(pixels == NULL) return 2;
+
+  if(layout == IMAGE_LAYOUT_PLANAR)
   {
-    pixels[index] = (uint8_t) (values[index] * 255); 
+    uint8_t rowPixels[width];
+
+    // Every row of every plane is converted at once and then interleaved
+    for(size_t yValue = 0; yValue < height; yValue++)
+    {
+      for(size_t channel = 0; channel < channels; channel++)
+      {
+        image_values_pixels_convert(rowPixels, values + (channel * length) + (yValue * width), width);
+
+        uint8_t* rowStart = pixels + (yValue * width * channels) + channel;
+
+        for(size_t xValue = 0; xValue < width; xValue++)
+        {
+          rowStart[xValue * channels] = rowPixels[xValue];
+        }
+      }
+    }
   }
+  else image_values_pixels_convert(pixels, values, length * channels);
 
-  int status = image_pixels_write(filepath, pixels, width, height);
+  int status = image_pixels_write(filepath, pixels, width, height, channels);
 
-  return (status == 0) ? 0 : 1;
+  free(pixels);
+
+  return (status == 0) ? 0 : 3;
 }
 
-static uint8_t* image_pixels_read(size_t* width, size_t* height, const char* filepath)
+/*
+ * Read the 8-bit pixels of an image
+ *
+ * PARAMS
+ * - size_t channels | The amount of channels to convert the image to, or 0 to keep the image's own
+ *
+ * RETURN (uint8_t* pixels)
+ * - SUCCESS | The pixels, free them with free
+ * - ERROR   | NULL
+ */
+static uint8_t* image_pixels_read(size_t* width, size_t* height, size_t* channels, const char* filepath)
 {
   int twidth, theight, tcomp;
 
-  uint8_t* pixels = (uint8_t*) stbi_load(filepath, &twidth, &theight, &tcomp, 0);
+  uint8_t* pixels = (uint8_t*) stbi_load(filepath, &twidth, &theight, &tcomp, *channels);
 
   if(pixels == NULL)
   {
@@ -38,7 +239,26 @@ static uint8_t* image_pixels_read(size_t* width, size_t* height, const char* fil
     return NULL;
   }
 
-  if(tcomp != 1)
+  *width = twidth;
+  *height = theight;
+
+  if(*channels == 0) *channels = tcomp;
+
+  return pixels;
+}
+
+/*
+ * Read the 8-bit pixels of a grey image
+ */
+static uint8_t* image_grey_pixels_read(size_t* width, size_t* height, const char* filepath)
+{
+  size_t channels = 0;
+
+  uint8_t* pixels = image_pixels_read(width, height, &channels, filepath);
+
+  if(pixels == NULL) return NULL;
+
+  if(channels != 1)
   {
     free(pixels);
 
@@ -46,52 +266,106 @@ static uint8_t* image_pixels_read(size_t* width, size_t* height, const char* fil
 
     return NULL;
   }
-
-  *width = twidth;
-  *height = theight;
-
   return pixels;
 }
 
 float* image_values_read(size_t* width, size_t* height, const char* filepath)
 {
-  uint8_t* pixels = image_pixels_read(width, height, filepath);
+  uint8_t* pixels = image_grey_pixels_read(width, height, filepath);
 
   if(pixels == NULL) return NULL;
-  
+
   size_t length = (*width * *height);
 
   float* values = float_vector_create(length);
 
-  for(size_t index = 0; index < length; index++)
+  image_pixels_values_convert(values, pixels, length);
+
+  free(pixels);
+
+  return values;
+}
+
+/*
+ * Read an image as float values with multiple channels
+ *
+ * The image is converted to the requested amount of channels,
+ * for example a grey image can be read as RGB
+ *
+ * PARAMS
+ * - size_t channels       | The amount of channels (1 grey, 2 grey alpha, 3 RGB, 4 RGBA)
+ * - image_layout_t layout | How the channels of the values should be ordered
+ *
+ * RETURN (float* values)
+ * - SUCCESS | The values between 0 and 1, free them with float_vector_free
+ *   Size: width x height x channels
+ * - ERROR   | NULL
+ */
+float* image_channels_values_read(size_t* width, size_t* height, size_t channels, image_layout_t layout, const char* filepath)
+{
+  if(width == NULL || height == NULL || channels < 1 || channels > 4 || filepath == NULL) return NULL;
+
+  uint8_t* pixels = image_pixels_read(width, height, &channels, filepath);
+
+  if(pixels == NULL) return NULL;
+
+  size_t length = (*width * *height);
+
+  float* values = float_vector_create(length * channels);
+
+  if(values == NULL)
   {
-    values[index] = (float) pixels[index] / 255.f;
+    free(pixels);
+
+    return NULL;
   }
+
+  image_pixels_layout_values_convert(values, pixels, *width, *height, channels, layout);
+
   free(pixels);
 
   return values;
 }
 
-float** image_values_matrix_read(size_t* width, size_t* height, const char* filepath)
+/*
+ * Create a matrix of the normalized x and y values and the value of every pixel of a grey image
+ *
+ * RETURN (float** matrix)
+ * - SUCCESS | The matrix, free it with float_matrix_free
+ *   Size: (width x height) x 3
+ * - ERROR   | NULL
+ */
+float** image_values_matrix_create(const float* values, size_t width, size_t height)
 {
-  uint8_t* pixels = image_pixels_read(width, height, filepath);
+  if(values == NULL || width <= 1 || height <= 1) return NULL;
 
-  if(pixels == NULL) return NULL;
-  
-  float** matrix = float_matrix_create(*width * *height, 3);
+  float** matrix = float_matrix_create(width * height, 3);
 
-  for(size_t yValue = 0; yValue < *height; yValue++)
+  if(matrix == NULL) return NULL;
+
+  for(size_t yValue = 0; yValue < height; yValue++)
   {
-    for(size_t xValue = 0; xValue < *width; xValue++)
+    for(size_t xValue = 0; xValue < width; xValue++)
     {
-      size_t index = (yValue * *width + xValue);
+      size_t index = (yValue * width + xValue);
 
-      matrix[index][0] = (float) xValue / (*width - 1);
-      matrix[index][1] = (float) yValue / (*height - 1);
-      matrix[index][2] = (float) pixels[index] / 255.0f;
+      matrix[index][0] = (float) xValue / (width - 1);
+      matrix[index][1] = (float) yValue / (height - 1);
+      matrix[index][2] = values[index];
     }
   }
-  free(pixels);
+  return matrix;
+}
+
+float** image_values_matrix_read(size_t* width, size_t* height, const char* filepath)
+{
+  float* values = image_values_read(width, height, filepath);
+
+  if(values == NULL) return NULL;
+
+  float** matrix = image_values_matrix_create(values, *width, *height);
+
+  float_vector_free(&values, *width * *height);
 
   return matrix;
 }
@@ -0,0 +1,168 @@
+#include "../wonder.h"
+
+/*
+ * Render the outputs of a network over the unit square to image values
+ *
+ * The inputs of the network are the normalized x and y values of each pixel,
+ * and the first output of the network is the value of the pixel
+ *
+ * PARAMS
+ * - float* values   | The rendered values
+ *   Size: width x height
+ * - Network network | The network to render
+ * - size_t width    | The width of the image
+ * - size_t height   | The height of the image
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int image_network_values_render(float* values, Network network, size_t width, size_t height)
+{
+  if(values == NULL || width <= 1 || height <= 1) return 1;
+
+  size_t outputAmount = network.layers[network.amount - 1].amount;
+
+  float outputs[outputAmount];
+
+  for(size_t yValue = 0; yValue < height; yValue++)
+  {
+    for(size_t xValue = 0; xValue < width; xValue++)
+    {
+      float normX = (float) xValue / (width - 1);
+      float normY = (float) yValue / (height - 1);
+
+      float inputs[2] = {normX, normY};
+
+      network_forward(outputs, network, inputs);
+
+      values[yValue * width + xValue] = outputs[0];
+    }
+  }
+  return 0; // Success!
+}
+
+/*
+ * The routine of the background thread that renders and writes one frame
+ */
+static void* preview_render_routine(void* data)
+{
+  Preview* preview = data;
+
+  trace_thread_name("preview");
+
+  trace_begin("preview", "render", "frame", preview->frame);
+
+  image_network_values_render(preview->values, preview->network, preview->width, preview->height);
+
+  char filepath[256];
+  snprintf(filepath, sizeof(filepath), preview->format, preview->frame);
+
+  if(image_values_write(filepath, preview->values, preview->width, preview->height) != 0)
+  {
+    error_print("Failed to write preview frame %s", filepath);
+  }
+
+  trace_end("preview", "render");
+
+  // Release the snapshot, so the next frame can be started
+  __atomic_store_n(&preview->busy, false, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+/*
+ * Initialize a Preview struct that renders frames of a network while it is training
+ *
+ * PARAMS
+ * - Preview* preview   | The pointer to the Preview struct
+ * - Network network    | The network that is going to be trained
+ * - size_t width       | The width of the frames
+ * - size_t height      | The height of the frames
+ * - size_t interval    | The amount of epochs between every frame
+ * - const char* format | The path format of the frames, with a %ld for the frame number
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to create the snapshot of the network
+ */
+int preview_init(Preview* preview, Network network, size_t width, size_t height, size_t interval, const char* format)
+{
+  if(preview == NULL || width <= 1 || height <= 1 || interval <= 0 || format == NULL) return 1;
+
+  if(network_clone(&preview->network, network) != 0) return 2;
+
+  preview->values = float_vector_create(width * height);
+
+  preview->width = width;
+  preview->height = height;
+  preview->interval = interval;
+  preview->format = format;
+
+  preview->frame = 0;
+  preview->started = false;
+  preview->busy = false;
+
+  preview->observer = (TrainObserver) { .step = NULL, .epoch = preview_epoch_observe, .data = preview };
+
+  return 0; // Success!
+}
+
+/*
+ * Start rendering a frame every interval epochs
+ *
+ * This function is the epoch function of the observer of the preview, add it with train_observer_add(trainer, &preview->observer).
+ * The weights are copied to a snapshot and the frame is rendered on a background thread.
+ * If the last frame is still being rendered, this frame is skipped instead of stalling the training.
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to start the render thread
+ */
+int preview_epoch_observe(const Network* network, const TrainMetrics* metrics, void* data)
+{
+  Preview* preview = data;
+
+  if(network == NULL || metrics == NULL || preview == NULL) return 1;
+
+  if(metrics->epoch % preview->interval != 0) return 0;
+
+  if(__atomic_load_n(&preview->busy, __ATOMIC_ACQUIRE)) return 0;
+
+  // The last render thread is done, so joining it does not block
+  if(preview->started) pthread_join(preview->thread, NULL);
+
+  preview->started = false;
+
+  network_copy(&preview->network, *network);
+
+  preview->frame++;
+
+  preview->busy = true;
+
+  if(pthread_create(&preview->thread, NULL, preview_render_routine, preview) != 0)
+  {
+    preview->busy = false;
+
+    return 2;
+  }
+  preview->started = true;
+
+  return 0; // Success!
+}
+
+/*
+ * Wait for the last frame to be written and free the allocated memory in the Preview struct
+ */
+void preview_free(Preview* preview)
+{
+  if(preview->started) pthread_join(preview->thread, NULL);
+
+  preview->started = false;
+
+  float_vector_free(&preview->values, preview->width * preview->height);
+
+  network_free(&preview->network);
+}
@@ -0,0 +1,46 @@
+#ifndef W_STREAM_INTERN_H
+#define W_STREAM_INTERN_H
+
+#include <zlib.h>
+
+// This are the ways an image stream decodes its rows
+// - PNM: Binary pgm and ppm, read a row at a time
+// - PNG: Non-interlaced png of 8 or 16 bits, inflated a row at a time
+// - STB: Every other image, decoded whole by stb_image
+typedef enum { STREAM_PNM, STREAM_PNG, STREAM_STB } stream_kind_t;
+
+typedef struct
+{
+  stream_kind_t kind;       // How the rows are decoded
+  FILE* file;               // The image file (only PNM and PNG)
+  size_t width;             // The width of the image
+  size_t height;            // The height of the image
+  size_t comp;              // The amount of channels of the image
+  size_t channels;          // The amount of channels of the decoded rows
+  size_t row;               // The next row to decode
+  size_t fileChannels;      // The amount of samples of every pixel in the file
+  size_t sampleBytes;       // The bytes of every sample in the file (1 or 2)
+  size_t rowBytes;          // The bytes of every row in the file, without the png filter byte
+  size_t maxval;            // The largest sample value (only PNM)
+  uint8_t* current;         // The current row of the file (with the png filter byte first)
+  uint8_t* previous;        // The previous unfiltered row (only PNG)
+  uint16_t* samples;        // The samples of the current row, with comp channels
+  int colorType;            // The color type (only PNG)
+  uint8_t palette[256][4];  // The RGBA colors of the palette (only PNG color type 3)
+  bool keyed;               // If a color is transparent (only PNG color type 0 and 2)
+  uint16_t key[3];          // The samples of the transparent color
+  z_stream zstream;         // The inflate state of the image data (only PNG)
+  bool inflating;           // If the inflate state is initialized
+  uint32_t chunkLeft;       // The bytes that are left of the current image data chunk
+  uint8_t* input;           // The compressed bytes that are read from the file (only PNG)
+  const char* filepath;     // The filepath of the image (only STB)
+  uint8_t* pixels;          // The whole decoded image (only STB, decoded by the first read)
+} ImageStream;
+
+extern int image_stream_open(ImageStream* stream, const char* filepath, size_t channels);
+
+extern int image_stream_rows_read(ImageStream* stream, uint8_t* pixels, size_t amount);
+
+extern void image_stream_close(ImageStream* stream);
+
+#endif // W_STREAM_INTERN_H
@@ -0,0 +1,619 @@
+#include "../wonder.h"
+#include "w-stream-intern.h"
+
+#include <limits.h>
+
+// The amount of compressed bytes that are read from the file at a time
+#define STREAM_INPUT_SIZE (1 << 16)
+
+// The largest width and height of a streamed image
+#define STREAM_MAX_SIZE ((size_t) 1 << 31)
+
+static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+/*
+ * Read a big endian 32-bit value
+ */
+static uint32_t bytes_uint32_read(const uint8_t* bytes)
+{
+  return ((uint32_t) bytes[0] << 24) | ((uint32_t) bytes[1] << 16) | ((uint32_t) bytes[2] << 8) | bytes[3];
+}
+
+/*
+ * Convert samples with one amount of channels to 8-bit pixels with another, like stb_image converts them
+ *
+ * The grey value of a color is weighted like stb_image does it, before the samples
+ * of 16 bits are cut to 8 bits, and a missing alpha is the largest value
+ *
+ * PARAMS
+ * - size_t shift | The amount of bits to cut off every sample (8 for samples of 16 bits)
+ */
+static void samples_channels_convert(uint8_t* result, size_t channels, const uint16_t* samples, size_t comp, size_t amount, size_t shift)
+{
+  for(size_t index = 0; index < amount; index++)
+  {
+    const uint16_t* sample = samples + (index * comp);
+
+    uint8_t* target = result + (index * channels);
+
+    bool color = (comp >= 3);
+
+    unsigned int red = sample[0];
+    unsigned int green = color ? sample[1] : sample[0];
+    unsigned int blue = color ? sample[2] : sample[0];
+
+    unsigned int alpha = (comp == 2 || comp == 4) ? sample[comp - 1] : (0xffff >> (8 - shift));
+
+    if(channels <= 2)
+    {
+      target[0] = (color ? (((red * 77) + (green * 150) + (blue * 29)) >> 8) : red) >> shift;
+
+      if(channels == 2) target[1] = alpha >> shift;
+    }
+    else
+    {
+      target[0] = red >> shift;
+      target[1] = green >> shift;
+      target[2] = blue >> shift;
+
+      if(channels == 4) target[3] = alpha >> shift;
+    }
+  }
+}
+
+/*
+ * Read a number of a netpbm header, after whitespace and comments
+ *
+ * RETURN (size_t number)
+ * - SUCCESS | The number
+ * - ERROR   | 0
+ */
+static size_t pnm_number_read(FILE* file)
+{
+  int symbol = fgetc(file);
+
+  while(symbol == '#' || (symbol != EOF && strchr(" \t\r\n", symbol)))
+  {
+    // A comment lasts to the end of the line
+    if(symbol == '#') while(symbol != EOF && symbol != '\n') symbol = fgetc(file);
+
+    symbol = fgetc(file);
+  }
+
+  size_t number = 0;
+
+  for(; symbol >= '0' && symbol <= '9'; symbol = fgetc(file))
+  {
+    if(number > STREAM_MAX_SIZE) return 0;
+
+    number = (number * 10) + (symbol - '0');
+  }
+  // The single whitespace after the number is consumed, which ends the header after the maxval
+  if(symbol == EOF || !strchr(" \t\r\n", symbol)) return 0;
+
+  return number;
+}
+
+/*
+ * Open a binary pgm (P5) or ppm (P6), after its magic number
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The header is not valid
+ */
+static int pnm_stream_open(ImageStream* stream, bool color)
+{
+  stream->width = pnm_number_read(stream->file);
+  stream->height = pnm_number_read(stream->file);
+  stream->maxval = pnm_number_read(stream->file);
+
+  if(stream->width == 0 || stream->height == 0 || stream->maxval == 0 || stream->maxval > 65535) return 1;
+
+  stream->comp = color ? 3 : 1;
+
+  stream->fileChannels = stream->comp;
+  stream->sampleBytes = (stream->maxval > 255) ? 2 : 1;
+  stream->rowBytes = (stream->width * stream->fileChannels * stream->sampleBytes);
+
+  stream->current = malloc(sizeof(uint8_t) * stream->rowBytes);
+
+  return (stream->current != NULL) ? 0 : 1;
+}
+
+/*
+ * Decode the next row of a netpbm image into the samples
+ *
+ * Note: The samples are not scaled by the maxval, like stb_image does not scale them
+ */
+static int pnm_row_decode(ImageStream* stream)
+{
+  if(fread(stream->current, stream->rowBytes, 1, stream->file) != 1) return 1;
+
+  size_t amount = (stream->width * stream->fileChannels);
+
+  for(size_t index = 0; index < amount; index++)
+  {
+    stream->samples[index] = (stream->sampleBytes == 2) ?
+      (((uint16_t) stream->current[index * 2] << 8) | stream->current[index * 2 + 1]) : stream->current[index];
+  }
+  return 0; // Success!
+}
+
+/*
+ * Skip the rest of a png chunk and its CRC
+ */
+static int png_chunk_skip(ImageStream* stream, uint32_t length)
+{
+  return (fseek(stream->file, (long) length + 4, SEEK_CUR) == 0) ? 0 : 1;
+}
+
+/*
+ * Read the header of the next png chunk
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to read the header
+ */
+static int png_chunk_read(ImageStream* stream, uint32_t* length, char type[5])
+{
+  uint8_t header[8];
+
+  if(fread(header, sizeof(header), 1, stream->file) != 1) return 1;
+
+  *length = bytes_uint32_read(header);
+
+  memcpy(type, header + 4, 4);
+
+  type[4] = '\0';
+
+  return 0; // Success!
+}
+
+/*
+ * Open a png, after its signature, up to the first image data chunk
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The png is not valid
+ * - 2 | The png can not be streamed (interlaced or less than 8 bits)
+ */
+static int png_stream_open(ImageStream* stream)
+{
+  uint32_t length;
+  char type[5];
+
+  uint8_t header[13];
+
+  if(png_chunk_read(stream, &length, type) != 0 || strcmp(type, "IHDR") || length != 13) return 1;
+
+  if(fread(header, sizeof(header), 1, stream->file) != 1 || fseek(stream->file, 4, SEEK_CUR) != 0) return 1;
+
+  stream->width = bytes_uint32_read(header);
+  stream->height = bytes_uint32_read(header + 4);
+
+  int depth = header[8];
+
+  stream->colorType = header[9];
+
+  if(stream->width == 0 || stream->height == 0 || stream->width > STREAM_MAX_SIZE || stream->height > STREAM_MAX_SIZE) return 1;
+
+  if(header[10] != 0 || header[11] != 0) return 1;
+
+  const size_t fileChannels[] = {1, 0, 3, 1, 2, 0, 4};
+
+  if(stream->colorType > 6 || fileChannels[stream->colorType] == 0) return 1;
+
+  stream->fileChannels = fileChannels[stream->colorType];
+
+  stream->comp = (stream->colorType == 3) ? 3 : stream->fileChannels;
+
+  // Interlaced images and images of less than 8 bits are decoded by stb_image
+  if(header[12] != 0 || (depth != 8 && depth != 16) || (stream->colorType == 3 && depth != 8)) return 2;
+
+  stream->sampleBytes = (depth / 8);
+  stream->rowBytes = (stream->width * stream->fileChannels * stream->sampleBytes);
+
+  for(size_t index = 0; index < 256; index++)
+  {
+    stream->palette[index][3] = 255;
+  }
+
+  while(png_chunk_read(stream, &length, type) == 0)
+  {
+    if(!strcmp(type, "IDAT"))
+    {
+      stream->chunkLeft = length;
+
+      stream->current = malloc(sizeof(uint8_t) * (stream->rowBytes + 1));
+      stream->previous = calloc(stream->rowBytes, sizeof(uint8_t));
+      stream->input = malloc(sizeof(uint8_t) * STREAM_INPUT_SIZE);
+
+      if(stream->current == NULL || stream->previous == NULL || stream->input == NULL) return 1;
+
+      if(inflateInit(&stream->zstream) != Z_OK) return 1;
+
+      stream->inflating = true;
+
+      return 0; // Success!
+    }
+    else if(!strcmp(type, "PLTE") && length <= (256 * 3) && (length % 3) == 0)
+    {
+      uint8_t colors[256 * 3];
+
+      if(fread(colors, length, 1, stream->file) != 1 || fseek(stream->file, 4, SEEK_CUR) != 0) return 1;
+
+      for(size_t index = 0; index < (length / 3); index++)
+      {
+        memcpy(stream->palette[index], colors + (index * 3), 3);
+      }
+    }
+    else if(!strcmp(type, "tRNS") && length <= 256)
+    {
+      uint8_t alphas[256];
+
+      if(fread(alphas, length, 1, stream->file) != 1 || fseek(stream->file, 4, SEEK_CUR) != 0) return 1;
+
+      // A palette gets the alphas of its colors, a grey or RGB image gets a transparent color
+      if(stream->colorType == 3)
+      {
+        for(size_t index = 0; index < length; index++) stream->palette[index][3] = alphas[index];
+
+        stream->comp = 4;
+      }
+      else if(length == stream->fileChannels * 2 && (stream->colorType == 0 || stream->colorType == 2))
+      {
+        for(size_t index = 0; index < stream->fileChannels; index++)
+        {
+          stream->key[index] = ((uint16_t) alphas[index * 2] << 8) | alphas[index * 2 + 1];
+        }
+        stream->keyed = true;
+
+        stream->comp = (stream->fileChannels + 1);
+      }
+    }
+    else if(!strcmp(type, "IEND")) return 1;
+
+    else if(png_chunk_skip(stream, length) != 0) return 1;
+  }
+  return 1;
+}
+
+/*
+ * Read more compressed bytes, from the current or the next image data chunk
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | There is no more image data
+ */
+static int png_input_read(ImageStream* stream)
+{
+  while(stream->chunkLeft == 0)
+  {
+    uint32_t length;
+    char type[5];
+
+    // The image data can be split over chunks that follow each other
+    if(fseek(stream->file, 4, SEEK_CUR) != 0 || png_chunk_read(stream, &length, type) != 0 || strcmp(type, "IDAT")) return 1;
+
+    stream->chunkLeft = length;
+  }
+  size_t amount = (stream->chunkLeft < STREAM_INPUT_SIZE) ? stream->chunkLeft : STREAM_INPUT_SIZE;
+
+  if(fread(stream->input, amount, 1, stream->file) != 1) return 1;
+
+  stream->chunkLeft -= amount;
+
+  stream->zstream.next_in = stream->input;
+  stream->zstream.avail_in = amount;
+
+  return 0; // Success!
+}
+
+/*
+ * Predict a byte with the paeth filter, from the left, the upper and the upper left byte
+ */
+static uint8_t png_paeth_predict(int left, int upper, int upperLeft)
+{
+  int estimate = left + upper - upperLeft;
+
+  int leftDistance = abs(estimate - left);
+  int upperDistance = abs(estimate - upper);
+  int upperLeftDistance = abs(estimate - upperLeft);
+
+  if(leftDistance <= upperDistance && leftDistance <= upperLeftDistance) return left;
+
+  return (upperDistance <= upperLeftDistance) ? upper : upperLeft;
+}
+
+/*
+ * Inflate and unfilter the next row of a png into the previous row,
+ * which is the row that the next row is filtered against
+ */
+static int png_row_inflate(ImageStream* stream)
+{
+  stream->zstream.next_out = stream->current;
+  stream->zstream.avail_out = (stream->rowBytes + 1);
+
+  while(stream->zstream.avail_out > 0)
+  {
+    if(stream->zstream.avail_in == 0 && png_input_read(stream) != 0) return 1;
+
+    int status = inflate(&stream->zstream, Z_NO_FLUSH);
+
+    if(status == Z_STREAM_END && stream->zstream.avail_out > 0) return 1;
+
+    if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) return 1;
+  }
+
+  int filter = stream->current[0];
+
+  uint8_t* bytes = stream->current + 1;
+  uint8_t* upper = stream->previous;
+
+  size_t pixelBytes = (stream->fileChannels * stream->sampleBytes);
+
+  for(size_t index = 0; index < stream->rowBytes; index++)
+  {
+    int left = (index >= pixelBytes) ? bytes[index - pixelBytes] : 0;
+    int upperLeft = (index >= pixelBytes) ? upper[index - pixelBytes] : 0;
+
+    switch(filter)
+    {
+      case 0: break;
+
+      case 1: bytes[index] += left; break;
+
+      case 2: bytes[index] += upper[index]; break;
+
+      case 3: bytes[index] += (left + upper[index]) / 2; break;
+
+      case 4: bytes[index] += png_paeth_predict(left, upper[index], upperLeft); break;
+
+      default: return 1;
+    }
+  }
+  memcpy(stream->previous, bytes, stream->rowBytes);
+
+  return 0; // Success!
+}
+
+/*
+ * Decode the next row of a png into the samples
+ */
+static int png_row_decode(ImageStream* stream)
+{
+  if(png_row_inflate(stream) != 0) return 1;
+
+  const uint8_t* bytes = stream->previous;
+
+  for(size_t pixel = 0; pixel < stream->width; pixel++)
+  {
+    uint16_t* sample = stream->samples + (pixel * stream->comp);
+
+    if(stream->colorType == 3)
+    {
+      for(size_t channel = 0; channel < stream->comp; channel++) sample[channel] = stream->palette[bytes[pixel]][channel];
+
+      continue;
+    }
+    const uint8_t* source = bytes + (pixel * stream->fileChannels * stream->sampleBytes);
+
+    bool transparent = stream->keyed;
+
+    for(size_t channel = 0; channel < stream->fileChannels; channel++)
+    {
+      const uint8_t* value = source + (channel * stream->sampleBytes);
+
+      sample[channel] = (stream->sampleBytes == 2) ? (((uint16_t) value[0] << 8) | value[1]) : value[0];
+
+      if(stream->keyed && sample[channel] != stream->key[channel]) transparent = false;
+    }
+    if(stream->keyed) sample[stream->fileChannels] = transparent ? 0 : (0xffff >> (16 - 8 * stream->sampleBytes));
+  }
+  return 0; // Success!
+}
+
+/*
+ * Check that an image is within the limits of stb_image, it is decoded whole by the first read
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to read the image
+ * - 2 | The image is too large to decode
+ */
+static int stb_stream_open(ImageStream* stream, const char* filepath)
+{
+  int width, height, comp;
+
+  if(!stbi_info(filepath, &width, &height, &comp))
+  {
+    error_print("stbi_info: %s: %s", filepath, stbi_failure_reason());
+
+    return 1;
+  }
+
+  // stb_image decodes into one buffer, with the channels of the image first, so the larger amount is the limit
+  size_t decodeChannels = ((size_t) comp > stream->channels) ? (size_t) comp : stream->channels;
+
+  if((uint64_t) width * height * decodeChannels > INT_MAX) return 2;
+
+  stream->filepath = filepath;
+
+  stream->width = width;
+  stream->height = height;
+  stream->comp = comp;
+
+  return 0; // Success!
+}
+
+/*
+ * Decode the whole image with stb_image
+ */
+static int stb_stream_decode(ImageStream* stream)
+{
+  int width, height, comp;
+
+  stream->pixels = stbi_load(stream->filepath, &width, &height, &comp, stream->channels);
+
+  if(stream->pixels == NULL)
+  {
+    error_print("stbi_load: %s: %s", stream->filepath, stbi_failure_reason());
+
+    return 1;
+  }
+  return ((size_t) width == stream->width && (size_t) height == stream->height) ? 0 : 1;
+}
+
+/*
+ * Open an image to decode it a band of rows at a time
+ *
+ * Binary pgm and ppm and non-interlaced png of 8 or 16 bits are decoded while the rows are read,
+ * so only a few rows are in memory. The other images are decoded whole by stb_image at the first read,
+ * which rejects images where width * height * channels is larger than INT_MAX, so they are rejected here
+ *
+ * Note: The filepath has to live until the stream is closed
+ *
+ * PARAMS
+ * - ImageStream* stream  | The pointer to the ImageStream struct
+ * - const char* filepath | The filepath of the image
+ * - size_t channels      | The amount of channels of the decoded rows (1 grey, 2 grey alpha, 3 RGB, 4 RGBA)
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to read the image
+ * - 3 | The image can not be streamed, and is too large to decode whole
+ */
+int image_stream_open(ImageStream* stream, const char* filepath, size_t channels)
+{
+  if(stream == NULL || filepath == NULL || channels < 1 || channels > 4) return 1;
+
+  memset(stream, 0, sizeof(ImageStream));
+
+  stream->channels = channels;
+
+  stream->file = fopen(filepath, "rb");
+
+  if(stream->file == NULL)
+  {
+    error_print("fopen: %s: %s", filepath, strerror(errno));
+
+    return 2;
+  }
+
+  uint8_t magic[8] = {0};
+
+  size_t magicLength = fread(magic, 1, sizeof(magic), stream->file);
+
+  int status = 2;
+
+  if(magicLength == sizeof(magic) && !memcmp(magic, pngSignature, sizeof(pngSignature)))
+  {
+    stream->kind = STREAM_PNG;
+
+    status = png_stream_open(stream);
+  }
+  else if(magicLength >= 3 && magic[0] == 'P' && (magic[1] == '5' || magic[1] == '6'))
+  {
+    stream->kind = STREAM_PNM;
+
+    // The header is read again after the magic number
+    status = (fseek(stream->file, 2, SEEK_SET) == 0) ? pnm_stream_open(stream, magic[1] == '6') : 1;
+  }
+
+  // The images that can not be streamed are decoded whole
+  if(status == 2)
+  {
+    image_stream_close(stream);
+
+    stream->channels = channels;
+    stream->kind = STREAM_STB;
+
+    status = stb_stream_open(stream, filepath);
+
+    if(status == 2)
+    {
+      image_stream_close(stream);
+
+      return 3;
+    }
+  }
+
+  if(status == 0 && stream->kind != STREAM_STB)
+  {
+    stream->samples = malloc(sizeof(uint16_t) * stream->width * stream->comp);
+
+    if(stream->samples == NULL) status = 1;
+  }
+
+  if(status != 0)
+  {
+    error_print("Failed to read image %s", filepath);
+
+    image_stream_close(stream);
+
+    return 2;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Decode the next rows of an image, with the channels of the stream
+ *
+ * PARAMS
+ * - uint8_t* pixels | The decoded rows, one row after another
+ *   Size: amount x width x channels
+ * - size_t amount   | The amount of rows
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to decode the rows
+ */
+int image_stream_rows_read(ImageStream* stream, uint8_t* pixels, size_t amount)
+{
+  if(stream == NULL || pixels == NULL || stream->row + amount > stream->height) return 1;
+
+  size_t rowLength = (stream->width * stream->channels);
+
+  for(size_t index = 0; index < amount; index++, stream->row++)
+  {
+    uint8_t* row = pixels + (index * rowLength);
+
+    if(stream->kind == STREAM_STB)
+    {
+      if(stream->pixels == NULL && stb_stream_decode(stream) != 0) return 2;
+
+      memcpy(row, stream->pixels + (stream->row * rowLength), rowLength);
+
+      continue;
+    }
+    int status = (stream->kind == STREAM_PNG) ? png_row_decode(stream) : pnm_row_decode(stream);
+
+    if(status != 0) return 2;
+
+    samples_channels_convert(row, stream->channels, stream->samples, stream->comp, stream->width, 8 * (stream->sampleBytes - 1));
+  }
+  return 0; // Success!
+}
+
+/*
+ * Close an image stream and free its buffers
+ */
+void image_stream_close(ImageStream* stream)
+{
+  if(stream == NULL) return;
+
+  if(stream->inflating) inflateEnd(&stream->zstream);
+
+  if(stream->file != NULL) fclose(stream->file);
+
+  if(stream->pixels != NULL) stbi_image_free(stream->pixels);
+
+  free(stream->current);
+  free(stream->previous);
+  free(stream->samples);
+  free(stream->input);
+
+  memset(stream, 0, sizeof(ImageStream));
+}
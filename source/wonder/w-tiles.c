@@ -0,0 +1,382 @@
+#include "../wonder.h"
+#include "w-stream-intern.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// This is the first bytes of every tile file, change the version if the header changes
+#define TILES_MAGIC "NNTILES1"
+
+// The tiles start at this offset, so that every tile starts on a page
+#define TILES_OFFSET 4096
+
+typedef struct
+{
+  char magic[8];      // The TILES_MAGIC identifier
+  uint64_t mtimeSec;  // The modification time of the image (seconds)
+  uint64_t mtimeNsec; // The modification time of the image (nanoseconds)
+  uint64_t size;      // The size of the image file
+  uint64_t width;     // The width of the image
+  uint64_t height;    // The height of the image
+  uint64_t channels;  // The amount of channels of every pixel
+  uint64_t tileSize;  // The width and height of every tile
+} TilesHeader;
+
+/*
+ * Check if a tile file has been converted from the current version of an image
+ *
+ * The image has to be opened as a stream first, which rejects images that can not be decoded,
+ * so an image that is too large is rejected before any tile file is read or written
+ */
+static bool image_tiles_valid(const char* tilepath, const struct stat* status, const ImageStream* stream, size_t tileSize)
+{
+  FILE* file = fopen(tilepath, "rb");
+
+  if(file == NULL) return false;
+
+  TilesHeader header;
+
+  bool read = (fread(&header, sizeof(header), 1, file) == 1);
+
+  fclose(file);
+
+  return read && !memcmp(header.magic, TILES_MAGIC, sizeof(header.magic)) &&
+    header.mtimeSec == (uint64_t) status->st_mtim.tv_sec &&
+    header.mtimeNsec == (uint64_t) status->st_mtim.tv_nsec &&
+    header.size == (uint64_t) status->st_size &&
+    header.width == stream->width && header.height == stream->height &&
+    header.tileSize == tileSize && header.channels == stream->channels;
+}
+
+/*
+ * Write the pixels of an image tile by tile, padding the tiles at the edges with 0
+ *
+ * The image is decoded one band of tile rows at a time, so only one band is in memory
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | Failed to write the tiles
+ * - 2 | Failed to decode the image
+ */
+static int image_tiles_write(FILE* file, ImageStream* stream, size_t tileSize)
+{
+  size_t width = stream->width;
+  size_t height = stream->height;
+  size_t channels = stream->channels;
+
+  size_t columns = (width + tileSize - 1) / tileSize;
+  size_t rows = (height + tileSize - 1) / tileSize;
+
+  size_t tileRowSize = (tileSize * channels);
+
+  size_t tileLength = (tileSize * tileRowSize);
+
+  uint8_t* tile = malloc(sizeof(uint8_t) * tileLength);
+
+  uint8_t* band = malloc(sizeof(uint8_t) * width * tileSize * channels);
+
+  int status = (tile != NULL && band != NULL) ? 0 : 1;
+
+  for(size_t row = 0; row < rows && status == 0; row++)
+  {
+    size_t startY = (row * tileSize);
+
+    size_t tileHeight = (startY + tileSize <= height) ? tileSize : (height - startY);
+
+    if(image_stream_rows_read(stream, band, tileHeight) != 0)
+    {
+      status = 2;
+
+      break;
+    }
+
+    for(size_t column = 0; column < columns; column++)
+    {
+      memset(tile, 0, tileLength);
+
+      size_t startX = (column * tileSize);
+
+      size_t tileWidth = (startX + tileSize <= width) ? tileSize : (width - startX);
+
+      for(size_t yValue = 0; yValue < tileHeight; yValue++)
+      {
+        const uint8_t* source = band + ((yValue * width + startX) * channels);
+
+        memcpy(tile + (yValue * tileRowSize), source, tileWidth * channels);
+      }
+
+      if(fwrite(tile, tileLength, 1, file) != 1)
+      {
+        status = 1;
+
+        break;
+      }
+    }
+  }
+  free(band);
+
+  free(tile);
+
+  return status;
+}
+
+/*
+ * Convert an image to a file of raw 8-bit tiles, unless it already has been converted
+ *
+ * The image is decoded once, one band of tile rows at a time, and after that
+ * the tiles can be streamed from the file without decoding the image again
+ *
+ * Note: Binary pgm and ppm and non-interlaced png of 8 or 16 bits can be of any size,
+ * because only one band of width x tileSize pixels is in memory. The other images
+ * are decoded whole by stb_image, which rejects images where width * height * channels
+ * is larger than INT_MAX (about 2 GB), so they fail up front with status 5
+ *
+ * PARAMS
+ * - const char* filepath | The filepath of the image
+ * - const char* tilepath | The filepath of the tile file
+ * - size_t tileSize      | The width and height of every tile
+ * - size_t channels      | The amount of channels (1 grey, 2 grey alpha, 3 RGB, 4 RGBA)
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to find the image
+ * - 3 | Failed to decode the image
+ * - 4 | Failed to write the tile file
+ * - 5 | The image can not be streamed, and is too large to decode whole
+ */
+int image_tiles_create(const char* filepath, const char* tilepath, size_t tileSize, size_t channels)
+{
+  if(filepath == NULL || tilepath == NULL || tileSize <= 0 || channels < 1 || channels > 4) return 1;
+
+  struct stat status;
+
+  if(stat(filepath, &status) == -1)
+  {
+    error_print("Failed to find image %s: %s", filepath, strerror(errno));
+
+    return 2;
+  }
+
+  ImageStream stream;
+
+  int streamStatus = image_stream_open(&stream, filepath, channels);
+
+  if(streamStatus == 3)
+  {
+    error_print("Image %s is too large to decode, convert it to a png or a ppm to stream it", filepath);
+
+    return 5;
+  }
+  else if(streamStatus != 0) return 3;
+
+  if(image_tiles_valid(tilepath, &status, &stream, tileSize))
+  {
+    image_stream_close(&stream);
+
+    return 0; // Success!
+  }
+
+  TilesHeader header = {
+    .mtimeSec = status.st_mtim.tv_sec,
+    .mtimeNsec = status.st_mtim.tv_nsec,
+    .size = status.st_size,
+    .width = stream.width,
+    .height = stream.height,
+    .channels = channels,
+    .tileSize = tileSize
+  };
+  memcpy(header.magic, TILES_MAGIC, sizeof(header.magic));
+
+  char temppath[PATH_MAX];
+
+  snprintf(temppath, sizeof(temppath), "%s.%d.tmp", tilepath, (int) getpid());
+
+  FILE* file = fopen(temppath, "wb");
+
+  if(file == NULL)
+  {
+    image_stream_close(&stream);
+
+    return 4;
+  }
+
+  char padding[TILES_OFFSET - sizeof(TilesHeader)];
+  memset(padding, 0, sizeof(padding));
+
+  int written = (fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(padding, sizeof(padding), 1, file) == 1) ?
+    image_tiles_write(file, &stream, tileSize) : 1;
+
+  image_stream_close(&stream);
+
+  if(fclose(file) != 0 && written == 0) written = 1;
+
+  if(written != 0 || rename(temppath, tilepath) == -1)
+  {
+    if(written == 2) error_print("Failed to decode image %s", filepath);
+
+    else error_print("Failed to write tile file %s", tilepath);
+
+    unlink(temppath);
+
+    return (written == 2) ? 3 : 4;
+  }
+  return 0; // Success!
+}
+
+/*
+ * Open a tile file, by mapping it into memory
+ *
+ * Note: The tiles are paged in when they are used, so the memory
+ * that is used is bounded by the tiles in use, not by the size of the image
+ *
+ * PARAMS
+ * - ImageTiles* tiles    | The pointer to the ImageTiles struct
+ * - const char* tilepath | The filepath of the tile file
+ * - unsigned int seed    | The seed of the random pixels
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ * - 2 | Failed to open the tile file
+ * - 3 | The tile file is not valid
+ */
+int image_tiles_open(ImageTiles* tiles, const char* tilepath, unsigned int seed)
+{
+  if(tiles == NULL || tilepath == NULL) return 1;
+
+  int file = open(tilepath, O_RDONLY);
+
+  if(file == -1)
+  {
+    error_print("open: %s", strerror(errno));
+
+    return 2;
+  }
+
+  struct stat status;
+
+  TilesHeader header;
+
+  if(fstat(file, &status) == -1 || pread(file, &header, sizeof(header), 0) != sizeof(header) ||
+     memcmp(header.magic, TILES_MAGIC, sizeof(header.magic)) || header.tileSize <= 0)
+  {
+    close(file);
+
+    return 3;
+  }
+
+  size_t columns = (header.width + header.tileSize - 1) / header.tileSize;
+  size_t rows = (header.height + header.tileSize - 1) / header.tileSize;
+
+  size_t tileLength = (header.tileSize * header.tileSize * header.channels);
+
+  if((uint64_t) status.st_size != TILES_OFFSET + (columns * rows * tileLength))
+  {
+    close(file);
+
+    return 3;
+  }
+
+  void* mapping = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+  close(file);
+
+  if(mapping == MAP_FAILED) return 2;
+
+  // The pixels are read in random order, so reading ahead would only waste memory
+  madvise(mapping, status.st_size, MADV_RANDOM);
+
+  tiles->mapping = mapping;
+  tiles->size = status.st_size;
+
+  tiles->pixels = (uint8_t*) mapping + TILES_OFFSET;
+
+  tiles->width = header.width;
+  tiles->height = header.height;
+  tiles->channels = header.channels;
+  tiles->tileSize = header.tileSize;
+  tiles->columns = columns;
+  tiles->rows = rows;
+
+  tiles->seed = seed;
+
+  return 0; // Success!
+}
+
+/*
+ * Fill a batch of inputs and targets with random pixels of the tiles
+ *
+ * The batch is made up of groups of pixels from the same tile, so only
+ * (amount / perTile) tiles have to be paged in for every batch.
+ * A tile is picked by a random pixel of the image, so that every pixel is equally likely
+ *
+ * PARAMS
+ * - float** inputs     | The normalized x and y values of the pixels
+ *   Size: amount x 2
+ * - float** targets    | The values of the pixels
+ *   Size: amount x channels
+ * - ImageTiles* tiles  | The opened tiles
+ * - size_t amount      | The size of the batch
+ * - size_t perTile     | The amount of pixels to pick from every tile
+ *
+ * RETURN (int status)
+ * - 0 | Success!
+ * - 1 | The inputted arguments are bad
+ */
+int image_tiles_batch_fill(float** inputs, float** targets, ImageTiles* tiles, size_t amount, size_t perTile)
+{
+  if(inputs == NULL || targets == NULL || tiles == NULL || tiles->pixels == NULL || perTile <= 0) return 1;
+
+  size_t tileSize = tiles->tileSize;
+  size_t channels = tiles->channels;
+
+  size_t tileLength = (tileSize * tileSize * channels);
+
+  float maxX = (tiles->width > 1) ? (float) (tiles->width - 1) : 1.0f;
+  float maxY = (tiles->height > 1) ? (float) (tiles->height - 1) : 1.0f;
+
+  for(size_t start = 0; start < amount; start += perTile)
+  {
+    size_t pixelX = rand_r(&tiles->seed) % tiles->width;
+    size_t pixelY = rand_r(&tiles->seed) % tiles->height;
+
+    size_t column = (pixelX / tileSize);
+    size_t row = (pixelY / tileSize);
+
+    size_t startX = (column * tileSize);
+    size_t startY = (row * tileSize);
+
+    size_t tileWidth = (startX + tileSize <= tiles->width) ? tileSize : (tiles->width - startX);
+    size_t tileHeight = (startY + tileSize <= tiles->height) ? tileSize : (tiles->height - startY);
+
+    const uint8_t* tile = tiles->pixels + ((row * tiles->columns + column) * tileLength);
+
+    size_t stop = (start + perTile <= amount) ? (start + perTile) : amount;
+
+    for(size_t index = start; index < stop; index++)
+    {
+      size_t xValue = rand_r(&tiles->seed) % tileWidth;
+      size_t yValue = rand_r(&tiles->seed) % tileHeight;
+
+      inputs[index][0] = (float) (startX + xValue) / maxX;
+      inputs[index][1] = (float) (startY + yValue) / maxY;
+
+      image_pixels_values_convert(targets[index], tile + ((yValue * tileSize + xValue) * channels), channels);
+    }
+  }
+  return 0; // Success!
+}
+
+/*
+ * Unmap the tile file of the inputted ImageTiles struct
+ */
+void image_tiles_close(ImageTiles* tiles)
+{
+  if(tiles->mapping != NULL) munmap(tiles->mapping, tiles->size);
+
+  memset(tiles, 0, sizeof(ImageTiles));
+}